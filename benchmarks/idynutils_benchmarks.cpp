@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+/**
+ * idynutils_benchmarks times the main kinematics, dynamics and collision queries of
+ * iDynUtils on the coman and bigman models of the tests, using random configurations
+ * within joint limits, and the construction of iDynUtils with and without the model
+ * cache, and writes the results as CSV or JSON:
+ *
+ *     idynutils_benchmarks [--format csv|json] [--output file] [--iterations N]
+ *
+ * Every row reports robot, benchmark, number of samples and min/mean/p99/max in microseconds.
+ * The random configurations are generated with a fixed seed, so that runs on different
+ * commits time exactly the same queries.
+ */
+
+#include <idynutils/idynutils.h>
+#include <idynutils/cartesian_utils.h>
+#include <idynutils/collision_utils.h>
+#include <idynutils/convex_hull.h>
+#include <idynutils/octomap_utils.h>
+#include <idynutils/stage_profiler.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+/**
+ * @brief The benchmark_context struct holds the robot, the configurations and
+ * the preallocated outputs shared by the benchmarks of a robot
+ */
+struct benchmark_context
+{
+    benchmark_context(const std::string& robot_name_) :
+        robot_name(robot_name_),
+        urdf_file(std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + robot_name + "/" + robot_name + ".urdf"),
+        srdf_file(std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + robot_name + "/" + robot_name + ".srdf"),
+        cache_file(std::string(IDYNUTILS_BENCHMARKS_CACHE_DIR) + robot_name + ".idyncache"),
+        robot(robot_name, urdf_file, srdf_file),
+        compute_distance(robot),
+        octomap(NULL)
+    {
+        const unsigned int nJ = robot.iDyn3_model.getNrOfDOFs();
+        J.resize(6, nJ + 6);
+        M.resize(nJ + 6, nJ + 6);
+
+        std::remove(cache_file.c_str());
+    }
+
+    ~benchmark_context()
+    {
+        std::remove(cache_file.c_str());
+    }
+
+    std::string robot_name;
+    std::string urdf_file;
+    std::string srdf_file;
+    std::string cache_file;
+
+    iDynUtils robot;
+    ComputeLinksDistance compute_distance;
+    idynutils::convex_hull hull;
+
+    std::vector<yarp::sig::Vector> q;
+    std::vector<yarp::sig::Vector> dq;
+    std::vector<yarp::sig::Vector> ddq;
+    std::vector<Eigen::VectorXd> q_eigen;
+    std::vector<Eigen::VectorXd> dq_eigen;
+    std::vector<Eigen::VectorXd> ddq_eigen;
+
+    Eigen::MatrixXd J;
+    Eigen::MatrixXd M;
+    std::list<KDL::Vector> support_points;
+    std::vector<KDL::Vector> support_hull;
+    const octomap_msgs::Octomap* octomap;
+
+    /**
+     * @brief constructed_robot the robot built by the construction benchmarks
+     */
+    boost::shared_ptr<iDynUtils> constructed_robot;
+};
+
+typedef void (*benchmark_function)(benchmark_context& context, const unsigned int sample);
+
+/**
+ * @brief The benchmark struct describes a benchmark: prepare is called (untimed) before every
+ * run, run is the timed part. Expensive benchmarks run a fraction 1/iterations_divider of the
+ * requested iterations.
+ */
+struct benchmark
+{
+    const char* name;
+    benchmark_function prepare;
+    benchmark_function run;
+    unsigned int iterations_divider;
+};
+
+void updateModel(benchmark_context& c, const unsigned int i)
+{
+    c.robot.updateiDyn3Model(c.q[i], c.dq[i], c.ddq[i], true);
+}
+
+void updateModelAndSupportPoints(benchmark_context& c, const unsigned int i)
+{
+    updateModel(c, i);
+    c.robot.getSupportPolygonPoints(c.support_points, "world");
+}
+
+void updateiDyn3ModelQ(benchmark_context& c, const unsigned int i)
+{
+    c.robot.updateiDyn3Model(c.q[i]);
+}
+
+void updateiDyn3ModelQWorld(benchmark_context& c, const unsigned int i)
+{
+    c.robot.updateiDyn3Model(c.q[i], true);
+}
+
+void updateiDyn3ModelQdQddQWorld(benchmark_context& c, const unsigned int i)
+{
+    c.robot.updateiDyn3Model(c.q[i], c.dq[i], c.ddq[i], true);
+}
+
+void updateiDyn3ModelEigen(benchmark_context& c, const unsigned int i)
+{
+    c.robot.updateiDyn3Model(c.q_eigen[i], c.dq_eigen[i], c.ddq_eigen[i], true);
+}
+
+void getPoseWorld(benchmark_context& c, const unsigned int)
+{
+    c.robot.getPose(c.robot.right_arm.end_effector_name);
+}
+
+void getPoseRelative(benchmark_context& c, const unsigned int)
+{
+    c.robot.getPose(c.robot.left_leg.end_effector_name, c.robot.right_arm.end_effector_name);
+}
+
+void getJacobian(benchmark_context& c, const unsigned int)
+{
+    c.robot.getJacobian(c.robot.right_arm.end_effector_index, Eigen::Ref<Eigen::MatrixXd>(c.J));
+}
+
+void getCOM(benchmark_context& c, const unsigned int)
+{
+    c.robot.getCOM();
+}
+
+void getFloatingBaseMassMatrix(benchmark_context& c, const unsigned int)
+{
+    c.robot.getFloatingBaseMassMatrix(Eigen::Ref<Eigen::MatrixXd>(c.M));
+}
+
+void getLinkDistances(benchmark_context& c, const unsigned int)
+{
+    c.compute_distance.getLinkDistances();
+}
+
+void checkSelfCollisionAt(benchmark_context& c, const unsigned int i)
+{
+    c.robot.checkSelfCollisionAt(c.q[i]);
+}
+
+void getSupportPolygonPoints(benchmark_context& c, const unsigned int)
+{
+    c.robot.getSupportPolygonPoints(c.support_points, "world");
+}
+
+void getConvexHull(benchmark_context& c, const unsigned int)
+{
+    c.hull.getConvexHull(c.support_points, c.support_hull);
+}
+
+void transformAndFilterOctomap(benchmark_context& c, const unsigned int)
+{
+    Eigen::Affine3d transform = Eigen::Affine3d::Identity();
+    transform.translate(Eigen::Vector3d(0.1, 0.0, 0.5));
+    octomap_utils::transformAndFilterOctomap(*c.octomap,
+                                             octomath::Vector3(-1.0, -1.0, 0.0),
+                                             octomath::Vector3(1.0, 1.0, 2.0),
+                                             transform);
+}
+
+void releaseConstructedRobot(benchmark_context& c, const unsigned int)
+{
+    c.constructed_robot.reset();
+}
+
+void constructRobot(benchmark_context& c, const unsigned int)
+{
+    c.constructed_robot.reset(new iDynUtils(c.robot_name, c.urdf_file, c.srdf_file));
+}
+
+void constructRobotWithCache(benchmark_context& c, const unsigned int)
+{
+    // the first (warm up) construction writes the cache, the following ones load it
+    c.constructed_robot.reset(new iDynUtils(c.robot_name, c.urdf_file, c.srdf_file, c.cache_file));
+}
+
+const benchmark benchmarks[] = {
+    {"updateiDyn3Model(q)",                    NULL,                        updateiDyn3ModelQ,           1},
+    {"updateiDyn3Model(q,world)",              NULL,                        updateiDyn3ModelQWorld,      1},
+    {"updateiDyn3Model(q,dq,ddq,world)",       NULL,                        updateiDyn3ModelQdQddQWorld, 1},
+    {"updateiDyn3Model(Eigen q,dq,ddq,world)", NULL,                        updateiDyn3ModelEigen,       1},
+    {"getPose(link)",                          updateModel,                 getPoseWorld,                1},
+    {"getPose(link,link)",                     updateModel,                 getPoseRelative,             1},
+    {"getJacobian",                            updateModel,                 getJacobian,                 1},
+    {"getCOM",                                 updateModel,                 getCOM,                      1},
+    {"getFloatingBaseMassMatrix",              updateModel,                 getFloatingBaseMassMatrix,   1},
+    {"getSupportPolygonPoints",                updateModel,                 getSupportPolygonPoints,     1},
+    {"convex_hull::getConvexHull",             updateModelAndSupportPoints, getConvexHull,               10},
+    {"checkSelfCollisionAt",                   NULL,                        checkSelfCollisionAt,        10},
+    {"ComputeLinksDistance::getLinkDistances", updateModel,                 getLinkDistances,            100},
+    {"transformAndFilterOctomap",              NULL,                        transformAndFilterOctomap,   100},
+    {"iDynUtils construction",                 releaseConstructedRobot,     constructRobot,              200},
+    {"iDynUtils construction (model cache)",   releaseConstructedRobot,     constructRobotWithCache,     200}
+};
+
+const unsigned int NR_OF_BENCHMARKS = sizeof(benchmarks)/sizeof(benchmarks[0]);
+const unsigned int NR_OF_CONFIGURATIONS = 100;
+
+void generateConfigurations(benchmark_context& c)
+{
+    const Eigen::VectorXd q_min = c.robot.getJointBoundMin();
+    const Eigen::VectorXd q_max = c.robot.getJointBoundMax();
+    const unsigned int nJ = q_min.size();
+
+    for(unsigned int i = 0; i < NR_OF_CONFIGURATIONS; ++i)
+    {
+        yarp::sig::Vector q(nJ), dq(nJ), ddq(nJ);
+        for(unsigned int j = 0; j < nJ; ++j)
+        {
+            q[j] = q_min[j] + drand48()*(q_max[j] - q_min[j]);
+            dq[j] = 2.0*drand48() - 1.0;
+            ddq[j] = 2.0*drand48() - 1.0;
+        }
+        c.q.push_back(q);
+        c.dq.push_back(dq);
+        c.ddq.push_back(ddq);
+        c.q_eigen.push_back(cartesian_utils::toEigen(q));
+        c.dq_eigen.push_back(cartesian_utils::toEigen(dq));
+        c.ddq_eigen.push_back(cartesian_utils::toEigen(ddq));
+    }
+}
+
+bool loadOctomap(octomap_msgs::Octomap& octomap)
+{
+    rosbag::Bag bag;
+    try {
+        bag.open(std::string(IDYNUTILS_TESTS_DATA_DIR) + "octomap.bag", rosbag::bagmode::Read);
+    } catch(const rosbag::BagException& e) {
+        std::cerr << "Could not open the octomap bag: " << e.what() << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> topics;
+    topics.push_back(std::string("/octomap_binary"));
+    rosbag::View view(bag, rosbag::TopicQuery(topics));
+    if(view.begin() == view.end())
+        return false;
+
+    octomap_msgs::Octomap::ConstPtr msg = view.begin()->instantiate<octomap_msgs::Octomap>();
+    if(!msg)
+        return false;
+    octomap = *msg;
+    bag.close();
+    return true;
+}
+
+/**
+ * @brief runBenchmarks runs all the benchmarks on a robot, storing the samples in profiler
+ */
+void runBenchmarks(benchmark_context& c, const unsigned int iterations,
+                   idynutils::stage_profiler& profiler)
+{
+    for(unsigned int b = 0; b < NR_OF_BENCHMARKS; ++b)
+    {
+        if(benchmarks[b].run == transformAndFilterOctomap && c.octomap == NULL)
+            continue;
+
+        const unsigned int n = std::max(iterations/benchmarks[b].iterations_divider, 1u);
+        // warm up caches and lazily built structures
+        for(unsigned int i = 0; i < std::min(n, 10u); ++i) {
+            if(benchmarks[b].prepare)
+                benchmarks[b].prepare(c, i % NR_OF_CONFIGURATIONS);
+            benchmarks[b].run(c, i % NR_OF_CONFIGURATIONS);
+        }
+
+        for(unsigned int i = 0; i < n; ++i)
+        {
+            const unsigned int sample = i % NR_OF_CONFIGURATIONS;
+            if(benchmarks[b].prepare)
+                benchmarks[b].prepare(c, sample);
+
+            uint64_t start = idynutils::stage_profiler::now();
+            benchmarks[b].run(c, sample);
+            profiler.addSample(b, idynutils::stage_profiler::now() - start);
+        }
+    }
+}
+
+void writeResults(std::ostream& out, const bool json,
+                  const std::vector<std::string>& robots,
+                  const std::vector<idynutils::stage_profiler>& profilers)
+{
+    if(json)
+        out << "[" << std::endl;
+    else
+        out << "robot,benchmark,iterations,min_us,mean_us,p99_us,max_us" << std::endl;
+
+    bool first = true;
+    for(unsigned int r = 0; r < robots.size(); ++r)
+    {
+        for(unsigned int b = 0; b < profilers[r].getNrOfStages(); ++b)
+        {
+            idynutils::stage_profiler::stage_statistics s = profilers[r].getStatistics(b);
+            if(s.count == 0)
+                continue;
+
+            if(json) {
+                out << (first ? "" : ",\n")
+                    << "  {\"robot\": \"" << robots[r] << "\", "
+                    << "\"benchmark\": \"" << s.name << "\", "
+                    << "\"iterations\": " << s.count << ", "
+                    << "\"min_us\": " << s.min*1e6 << ", "
+                    << "\"mean_us\": " << s.mean*1e6 << ", "
+                    << "\"p99_us\": " << s.p99*1e6 << ", "
+                    << "\"max_us\": " << s.max*1e6 << "}";
+            } else {
+                out << robots[r] << ",\"" << s.name << "\"," << s.count << ","
+                    << s.min*1e6 << "," << s.mean*1e6 << ","
+                    << s.p99*1e6 << "," << s.max*1e6 << std::endl;
+            }
+            first = false;
+        }
+    }
+
+    if(json)
+        out << std::endl << "]" << std::endl;
+}
+
+void printUsage()
+{
+    std::cerr << "usage: idynutils_benchmarks [--format csv|json] [--output file] [--iterations N]"
+              << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    std::string output_file;
+    unsigned int iterations = 1000;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--format") == 0 && i+1 < argc)
+            json = std::strcmp(argv[++i], "json") == 0;
+        else if(std::strcmp(argv[i], "--output") == 0 && i+1 < argc)
+            output_file = argv[++i];
+        else if(std::strcmp(argv[i], "--iterations") == 0 && i+1 < argc)
+            iterations = std::max(std::atoi(argv[++i]), 1);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::vector<std::string> benchmark_names;
+    for(unsigned int b = 0; b < NR_OF_BENCHMARKS; ++b)
+        benchmark_names.push_back(benchmarks[b].name);
+
+    octomap_msgs::Octomap octomap;
+    bool octomap_loaded = loadOctomap(octomap);
+
+    std::vector<std::string> robots;
+    robots.push_back("coman");
+    robots.push_back("bigman");
+
+    std::vector<idynutils::stage_profiler> profilers(robots.size(),
+                                                     idynutils::stage_profiler(benchmark_names));
+
+    // same configurations on every run
+    srand48(0);
+    for(unsigned int r = 0; r < robots.size(); ++r)
+    {
+        benchmark_context context(robots[r]);
+        generateConfigurations(context);
+        if(octomap_loaded)
+            context.octomap = &octomap;
+
+        runBenchmarks(context, iterations, profilers[r]);
+        // the octomap benchmark does not depend on the robot
+        octomap_loaded = false;
+    }
+
+    if(output_file != "")
+    {
+        std::ofstream file(output_file.c_str());
+        if(!file.is_open()) {
+            std::cerr << "Could not open " << output_file << std::endl;
+            return 1;
+        }
+        writeResults(file, json, robots, profilers);
+    }
+    else
+        writeResults(std::cout, json, robots, profilers);
+
+    return 0;
+}
@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+/**
+ * idynutils_codegen generates the forward kinematics of a robot as C++ code,
+ * see idynutils::generated_kinematics:
+ *
+ *     idynutils_codegen robot_name robot.urdf robot.srdf output_dir
+ *
+ * writes output_dir/<robot_name>_generated_kinematics.h and .cpp, defining the class
+ * idynutils::<robot_name>_generated_kinematics.
+ */
+
+#include <idynutils/idynutils.h>
+#include <idynutils/generated_kinematics.h>
+#include <idynutils/kinematic_tree.h>
+#include <idynutils/model_cache.h>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const double EPS = 1e-12;
+
+/**
+ * @brief The joint struct describes the motion of a segment as pose(q) = F0 * motion(axis, q),
+ * with F0 the pose at q = 0 and axis expressed in the frame of the segment
+ */
+struct joint
+{
+    int type;
+    int dof;
+    KDL::Frame F0;
+    KDL::Vector axis;
+};
+
+std::string literal(const double value)
+{
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    std::string s(buffer);
+    if(s.find_first_of(".en") == std::string::npos)
+        s += ".0";
+    return s;
+}
+
+/**
+ * @brief snap rounds to 0, 1 and -1 the values that are within EPS from them,
+ * so that they get simplified in the generated code
+ */
+double snap(const double value)
+{
+    if(std::fabs(value) < EPS) return 0.0;
+    if(std::fabs(value - 1.0) < EPS) return 1.0;
+    if(std::fabs(value + 1.0) < EPS) return -1.0;
+    return value;
+}
+
+/**
+ * @brief linearCombination writes sum_k coefficients[k]*terms[k], skipping null coefficients
+ * and multiplications by +-1
+ */
+std::string linearCombination(const std::string* terms, const double* coefficients, const unsigned int n)
+{
+    std::ostringstream out;
+    for(unsigned int k = 0; k < n; ++k)
+    {
+        const double c = snap(coefficients[k]);
+        if(c == 0.0)
+            continue;
+
+        const bool first = out.tellp() == 0;
+        if(c == 1.0)
+            out << (first ? "" : " + ") << terms[k];
+        else if(c == -1.0)
+            out << (first ? "-" : " - ") << terms[k];
+        else
+            out << (first ? "" : " + ") << literal(c) << "*" << terms[k];
+    }
+    if(out.tellp() == 0)
+        return "0.0";
+    return out.str();
+}
+
+/**
+ * @brief getAlignedAxis
+ * @return the index of the coordinate axis parallel to axis (with sign), -1 if none
+ */
+int getAlignedAxis(const KDL::Vector& axis, double& sign)
+{
+    for(int j = 0; j < 3; ++j) {
+        if(std::fabs(std::fabs(axis[j]) - 1.0) < 1e-9) {
+            sign = axis[j] > 0.0 ? 1.0 : -1.0;
+            return j;
+        }
+    }
+    return -1;
+}
+
+bool isPrismatic(const KDL::Joint& j)
+{
+    return j.getType() == KDL::Joint::TransAxis || j.getType() == KDL::Joint::TransX ||
+           j.getType() == KDL::Joint::TransY || j.getType() == KDL::Joint::TransZ;
+}
+
+/**
+ * @brief getJoint computes the motion of a segment and checks that the segment
+ * actually moves as F0 * motion(axis, q)
+ */
+bool getJoint(const idynutils::kinematic_tree& tree, const unsigned int i, joint& j)
+{
+    const KDL::Segment& segment = tree.getSegment(i);
+    j.dof = tree.getDOF(i);
+    j.F0 = segment.pose(0.0);
+    j.axis = KDL::Vector::Zero();
+    j.type = idynutils::generated_kinematics::FIXED;
+    if(j.dof == -1)
+        return true;
+
+    const KDL::Frame relative = j.F0.Inverse() * segment.pose(1.0);
+    if(isPrismatic(segment.getJoint())) {
+        j.type = idynutils::generated_kinematics::PRISMATIC;
+        j.axis = relative.p;
+    } else {
+        j.type = idynutils::generated_kinematics::REVOLUTE;
+        relative.M.GetRotAngle(j.axis);
+    }
+    j.axis.Normalize();
+    for(int k = 0; k < 3; ++k)
+        j.axis[k] = snap(j.axis[k]);
+
+    const double test_q[] = {-2.1, 0.3, 1.3};
+    for(unsigned int t = 0; t < 3; ++t)
+    {
+        KDL::Frame motion = j.type == idynutils::generated_kinematics::PRISMATIC ?
+                            KDL::Frame(j.axis*test_q[t]) :
+                            KDL::Frame(KDL::Rotation::Rot2(j.axis, test_q[t]));
+        if(!KDL::Equal(j.F0 * motion, segment.pose(test_q[t]), 1e-9)) {
+            std::cerr << "Joint " << segment.getJoint().getName()
+                      << " is neither a rotation nor a translation about an axis through the origin of "
+                      << segment.getName() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string pose(const unsigned int i, const char* member, const unsigned int k)
+{
+    std::ostringstream out;
+    out << "T[" << i << "]." << member << ".data[" << k << "]";
+    return out.str();
+}
+
+/**
+ * @brief writeSegment writes the code computing T[i] from T[parent]
+ */
+void writeSegment(std::ostream& out, const idynutils::kinematic_tree& tree,
+                  const unsigned int i, const joint& j)
+{
+    const int parent = tree.getParent(i);
+    out << "    // " << tree.getSegmentName(i) << ", child of " << tree.getSegmentName(parent) << std::endl;
+    out << "    {" << std::endl;
+
+    // m, p = T[parent] * F0, written with the constant coefficients of F0
+    std::string m[9], p[3];
+    for(unsigned int r = 0; r < 3; ++r)
+    {
+        std::string parent_row[3];
+        for(unsigned int k = 0; k < 3; ++k)
+            parent_row[k] = pose(parent, "M", 3*r + k);
+
+        for(unsigned int c = 0; c < 3; ++c)
+        {
+            std::ostringstream name;
+            name << "m" << 3*r + c;
+            m[3*r + c] = name.str();
+
+            double column[3] = {j.F0.M(0,c), j.F0.M(1,c), j.F0.M(2,c)};
+            out << "        const double " << m[3*r + c] << " = ";
+            if(parent == 0)
+                out << literal(snap(j.F0.M(r,c)));
+            else
+                out << linearCombination(parent_row, column, 3);
+            out << ";" << std::endl;
+        }
+
+        std::ostringstream name;
+        name << "p" << r;
+        p[r] = name.str();
+
+        double origin[3] = {j.F0.p.x(), j.F0.p.y(), j.F0.p.z()};
+        out << "        const double " << p[r] << " = ";
+        if(parent == 0)
+            out << literal(snap(j.F0.p[r]));
+        else {
+            std::string combination = linearCombination(parent_row, origin, 3);
+            out << pose(parent, "p", r) << (combination == "0.0" ? "" : " + " + combination);
+        }
+        out << ";" << std::endl;
+    }
+
+    double sign = 1.0;
+    const int aligned = getAlignedAxis(j.axis, sign);
+    std::string M[9];
+    std::string P[3] = {p[0], p[1], p[2]};
+    for(unsigned int k = 0; k < 9; ++k)
+        M[k] = m[k];
+
+    if(j.type == idynutils::generated_kinematics::REVOLUTE)
+    {
+        out << "        const double c = std::cos(q[" << j.dof << "]);" << std::endl;
+        out << "        const double s = " << (sign > 0.0 ? "" : "-")
+            << "std::sin(q[" << j.dof << "]);" << std::endl;
+
+        if(aligned != -1)
+        {
+            // a rotation about a coordinate axis only mixes the other two columns
+            const unsigned int u = (aligned + 1) % 3;
+            const unsigned int v = (aligned + 2) % 3;
+            for(unsigned int r = 0; r < 3; ++r) {
+                M[3*r + u] = "c*" + m[3*r + u] + " + s*" + m[3*r + v];
+                M[3*r + v] = "c*" + m[3*r + v] + " - s*" + m[3*r + u];
+            }
+        }
+        else
+        {
+            out << "        const KDL::Rotation R = KDL::Rotation::Rot2(KDL::Vector("
+                << literal(j.axis.x()) << ", " << literal(j.axis.y()) << ", " << literal(j.axis.z())
+                << "), q[" << j.dof << "]);" << std::endl;
+            for(unsigned int r = 0; r < 3; ++r)
+                for(unsigned int c = 0; c < 3; ++c) {
+                    std::ostringstream e;
+                    e << m[3*r] << "*R.data[" << c << "] + " << m[3*r + 1] << "*R.data[" << 3 + c << "] + "
+                      << m[3*r + 2] << "*R.data[" << 6 + c << "]";
+                    M[3*r + c] = e.str();
+                }
+        }
+    }
+    else if(j.type == idynutils::generated_kinematics::PRISMATIC)
+    {
+        double axis[3] = {j.axis.x(), j.axis.y(), j.axis.z()};
+        for(unsigned int r = 0; r < 3; ++r) {
+            std::ostringstream e;
+            e << p[r] << " + q[" << j.dof << "]*(" << linearCombination(&m[3*r], axis, 3) << ")";
+            P[r] = e.str();
+        }
+    }
+
+    for(unsigned int k = 0; k < 9; ++k)
+        out << "        " << pose(i, "M", k) << " = " << M[k] << ";" << std::endl;
+    for(unsigned int r = 0; r < 3; ++r)
+        out << "        " << pose(i, "p", r) << " = " << P[r] << ";" << std::endl;
+
+    // contribution to the CoM
+    const KDL::RigidBodyInertia& inertia = tree.getSegment(i).getInertia();
+    if(inertia.getMass() > 0.0)
+    {
+        const char* com[3] = {"cx", "cy", "cz"};
+        double cog[3] = {inertia.getCOG().x(), inertia.getCOG().y(), inertia.getCOG().z()};
+        for(unsigned int r = 0; r < 3; ++r)
+        {
+            std::string row[3];
+            for(unsigned int k = 0; k < 3; ++k)
+                row[k] = pose(i, "M", 3*r + k);
+            std::string combination = linearCombination(row, cog, 3);
+            out << "        " << com[r] << " += " << literal(inertia.getMass()) << "*("
+                << pose(i, "p", r) << (combination == "0.0" ? "" : " + " + combination) << ");" << std::endl;
+        }
+    }
+
+    out << "    }" << std::endl;
+}
+
+void writeHeader(std::ostream& out, const std::string& class_name,
+                 const std::string& urdf, const std::string& srdf)
+{
+    std::string guard = "_" + class_name + "_H_";
+    for(unsigned int i = 0; i < guard.size(); ++i)
+        guard[i] = std::toupper(guard[i]);
+
+    out << "// generated by idynutils_codegen from" << std::endl
+        << "//     " << urdf << std::endl
+        << "//     " << srdf << std::endl
+        << "// do not edit" << std::endl << std::endl
+        << "#ifndef " << guard << std::endl
+        << "#define " << guard << std::endl << std::endl
+        << "#include <idynutils/generated_kinematics.h>" << std::endl << std::endl
+        << "namespace idynutils" << std::endl
+        << "{" << std::endl << std::endl
+        << "class " << class_name << " : public generated_kinematics" << std::endl
+        << "{" << std::endl
+        << "public:" << std::endl
+        << "    " << class_name << "();" << std::endl
+        << "    generated_kinematics* clone() const;" << std::endl << std::endl
+        << "protected:" << std::endl
+        << "    void computePoses(const double* q, KDL::Frame* T, KDL::Vector& com) const;" << std::endl
+        << "};" << std::endl << std::endl
+        << "}" << std::endl << std::endl
+        << "#endif" << std::endl;
+}
+
+void writeSource(std::ostream& out, const std::string& class_name,
+                 const std::string& urdf, const std::string& srdf, const uint64_t hash,
+                 const idynutils::kinematic_tree& tree, const std::vector<joint>& joints)
+{
+    const unsigned int n = tree.getNrOfSegments();
+
+    out << "// generated by idynutils_codegen from" << std::endl
+        << "//     " << urdf << std::endl
+        << "//     " << srdf << std::endl
+        << "// do not edit" << std::endl << std::endl
+        << "#include \"" << class_name << ".h\"" << std::endl
+        << "#include <cmath>" << std::endl << std::endl
+        << "using namespace idynutils;" << std::endl << std::endl
+        << "namespace {" << std::endl << std::endl;
+
+    out << "const char* const link_names[] = {" << std::endl;
+    for(unsigned int i = 0; i < n; ++i)
+        out << "    \"" << tree.getSegmentName(i) << "\"" << (i+1 < n ? "," : "") << std::endl;
+    out << "};" << std::endl << std::endl;
+
+    out << "const int parents[] = {";
+    for(unsigned int i = 0; i < n; ++i)
+        out << (i ? ", " : "") << tree.getParent(i);
+    out << "};" << std::endl << std::endl;
+
+    out << "const int dofs[] = {";
+    for(unsigned int i = 0; i < n; ++i)
+        out << (i ? ", " : "") << joints[i].dof;
+    out << "};" << std::endl << std::endl;
+
+    out << "const int joint_types[] = {";
+    for(unsigned int i = 0; i < n; ++i)
+        out << (i ? ", " : "") << joints[i].type;
+    out << "};" << std::endl << std::endl;
+
+    out << "const double axes[][3] = {" << std::endl;
+    for(unsigned int i = 0; i < n; ++i)
+        out << "    {" << literal(joints[i].axis.x()) << ", " << literal(joints[i].axis.y()) << ", "
+            << literal(joints[i].axis.z()) << "}" << (i+1 < n ? "," : "") << std::endl;
+    out << "};" << std::endl << std::endl;
+
+    out << "}" << std::endl << std::endl;
+
+    out << class_name << "::" << class_name << "() :" << std::endl
+        << "    generated_kinematics(" << hash << "ULL, " << n << ", " << tree.getNrOfDOFs()
+        << ", link_names, parents, dofs, joint_types, axes)" << std::endl
+        << "{" << std::endl << std::endl << "}" << std::endl << std::endl;
+
+    out << "generated_kinematics* " << class_name << "::clone() const" << std::endl
+        << "{" << std::endl
+        << "    return new " << class_name << "(*this);" << std::endl
+        << "}" << std::endl << std::endl;
+
+    double total_mass = 0.0;
+    for(unsigned int i = 1; i < n; ++i)
+        total_mass += tree.getSegment(i).getInertia().getMass();
+
+    out << "void " << class_name << "::computePoses(const double* q, KDL::Frame* T, KDL::Vector& com) const" << std::endl
+        << "{" << std::endl
+        << "    double cx = 0.0, cy = 0.0, cz = 0.0;" << std::endl
+        << "    T[0] = KDL::Frame::Identity();" << std::endl << std::endl;
+    for(unsigned int i = 1; i < n; ++i)
+        writeSegment(out, tree, i, joints[i]);
+    out << std::endl
+        << "    com = KDL::Vector(cx, cy, cz) * " << literal(total_mass > 0.0 ? 1.0/total_mass : 0.0) << ";" << std::endl
+        << "}" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 5) {
+        std::cerr << "usage: idynutils_codegen robot_name robot.urdf robot.srdf output_dir" << std::endl;
+        return 1;
+    }
+
+    const std::string robot_name = argv[1];
+    const std::string urdf = argv[2];
+    const std::string srdf = argv[3];
+    const std::string output_dir = argv[4];
+    const std::string class_name = robot_name + "_generated_kinematics";
+
+    uint64_t hash;
+    if(!idynutils::model_cache::computeHash(urdf, srdf, hash)) {
+        std::cerr << "Could not read " << urdf << " or " << srdf << std::endl;
+        return 1;
+    }
+
+    iDynUtils robot(robot_name, urdf, srdf, "", true);
+    idynutils::kinematic_tree tree(robot);
+
+    std::vector<joint> joints(tree.getNrOfSegments());
+    for(unsigned int i = 0; i < tree.getNrOfSegments(); ++i)
+        if(!getJoint(tree, i, joints[i]))
+            return 1;
+
+    std::ofstream header((output_dir + "/" + class_name + ".h").c_str());
+    std::ofstream source((output_dir + "/" + class_name + ".cpp").c_str());
+    if(!header.is_open() || !source.is_open()) {
+        std::cerr << "Could not write in " << output_dir << std::endl;
+        return 1;
+    }
+
+    writeHeader(header, class_name, urdf, srdf);
+    writeSource(source, class_name, urdf, srdf, hash, tree, joints);
+
+    std::cout << "Generated " << class_name << ": " << tree.getNrOfSegments() << " links, "
+              << tree.getNrOfDOFs() << " DOFs" << std::endl;
+    return 0;
+}
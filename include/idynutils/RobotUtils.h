@@ -30,6 +30,9 @@
 
 /**
  * @brief The RobotUtils class eases whole body control for the coman robot.
+ * After warmup(), all the chains and idynutils share a single error ring, which only
+ * supports one producer: move, sense, the ft sensors readings and the idynutils updates
+ * must then be called from one (real-time) thread.
  */
 class RobotUtils
 {
@@ -71,6 +74,16 @@ public:
 
     std::vector<std::string> ft_reference_frames;
 
+    /**
+     * @brief warmup enables the real-time mode of idynutils (see iDynUtils::warmup()) and of
+     * all the chains: afterwards move, sense and the ft sensors readings do not allocate nor print,
+     * and the errors of the chains are pushed into idynutils.getRealTimeErrors().
+     * That ring has a single producer: afterwards every call that can report an error (move,
+     * sense, the ft sensors readings, the idynutils updates and queries) must come from the
+     * same thread, while another thread can print the errors
+     */
+    void warmup();
+
     /**
      * @brief hasHands check whether both hands are available
      * @return true if connection to both hands is successful
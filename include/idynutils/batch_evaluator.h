@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _BATCH_EVALUATOR_H_
+#define _BATCH_EVALUATOR_H_
+
+#include <idynutils/idynutils.h>
+#include <idynutils/worker_pool.h>
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The batch_evaluator class evaluates poses, CoM, Jacobians and torques
+ * of a robot model over many configurations, splitting the configurations among
+ * a number of threads. Every thread works on its own clone of the model, the threads
+ * are started at construction and reused by every evaluation.
+ *
+ * Outputs are written into caller preallocated, column-major buffers (e.g. the data()
+ * of an Eigen::MatrixXd) holding one configuration per column:
+ *  - poses: getPosesSize() rows, the 4x4 column-major homogeneous transforms
+ *           of the links, one after the other
+ *  - com: 3 rows, the CoM expressed in world frame
+ *  - jacobians: getJacobiansSize() rows, the 6x(#DOFs+6) column-major Jacobians
+ *               of the links, one after the other
+ *  - torques: #DOFs rows, the joint torques from inverse dynamics
+ * A NULL buffer means the output is not requested, and it is not computed.
+ */
+class batch_evaluator
+{
+public:
+    /**
+     * @brief The outputs struct holds the output buffers of a batch evaluation
+     */
+    struct outputs
+    {
+        outputs() : poses(NULL), com(NULL), jacobians(NULL), torques(NULL) {}
+
+        double* poses;
+        double* com;
+        double* jacobians;
+        double* torques;
+    };
+
+    /**
+     * @brief batch_evaluator clones the model once for every thread
+     * @param model the model to clone. World pose, anchor and floating base of the clones
+     *        are the ones of model at construction time
+     * @param links the links whose poses and Jacobians are computed. If one of them does
+     *        not exist, isValid() and evaluate() return false
+     * @param number_of_threads number of threads used, 0 to use one thread per core
+     */
+    batch_evaluator(const iDynUtils& model,
+                    const std::vector<std::string>& links,
+                    const unsigned int number_of_threads = 0);
+
+    /**
+     * @brief evaluate evaluates the model at the configurations Q, with zero joint
+     *        velocities and accelerations
+     * @param Q a #DOFs x #configurations matrix of joint positions
+     * @param out the output buffers, with Q.cols() columns
+     * @param set_world_pose do we update the base link pose wrt the world frame?
+     * @return false if one of the links does not exist
+     */
+    bool evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q,
+                  const outputs& out,
+                  const bool set_world_pose = false);
+
+    /**
+     * @brief evaluate evaluates the model at the states (Q, dQ, ddQ)
+     * @param Q a #DOFs x #configurations matrix of joint positions
+     * @param dQ a #DOFs x #configurations matrix of joint velocities
+     * @param ddQ a #DOFs x #configurations matrix of joint accelerations
+     * @param out the output buffers, with Q.cols() columns
+     * @param set_world_pose do we update the base link pose wrt the world frame?
+     * @return false if one of the links does not exist
+     */
+    bool evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q,
+                  const Eigen::Ref<const Eigen::MatrixXd>& dQ,
+                  const Eigen::Ref<const Eigen::MatrixXd>& ddQ,
+                  const outputs& out,
+                  const bool set_world_pose = false);
+
+    /**
+     * @brief isValid
+     * @return false if one of the links given at construction does not exist
+     */
+    bool isValid() const;
+
+    /**
+     * @brief getNumberOfThreads
+     * @return the number of threads used to evaluate the configurations
+     */
+    unsigned int getNumberOfThreads() const;
+
+    /**
+     * @brief getNumberOfDOFs
+     * @return the number of DOFs of the model, i.e. the rows of Q and of the torques
+     */
+    unsigned int getNumberOfDOFs() const;
+
+    /**
+     * @brief getPosesSize
+     * @return the rows of the poses output buffer
+     */
+    unsigned int getPosesSize() const;
+
+    /**
+     * @brief getJacobiansSize
+     * @return the rows of the jacobians output buffer
+     */
+    unsigned int getJacobiansSize() const;
+
+private:
+    typedef std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > poses_vector;
+
+    /**
+     * @brief The job struct holds inputs and outputs of a batch evaluation
+     */
+    struct job
+    {
+        const Eigen::Ref<const Eigen::MatrixXd>* Q;
+        const Eigen::Ref<const Eigen::MatrixXd>* dQ;
+        const Eigen::Ref<const Eigen::MatrixXd>* ddQ;
+        const outputs* out;
+        bool set_world_pose;
+        int threads;
+    };
+
+    bool run(job& j);
+
+    /**
+     * @brief evaluateChunk is run by every thread on its share of the configurations
+     */
+    void evaluateChunk(const unsigned int thread, const job* j);
+
+    worker_pool _workers;
+    std::vector<boost::shared_ptr<iDynUtils> > _models;
+    std::vector<poses_vector> _poses_buffers;
+    std::vector<LinkHandle> _links;
+    bool _links_valid;
+    unsigned int _nDOFs;
+};
+
+}
+
+#endif
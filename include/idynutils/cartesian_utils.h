@@ -301,6 +301,14 @@ public:
      */
     static void fromKDLFrameToYARPMatrix(const KDL::Frame& Ti, yarp::sig::Matrix& To);
 
+    /**
+     * @brief fromKDLFrameToEigenMatrix convert a KDL::Frame in a 4x4 Eigen homogeneous matrix,
+     * without allocating memory
+     * @param Ti KDL::Frame
+     * @param To Eigen::Matrix4d
+     */
+    static void fromKDLFrameToEigenMatrix(const KDL::Frame& Ti, Eigen::Matrix4d& To);
+
     /**
      * @brief fromKDLRotationToYARPMatrix convert a KDL::Rotation in a yarp::sig::Matrix
      * @param Ri KDL::Rotation
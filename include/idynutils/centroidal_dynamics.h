@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _CENTROIDAL_DYNAMICS_H_
+#define _CENTROIDAL_DYNAMICS_H_
+
+#include <idynutils/kinematic_tree.h>
+#include <Eigen/Dense>
+#include <kdl/frames.hpp>
+#include <kdl/rigidbodyinertia.hpp>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The centroidal_dynamics class computes the centroidal momentum matrix A(q) and
+ * the bias term dA(q,dq)*dq of a floating base robot, so that
+ *
+ *     h = A(q) nu,    dh/dt = A(q) dnu/dt + dA(q,dq)*dq
+ *
+ * where h = [linear momentum; angular momentum about the CoM], expressed in world frame,
+ * and nu = [linear velocity of the floating base origin; angular velocity of the floating
+ * base; dq], the velocity of the floating base being expressed in world frame as in the
+ * Jacobians of iDynUtils.
+ *
+ * The computation is O(#links): a forward pass computes poses, velocities and bias
+ * accelerations of the links, a backward pass accumulates the composite rigid body
+ * inertias (as in CCRBA). Every column of A is the momentum of the subtree moved by the
+ * corresponding DOF. All the buffers are allocated at construction time.
+ */
+class centroidal_dynamics
+{
+public:
+    /**
+     * @brief centroidal_dynamics builds the flat representation of the tree
+     * @param tree the KDL tree of the robot, e.g. iDynUtils::getKDLTree()
+     * @param joint_names the names of the moving joints, in DOF order,
+     *        e.g. iDynUtils::getDOFNames()
+     */
+    centroidal_dynamics(const KDL::Tree& tree, const std::vector<std::string>& joint_names);
+
+    /**
+     * @brief getLinkIndex
+     * @param link a link name
+     * @return the index of the link, -1 if it does not exist
+     */
+    int getLinkIndex(const std::string& link) const;
+
+    unsigned int getNrOfDOFs() const { return _tree.getNrOfDOFs(); }
+
+    /**
+     * @brief compute computes A(q) and dA(q,dq)*dq
+     * @param base_link index of the floating base link, see getLinkIndex()
+     * @param world_T_base pose of the floating base link in world frame
+     * @param base_velocity velocity of the floating base in world frame, the linear
+     *        velocity being the one of the origin of base_link
+     * @param q joint positions
+     * @param dq joint velocities
+     * @param A a 6 x (6 + #DOFs) matrix (or block)
+     * @param dA_dq a 6 vector (or block)
+     */
+    void compute(const int base_link,
+                 const KDL::Frame& world_T_base,
+                 const KDL::Twist& base_velocity,
+                 const Eigen::Ref<const Eigen::VectorXd>& q,
+                 const Eigen::Ref<const Eigen::VectorXd>& dq,
+                 Eigen::Ref<Eigen::MatrixXd> A,
+                 Eigen::Ref<Eigen::VectorXd> dA_dq);
+
+    /**
+     * @brief computeBias computes only dA(q,dq)*dq, skipping the composite inertias and A(q)
+     * @param base_link index of the floating base link, see getLinkIndex()
+     * @param world_T_base pose of the floating base link in world frame
+     * @param base_velocity velocity of the floating base in world frame, the linear
+     *        velocity being the one of the origin of base_link
+     * @param q joint positions
+     * @param dq joint velocities
+     * @param dA_dq a 6 vector (or block)
+     */
+    void computeBias(const int base_link,
+                     const KDL::Frame& world_T_base,
+                     const KDL::Twist& base_velocity,
+                     const Eigen::Ref<const Eigen::VectorXd>& q,
+                     const Eigen::Ref<const Eigen::VectorXd>& dq,
+                     Eigen::Ref<Eigen::VectorXd> dA_dq);
+
+    /**
+     * @brief computeCOM computes only the CoM, without A(q) and dA(q,dq)*dq
+     * @param base_link index of the floating base link, see getLinkIndex()
+     * @param world_T_base pose of the floating base link in world frame
+     * @param q joint positions
+     * @return the CoM in world frame, also returned by getCOM()
+     */
+    const KDL::Vector& computeCOM(const int base_link,
+                                  const KDL::Frame& world_T_base,
+                                  const Eigen::Ref<const Eigen::VectorXd>& q);
+
+    /**
+     * @brief getMass
+     * @return the mass of the robot
+     */
+    double getMass() const;
+
+    /**
+     * @brief getCOM
+     * @return the CoM in world frame, as computed by the last call to compute(), computeBias()
+     * or computeCOM()
+     */
+    const KDL::Vector& getCOM() const;
+
+private:
+    double getJointPosition(const unsigned int segment, const Eigen::Ref<const Eigen::VectorXd>& q) const;
+
+    /**
+     * @brief computePoses computes _poses, _motions and _on_base_path
+     */
+    void computePoses(const int base_link,
+                      const KDL::Frame& world_T_base,
+                      const Eigen::Ref<const Eigen::VectorXd>& q);
+
+    /**
+     * @brief computeMomentumBias computes poses, velocities, bias accelerations and inertias
+     * of the links, _total_inertia and _com
+     * @return the rate of change of the momentum due to the bias accelerations, wrt the world origin
+     */
+    KDL::Wrench computeMomentumBias(const int base_link,
+                                    const KDL::Frame& world_T_base,
+                                    const KDL::Twist& base_velocity,
+                                    const Eigen::Ref<const Eigen::VectorXd>& q,
+                                    const Eigen::Ref<const Eigen::VectorXd>& dq);
+
+    kinematic_tree _tree;
+    std::vector<char> _prismatic;
+
+    /**
+     * @brief _on_base_path marks the segments on the path from the root to the floating base
+     */
+    std::vector<char> _on_base_path;
+
+    /**
+     * @brief _poses, _motions, _velocities, _accelerations poses of the links, motion
+     * subspaces of their joints, velocities and bias accelerations, in world frame with
+     * the world origin as reference point
+     */
+    std::vector<KDL::Frame> _poses;
+    std::vector<KDL::Twist> _motions;
+    std::vector<KDL::Twist> _velocities;
+    std::vector<KDL::Twist> _accelerations;
+
+    /**
+     * @brief _inertias inertias of the links, then composite rigid body inertias of the
+     * subtrees after compute(), and _total_inertia the one of the robot, in world frame
+     */
+    std::vector<KDL::RigidBodyInertia> _inertias;
+    KDL::RigidBodyInertia _total_inertia;
+
+    KDL::Vector _com;
+};
+
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _CONTACT_KINEMATICS_H_
+#define _CONTACT_KINEMATICS_H_
+
+#include <idynutils/kinematic_tree.h>
+#include <Eigen/Dense>
+#include <kdl/frames.hpp>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The contact_kinematics class computes, in a single forward pass, the poses, the stacked
+ * Jacobian J and the bias acceleration dJ*nu of a set of contact links of a floating base robot,
+ * so that the velocities and accelerations of the k contact links are
+ *
+ *     v = J nu,    dv/dt = J dnu/dt + dJ*nu
+ *
+ * where v stacks, for each contact, [linear velocity of its origin; angular velocity] and
+ * nu = [linear velocity of the floating base origin; angular velocity of the floating base; dq],
+ * everything in world frame as in the Jacobians of iDynUtils.
+ *
+ * Only the links on the paths from the root to the contacts and to the floating base are
+ * visited, and the links shared by these paths (e.g. the pelvis for the two feet) once.
+ * All the buffers are allocated by the constructor and by setContacts().
+ */
+class contact_kinematics
+{
+public:
+    /**
+     * @brief contact_kinematics builds the flat representation of the tree
+     * @param tree the KDL tree of the robot, e.g. iDynUtils::getKDLTree()
+     * @param joint_names the names of the moving joints, in DOF order,
+     *        e.g. iDynUtils::getDOFNames()
+     */
+    contact_kinematics(const KDL::Tree& tree, const std::vector<std::string>& joint_names);
+
+    /**
+     * @brief getLinkIndex
+     * @param link a link name
+     * @return the index of the link, -1 if it does not exist
+     */
+    int getLinkIndex(const std::string& link) const;
+
+    unsigned int getNrOfDOFs() const { return _tree.getNrOfDOFs(); }
+
+    /**
+     * @brief setContacts sets the contact links
+     * @param contacts indices of the contact links, see getLinkIndex()
+     * @return false if some index is not a link of the tree, in which case the contacts are not changed
+     */
+    bool setContacts(const std::vector<int>& contacts);
+
+    unsigned int getNrOfContacts() const { return _contacts.size(); }
+
+    /**
+     * @brief compute computes the poses of the contacts, J and dJ*nu
+     * @param base_link index of the floating base link, see getLinkIndex()
+     * @param world_T_base pose of the floating base link in world frame
+     * @param base_velocity velocity of the floating base in world frame, the linear
+     *        velocity being the one of the origin of base_link
+     * @param q joint positions
+     * @param dq joint velocities
+     * @param J a 6k x (6 + #DOFs) matrix (or block)
+     * @param dJ_nu a 6k vector (or block)
+     */
+    void compute(const int base_link,
+                 const KDL::Frame& world_T_base,
+                 const KDL::Twist& base_velocity,
+                 const Eigen::Ref<const Eigen::VectorXd>& q,
+                 const Eigen::Ref<const Eigen::VectorXd>& dq,
+                 Eigen::Ref<Eigen::MatrixXd> J,
+                 Eigen::Ref<Eigen::VectorXd> dJ_nu);
+
+    /**
+     * @brief computeBias computes the poses of the contacts and dJ*nu as compute(), without J
+     * @param dJ_nu a 6k vector (or block)
+     */
+    void computeBias(const int base_link,
+                     const KDL::Frame& world_T_base,
+                     const KDL::Twist& base_velocity,
+                     const Eigen::Ref<const Eigen::VectorXd>& q,
+                     const Eigen::Ref<const Eigen::VectorXd>& dq,
+                     Eigen::Ref<Eigen::VectorXd> dJ_nu);
+
+    /**
+     * @brief getPose
+     * @param contact the position of the contact in the vector given to setContacts()
+     * @return the pose of the contact in world frame, as computed by the last call to compute()
+     */
+    const KDL::Frame& getPose(const unsigned int contact) const { return _poses[_contacts[contact]]; }
+
+private:
+    double getJointPosition(const unsigned int segment, const Eigen::Ref<const Eigen::VectorXd>& q) const;
+
+    /**
+     * @brief isAncestor
+     * @return true if segment is on the path from the root to link (link included)
+     */
+    bool isAncestor(const unsigned int segment, const unsigned int link) const;
+
+    /**
+     * @brief updateActiveSegments lists the segments on the paths from the root
+     * to the contacts and to base_link, parents first
+     */
+    void updateActiveSegments(const int base_link);
+
+    /**
+     * @brief computeKinematics computes poses, motion subspaces, velocities and bias
+     * accelerations of the active segments
+     */
+    void computeKinematics(const int base_link,
+                           const KDL::Frame& world_T_base,
+                           const KDL::Twist& base_velocity,
+                           const Eigen::Ref<const Eigen::VectorXd>& q,
+                           const Eigen::Ref<const Eigen::VectorXd>& dq);
+
+    /**
+     * @brief computeBiasAccelerations writes dJ*nu of the contacts, after computeKinematics()
+     */
+    void computeBiasAccelerations(Eigen::Ref<Eigen::VectorXd> dJ_nu) const;
+
+    kinematic_tree _tree;
+    std::vector<char> _prismatic;
+    std::vector<int> _contacts;
+
+    /**
+     * @brief _active_segments the segments visited by compute(), for _active_base as floating base
+     */
+    std::vector<unsigned int> _active_segments;
+    std::vector<char> _active;
+    int _active_base;
+
+    /**
+     * @brief _poses, _motions, _velocities, _accelerations poses of the links, motion
+     * subspaces of their joints, velocities and bias accelerations, in world frame with
+     * the world origin as reference point
+     */
+    std::vector<KDL::Frame> _poses;
+    std::vector<KDL::Twist> _motions;
+    std::vector<KDL::Twist> _velocities;
+    std::vector<KDL::Twist> _accelerations;
+};
+
+}
+
+#endif
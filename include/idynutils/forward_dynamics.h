@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _FORWARD_DYNAMICS_H_
+#define _FORWARD_DYNAMICS_H_
+
+#include <idynutils/kinematic_tree.h>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <kdl/frames.hpp>
+#include <kdl/rigidbodyinertia.hpp>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The forward_dynamics class computes the dynamics of a floating base robot
+ * without building iDynTree models:
+ *  - the accelerations produced by the joint torques, in O(#links), with the
+ *    Articulated Body Algorithm (Featherstone, Rigid Body Dynamics Algorithms, 7.3 and 9.3)
+ *  - the (6+#DOFs) x (6+#DOFs) mass matrix M, in O(#links depth), with the
+ *    Composite Rigid Body Algorithm, to be factorized by idynutils::mass_matrix_factorization
+ * for nu = [linear velocity of the floating base origin; angular velocity of the floating base; dq],
+ * everything in world frame as in the Jacobians of iDynUtils, so that
+ *
+ *     M dnu/dt + h = [0; tau]
+ *
+ * The tree is never rooted again at the floating base: spatial quantities are expressed in world
+ * frame with the world origin as reference point, and the root of the tree moves so that the
+ * floating base has the given pose and velocity.
+ * All the buffers are allocated by the constructor.
+ */
+class forward_dynamics
+{
+public:
+    /**
+     * @brief forward_dynamics builds the flat representation of the tree
+     * @param tree the KDL tree of the robot, e.g. iDynUtils::getKDLTree()
+     * @param joint_names the names of the moving joints, in DOF order,
+     *        e.g. iDynUtils::getDOFNames()
+     */
+    forward_dynamics(const KDL::Tree& tree, const std::vector<std::string>& joint_names);
+
+    /**
+     * @brief getLinkIndex
+     * @param link a link name
+     * @return the index of the link, -1 if it does not exist
+     */
+    int getLinkIndex(const std::string& link) const;
+
+    unsigned int getNrOfDOFs() const { return _tree.getNrOfDOFs(); }
+
+    /**
+     * @brief computeAccelerations computes dnu/dt with the Articulated Body Algorithm
+     * @param base_link index of the floating base link, see getLinkIndex()
+     * @param world_T_base pose of the floating base link in world frame
+     * @param base_velocity velocity of the floating base in world frame, the linear
+     *        velocity being the one of the origin of base_link
+     * @param q joint positions
+     * @param dq joint velocities
+     * @param tau joint torques
+     * @param gravity acceleration of gravity in world frame, e.g. [0 0 -9.81]
+     * @param dnu a 6+#DOFs vector (or block), [linear acceleration of the origin of the
+     *        floating base; angular acceleration of the floating base; ddq]
+     */
+    void computeAccelerations(const int base_link,
+                              const KDL::Frame& world_T_base,
+                              const KDL::Twist& base_velocity,
+                              const Eigen::Ref<const Eigen::VectorXd>& q,
+                              const Eigen::Ref<const Eigen::VectorXd>& dq,
+                              const Eigen::Ref<const Eigen::VectorXd>& tau,
+                              const KDL::Vector& gravity,
+                              Eigen::Ref<Eigen::VectorXd> dnu);
+
+    /**
+     * @brief computeMassMatrix computes M with the Composite Rigid Body Algorithm
+     * @param base_link index of the floating base link, see getLinkIndex()
+     * @param world_T_base pose of the floating base link in world frame
+     * @param q joint positions
+     * @param M a (6+#DOFs) x (6+#DOFs) matrix (or block)
+     */
+    void computeMassMatrix(const int base_link,
+                           const KDL::Frame& world_T_base,
+                           const Eigen::Ref<const Eigen::VectorXd>& q,
+                           Eigen::Ref<Eigen::MatrixXd> M);
+
+private:
+    typedef Eigen::Matrix<double, 6, 1> Vector6d;
+    typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+
+    double getJointPosition(const unsigned int segment, const Eigen::Ref<const Eigen::VectorXd>& q) const;
+
+    /**
+     * @brief updatePoses computes the poses of the links and the motion subspaces of the joints
+     */
+    void updatePoses(const int base_link,
+                     const KDL::Frame& world_T_base,
+                     const Eigen::Ref<const Eigen::VectorXd>& q);
+
+    kinematic_tree _tree;
+    std::vector<char> _prismatic;
+
+    /**
+     * @brief _carriers the carriers of the DOFs for _carriers_base as floating base
+     */
+    std::vector<int> _carriers;
+    int _carriers_base;
+
+    /**
+     * @brief _poses, _motions, _velocities, _bias_accelerations poses of the links, motion
+     * subspaces of their joints, velocities and velocity product accelerations of the joints,
+     * in world frame with the world origin as reference point
+     */
+    std::vector<KDL::Frame> _poses;
+    std::vector<KDL::Twist> _motions;
+    std::vector<KDL::Twist> _velocities;
+    std::vector<KDL::Twist> _bias_accelerations;
+
+    /**
+     * @brief _inertias inertias of the links, composite inertias after computeMassMatrix(),
+     * _articulated_inertias and _bias_forces articulated inertias and bias forces
+     */
+    std::vector<KDL::RigidBodyInertia> _inertias;
+    std::vector<Matrix6d, Eigen::aligned_allocator<Matrix6d> > _articulated_inertias;
+    std::vector<Vector6d, Eigen::aligned_allocator<Vector6d> > _bias_forces;
+
+    /**
+     * @brief _U, _D, _u and _accelerations as in the Articulated Body Algorithm
+     */
+    std::vector<Vector6d, Eigen::aligned_allocator<Vector6d> > _U;
+    std::vector<double> _D;
+    std::vector<double> _u;
+    std::vector<Vector6d, Eigen::aligned_allocator<Vector6d> > _accelerations;
+};
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _GENERATED_KINEMATICS_H_
+#define _GENERATED_KINEMATICS_H_
+
+#include <Eigen/Dense>
+#include <kdl/frames.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The generated_kinematics class is the base of the forward kinematics generated
+ * by idynutils_codegen for a given urdf and srdf. The generated subclass implements
+ * computePoses() with the tree traversal unrolled at compile time: constant joint
+ * origins are written as literals, null and unit coefficients of the rotations are
+ * removed and joints about the x, y, z axes of their frame only touch two columns.
+ * This class holds the topology tables (in the depth-first order of kinematic_tree)
+ * and computes Jacobians from the generated poses.
+ *
+ * Poses are expressed in the root frame of the KDL tree. A generated kinematics can be
+ * plugged in iDynUtils through iDynUtils::setGeneratedKinematics().
+ */
+class generated_kinematics
+{
+public:
+    enum joint_type
+    {
+        FIXED = 0,
+        REVOLUTE,
+        PRISMATIC
+    };
+
+    virtual ~generated_kinematics();
+
+    /**
+     * @brief clone
+     * @return a copy of this kinematics, owned by the caller
+     */
+    virtual generated_kinematics* clone() const = 0;
+
+    /**
+     * @brief getModelHash
+     * @return the hash of the urdf and srdf the code has been generated from,
+     * see model_cache::computeHash()
+     */
+    uint64_t getModelHash() const { return _model_hash; }
+
+    unsigned int getNrOfLinks() const { return _nr_of_links; }
+    unsigned int getNrOfDOFs() const { return _nr_of_dofs; }
+
+    /**
+     * @brief getLinkIndex
+     * @param link a link name
+     * @return the index of the link, -1 if it does not exist
+     */
+    int getLinkIndex(const std::string& link) const;
+
+    const char* getLinkName(const unsigned int link) const { return _link_names[link]; }
+
+    /**
+     * @brief setJointPositions computes the poses of all the links and the CoM
+     * @param q joint positions, in iDynTree order
+     */
+    void setJointPositions(const Eigen::Ref<const Eigen::VectorXd>& q);
+    void setJointPositions(const double* q);
+
+    /**
+     * @brief getPose
+     * @param link a valid link index
+     * @return the pose of link in the root frame
+     */
+    const KDL::Frame& getPose(const int link) const { return _poses[link]; }
+
+    /**
+     * @brief getCOM
+     * @return the CoM of the robot in the root frame
+     */
+    const KDL::Vector& getCOM() const { return _com; }
+
+    /**
+     * @brief getJacobian computes the Jacobian of the origin of link, [linear; angular]
+     * velocity in the root frame, without floating base columns
+     * @param link a valid link index
+     * @param J a 6 x #DOFs preallocated matrix
+     */
+    void getJacobian(const int link, Eigen::Ref<Eigen::MatrixXd> J) const;
+
+protected:
+    /**
+     * @brief generated_kinematics
+     * @param model_hash hash of the urdf and srdf
+     * @param nr_of_links number of links, root included
+     * @param nr_of_dofs number of DOFs
+     * @param link_names name of every link
+     * @param parents parent of every link, -1 for the root
+     * @param dofs DOF of every link, -1 for fixed joints
+     * @param joint_types joint_type of every link
+     * @param axes joint axis of every link, in the link frame
+     */
+    generated_kinematics(const uint64_t model_hash,
+                         const unsigned int nr_of_links,
+                         const unsigned int nr_of_dofs,
+                         const char* const* link_names,
+                         const int* parents,
+                         const int* dofs,
+                         const int* joint_types,
+                         const double (*axes)[3]);
+
+    /**
+     * @brief computePoses is implemented by the generated code
+     * @param q joint positions
+     * @param T the poses of the links, T[0] (root) is the identity
+     * @param com the CoM of the robot
+     */
+    virtual void computePoses(const double* q, KDL::Frame* T, KDL::Vector& com) const = 0;
+
+private:
+    uint64_t _model_hash;
+    unsigned int _nr_of_links;
+    unsigned int _nr_of_dofs;
+    const char* const* _link_names;
+    const int* _parents;
+    const int* _dofs;
+    const int* _joint_types;
+    const double (*_axes)[3];
+
+    std::vector<KDL::Frame> _poses;
+    KDL::Vector _com;
+};
+
+}
+
+#endif
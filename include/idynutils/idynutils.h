@@ -32,6 +32,14 @@
 #include <moveit_msgs/DisplayRobotState.h>
 #include <yarp/math/Math.h>
 #include <yarp/sig/all.h>
+#include <idynutils/centroidal_dynamics.h>
+#include <idynutils/contact_kinematics.h>
+#include <idynutils/forward_dynamics.h>
+#include <idynutils/generated_kinematics.h>
+#include <idynutils/mass_matrix_factorization.h>
+#include <idynutils/rt_error_ring.h>
+#include <idynutils/stage_profiler.h>
+#include <idynutils/support_polygon.h>
 #ifdef RVIZ_DOES_NOT_TRANSFORM_OCTOMAP
 #include <idynutils/octomap_utils.h>
 #endif
@@ -53,6 +61,22 @@ public:
 
     }
 
+    /**
+     * @brief kinematic_chain copy constructor, index refers to the end_effector_index of the copy
+     * @param k the kinematic chain to copy
+     */
+    kinematic_chain(const kinematic_chain& k) :
+        chain_name(k.chain_name),
+        end_effector_name(k.end_effector_name),
+        joint_names(k.joint_names),
+        fixed_joint_names(k.fixed_joint_names),
+        end_effector_index(k.end_effector_index),
+        index(end_effector_index),
+        joint_numbers(k.joint_numbers)
+    {
+
+    }
+
     /**
      * @brief getNrOfDOFs return # of dofs of the kinematic chain
      * @return # of dofs of the kinematic chain
@@ -99,6 +123,44 @@ public:
   }
 };
 
+class iDynUtils;
+
+namespace idynutils {
+class model_cache;
+}
+
+/**
+ * @brief The LinkHandle class identifies a link of the model, resolved once by name
+ * through iDynUtils::getLinkHandle(). Queries by handle do not perform any string lookup.
+ * A default constructed handle is not valid.
+ */
+class LinkHandle
+{
+public:
+    LinkHandle() : _index(-1) {}
+
+    /**
+     * @brief isValid
+     * @return true if the handle refers to a link of the model
+     */
+    bool isValid() const { return _index >= 0; }
+
+    /**
+     * @brief getIndex
+     * @return the iDyn3_model link index of the handle, -1 if the handle is not valid
+     */
+    int getIndex() const { return _index; }
+
+    bool operator==(const LinkHandle& other) const { return _index == other._index; }
+    bool operator!=(const LinkHandle& other) const { return _index != other._index; }
+
+private:
+    friend class iDynUtils;
+    explicit LinkHandle(const int index) : _index(index) {}
+
+    int _index;
+};
+
 class iDynUtils
 {
 public:
@@ -134,10 +196,62 @@ public:
      *   e.g. /home/enrico/my_robot/my_robot_urdf/my_robot.urdf
      * @param srdf_path is the path to the srdf file
      *   e.g. /home/enrico/my_robot/my_robot_srdf/my_robot.srdf
+     * @param model_cache_path is the (optional) path to a binary model cache, see idynutils::model_cache.
+     *   If the cache exists and was built from the same urdf and srdf, joint ordering, kinematic chains,
+     *   sensors and joint limits are read from it instead of being computed; otherwise they are computed
+     *   and the cache is (re)written. Parsing the urdf and srdf is still needed to build the
+     *   iDynTree and MoveIt models.
+     * @param lazy_planning_scene if true, the MoveIt planning scene (and the collision robot) is not
+     *   built at construction time, but on the first collision checking, occupancy map or display
+     *   call, or explicitly through initPlanningScene(). Models used only for kinematics and dynamics
+     *   never pay for it. Until then, moveit_planning_scene and moveit_collision_robot are NULL.
      */
     iDynUtils(const std::string robot_name_,
               const std::string urdf_path,
-              const std::string srdf_path);
+              const std::string srdf_path,
+              const std::string model_cache_path = "",
+              const bool lazy_planning_scene = false);
+
+    /**
+     * @brief isModelLoadedFromCache
+     * @return true if the model information has been read from the binary model cache
+     */
+    bool isModelLoadedFromCache() const;
+
+    /**
+     * @brief initPlanningScene builds the MoveIt planning scene and collision robot,
+     * if they have not been built yet. It is needed only before accessing
+     * moveit_planning_scene or moveit_collision_robot directly on a model constructed
+     * with lazy_planning_scene, the iDynUtils methods using the scene call it automatically.
+     */
+    void initPlanningScene();
+
+    /**
+     * @brief isPlanningSceneInited
+     * @return true if the MoveIt planning scene has been built
+     */
+    bool isPlanningSceneInited() const;
+
+    /**
+     * @brief iDynUtils copy constructor. The immutable parts of the model
+     * (urdf and srdf models, MoveIt robot model and collision geometries) are shared
+     * with other, while the iDynTree model, the MoveIt planning scene (if other has built it,
+     * see initPlanningScene()) and all the state (joint values, world pose, anchor, links in contact, ...) are copied, so that
+     * the copy can be used independently from other (e.g. in a different thread).
+     * No urdf/srdf parsing and no MoveIt robot model construction take place.
+     * @param other the iDynUtils to copy
+     * @param copy_planning_scene if false the planning scene of other is not copied, and the copy
+     *        builds a new one (without the collision objects of other) only if it checks collisions
+     */
+    iDynUtils(const iDynUtils& other, const bool copy_planning_scene = true);
+
+    /**
+     * @brief clone creates a copy of this iDynUtils sharing the immutable robot model,
+     * see iDynUtils(const iDynUtils& other, const bool copy_planning_scene)
+     * @param copy_planning_scene false if the copy does not need the planning scene of this
+     * @return a pointer to the copy
+     */
+    boost::shared_ptr<iDynUtils> clone(const bool copy_planning_scene = true) const;
 
     kinematic_chain left_leg, left_arm,right_leg,right_arm,torso,head;
     iCub::iDynTree::DynTree iDyn3_model;
@@ -165,6 +279,59 @@ public:
      */
     KDL::Vector getCoM(const std::string& link = "world");
 
+    /**
+     * @brief getLinkHandle resolves a link name into a LinkHandle, to be used
+     * with the handle based queries
+     * @param link the link name
+     * @return a LinkHandle, which is not valid if the link does not exists in the model
+     */
+    LinkHandle getLinkHandle(const std::string& link) const;
+
+    /**
+     * @brief getPose return the pose of second_link expressed in first_link
+     * @param first_link
+     * @param second_link
+     * @return a matrix of zeros if one of the two handles is not valid
+     */
+    KDL::Frame getPose(const LinkHandle& first_link, const LinkHandle& second_link);
+
+    /**
+     * @brief getPose return the pose of link expressed in world frame
+     * @param link
+     * @return a matrix of zeros if the handle is not valid
+     */
+    KDL::Frame getPose(const LinkHandle& link);
+
+    /**
+     * @brief getCoM return the position of the CoM expressed in link frame
+     * @param link
+     * @return a vector of zeros if the handle is not valid
+     */
+    KDL::Vector getCoM(const LinkHandle& link);
+
+    /**
+     * @brief getPoses computes the poses of a set of links expressed in world frame.
+     * Link positions are computed once for the whole tree and the poses are written
+     * directly into the caller owned array, without temporaries.
+     * @param links the links
+     * @param poses an array of (at least) links.size() matrices. Notice that
+     * std containers of Eigen::Matrix4d need an Eigen::aligned_allocator
+     * @return false if one of the handles is not valid (its pose is set to a matrix of zeros)
+     */
+    bool getPoses(const std::vector<LinkHandle>& links, Eigen::Matrix4d* poses);
+
+    /**
+     * @brief getPoses computes the poses of a set of links expressed in reference_link frame.
+     * @param links the links
+     * @param reference_link the frame in which the poses are expressed
+     * @param poses an array of (at least) links.size() matrices
+     * @return false if reference_link or one of the handles is not valid
+     * (the corresponding poses are set to a matrix of zeros)
+     */
+    bool getPoses(const std::vector<LinkHandle>& links,
+                  const LinkHandle& reference_link,
+                  Eigen::Matrix4d* poses);
+
     /**
      * @brief getNrOfFTSensors return # of FT sensors in the model
      * @return # of FT sensors in the model
@@ -199,7 +366,25 @@ public:
     yarp::sig::Vector fromJointStateMsgToiDyn(const sensor_msgs::JointStateConstPtr& msg);
 
     /**
-     * @brief updateiDyn3ModelFromJoinStateMsg updates the internal joint state using a ROS joint state msg
+     * @brief fromJointStateMsgToiDyn scatters positions, velocities and efforts of a joint state msg
+     * into caller preallocated vectors, in iDynTree order. Entries of joints which are not in the msg,
+     * and velocities or efforts when the msg does not carry them, are left untouched.
+     * The mapping from msg names to iDynTree DOFs is computed once and reused as long as the
+     * msg names do not change, so that no string lookups take place
+     * @param msg the joint state msg
+     * @param q joint positions
+     * @param dq joint velocities
+     * @param tau joint efforts
+     */
+    void fromJointStateMsgToiDyn(const sensor_msgs::JointStateConstPtr& msg,
+                                 Eigen::Ref<Eigen::VectorXd> q,
+                                 Eigen::Ref<Eigen::VectorXd> dq,
+                                 Eigen::Ref<Eigen::VectorXd> tau);
+
+    /**
+     * @brief updateiDyn3ModelFromJoinStateMsg updates the internal joint state using a ROS joint state msg.
+     * Joint velocities are taken from the msg when present, zero otherwise.
+     * No heap allocation and, as long as the msg names do not change, no string lookup take place.
      * @param msg the joint state msg
      */
     void updateiDyn3ModelFromJoinStateMsg(const sensor_msgs::JointStateConstPtr& msg);
@@ -212,7 +397,7 @@ public:
      */
     void updateiDyn3Model(const yarp::sig::Vector& q,
                           const bool set_world_pose = false);
-    void updateiDyn3Model(const Eigen::VectorXd& q,
+    void updateiDyn3Model(const Eigen::Ref<const Eigen::VectorXd>& q,
                           const bool set_world_pose = false);
         
     /**
@@ -226,6 +411,7 @@ public:
      *     dynamicRNEA() that will overwrite the internal vector of measurement. For
      *     this reason we first call the calssical updateiDyn3Model() and then we
      *     call updateForceTorqueMeasurement() taht will set the FT measurements.
+     *     In lazy mode the dynamics is computed before setting the FT measurements.
      */
     void updateiDyn3Model(const yarp::sig::Vector &q,
                           const std::vector<ft_measure> &force_torque_measurement,
@@ -241,8 +427,8 @@ public:
     void updateiDyn3Model(const yarp::sig::Vector& q,
                           const yarp::sig::Vector& dq,
                           const bool set_world_pose = false);
-    void updateiDyn3Model(const Eigen::VectorXd& q,
-                          const Eigen::VectorXd& dq,
+    void updateiDyn3Model(const Eigen::Ref<const Eigen::VectorXd>& q,
+                          const Eigen::Ref<const Eigen::VectorXd>& dq,
                           const bool set_world_pose = false);
 
     /**
@@ -257,6 +443,7 @@ public:
      *     dynamicRNEA() that will overwrite the internal vector of measurement. For
      *     this reason we first call the calssical updateiDyn3Model() and then we
      *     call updateForceTorqueMeasurement() taht will set the FT measurements.
+     *     In lazy mode the dynamics is computed before setting the FT measurements.
      */
     void updateiDyn3Model(const yarp::sig::Vector &q,
                           const yarp::sig::Vector& dq,
@@ -278,9 +465,19 @@ public:
                           const yarp::sig::Vector& dq,
                           const yarp::sig::Vector& ddq,
                           const bool set_world_pose = false);
-    void updateiDyn3Model(const Eigen::VectorXd& q,
-                          const Eigen::VectorXd& dq,
-                          const Eigen::VectorXd& ddq,
+
+    /**
+     * @brief updateiDyn3Model updates the underlying robot model (uses both Kinematic and Dynamic RNEA)
+     * The Eigen inputs are copied into preallocated internal buffers, so that (apart from what
+     * iDynTree does internally) no heap allocation takes place at each update.
+     * @param q robot configuration
+     * @param dq robot joint velocities
+     * @param ddq robot joint accelerations
+     * @param set_world_pose do we update the base link pose wrt the world frame?
+     */
+    void updateiDyn3Model(const Eigen::Ref<const Eigen::VectorXd>& q,
+                          const Eigen::Ref<const Eigen::VectorXd>& dq,
+                          const Eigen::Ref<const Eigen::VectorXd>& ddq,
                           const bool set_world_pose = false);
 
     /**
@@ -296,6 +493,7 @@ public:
      *     dynamicRNEA() that will overwrite the internal vector of measurement. For
      *     this reason we first call the calssical updateiDyn3Model() and then we
      *     call updateForceTorqueMeasurement() taht will set the FT measurements.
+     *     In lazy mode the dynamics is computed before setting the FT measurements.
      */
     void updateiDyn3Model(const yarp::sig::Vector &q,
                           const yarp::sig::Vector& dq,
@@ -307,7 +505,7 @@ public:
     boost::shared_ptr<urdf::Model> urdf_model; // A URDF Model
     boost::shared_ptr<srdf::Model> robot_srdf; // A SRDF description
     robot_model::RobotModelConstPtr moveit_robot_model; // A robot model
-    planning_scene::PlanningScenePtr moveit_planning_scene; // the moveit scene
+    planning_scene::PlanningScenePtr moveit_planning_scene; // the moveit scene, see initPlanningScene()
 
     collision_detection::CollisionRobotPtr moveit_collision_robot;
 
@@ -319,6 +517,20 @@ public:
 
     const std::vector<std::string> &getFixedJointNames() const;
 
+    /**
+     * @brief getDOFNames return the names of the active joints in iDynTree DOF order, i.e. the
+     * joint of element i of the joint vectors (getAng(), updateiDyn3Model(), ...).
+     * Notice getJointNames() follows the MoveIt joint models order, which may be different
+     * @return a vector with the joint name of every DOF
+     */
+    const std::vector<std::string> &getDOFNames() const;
+
+    /**
+     * @brief getKDLTree return the KDL tree built from the urdf
+     * @return the KDL tree of the robot
+     */
+    const KDL::Tree& getKDLTree() const;
+
     yarp::sig::Vector zeros;
     Eigen::VectorXd zerosXd;
 
@@ -337,6 +549,16 @@ public:
      */
     bool switchAnchor(const std::string& new_anchor);
 
+    /**
+     * @brief setAnchorCandidates sets the links the anchor is going to be switched to, e.g. both
+     * soles of a walking robot. Their transforms to the world frame are cached, and updated
+     * together with the world pose by updateiDyn3Model(..., true): switching the anchor
+     * (and floating base) to a candidate then does not compute any kinematics.
+     * @param anchors the names of the candidate links
+     * @return false if one of the links does not exist, in which case no candidate is set
+     */
+    bool setAnchorCandidates(const std::vector<std::string>& anchors);
+
     /**
      * @brief getAnchor returns the name of the anchor frame (the body frame that does not vary
      * w.r.t. the world frame while performing the current robot motion). The anchor name corresponds
@@ -422,10 +644,68 @@ public:
    bool getSupportPolygonPoints(std::list<KDL::Vector>& points,
                                 const std::string referenceFrame = "COM");
 
+   /**
+    * @brief getSupportPolygonPoints as above, but the points are written into a fixed capacity
+    * buffer, the links in contact and the reference link are not looked up by name at every call
+    * and the CoM is computed by the centroidal dynamics, so that no memory gets allocated.
+    * @param points the points, previous content gets cleared
+    * @param referenceFrame "COM", "world" or {linkName}
+    * @return false if the vector of reference frames is empty, the reference frame does not exist
+    * or there are more links in contact than support_polygon::MAX_POINTS
+    */
+   bool getSupportPolygonPoints(idynutils::support_polygon& points,
+                                const std::string& referenceFrame = "COM");
+
    const std::list<std::string>& getLinksInContact();
 
    void setLinksInContact(const std::list<std::string>& list_links_in_contact);
 
+   /**
+    * @brief getContactKinematics computes, in a single pass over the kinematic tree, the stacked
+    * Jacobian, its bias acceleration and the poses of the links in contact, in the order of
+    * getLinksInContact(), so that the velocities v and accelerations of the k links in contact are
+    * v = J nu and dv/dt = J dnu/dt + dJ*nu, with nu = [floating base velocity; dq] as in getJacobian().
+    * The links in contact are resolved by setLinksInContact(), not at each call.
+    * See idynutils::contact_kinematics.
+    * @param J a 6k x (6+#DOFs) matrix (or block), each 6 rows being the Jacobian of a link in contact
+    * @param dJ_nu a 6k vector (or block)
+    * @param poses k poses of the links in contact in world frame, can be NULL
+    * @param base_velocity velocity of the floating base in world frame, [linear velocity of its
+    * origin; angular velocity]. The model keeps the floating base still, so it is null by default
+    * @return false if there are no links in contact or the floating base link is not a link of the KDL tree
+    */
+   bool getContactKinematics(Eigen::Ref<Eigen::MatrixXd> J,
+                             Eigen::Ref<Eigen::VectorXd> dJ_nu,
+                             Eigen::Matrix4d* poses = NULL,
+                             const KDL::Twist& base_velocity = KDL::Twist::Zero());
+
+   /**
+    * @brief getBiasAcceleration computes analytically, in a single pass over the path from the root
+    * to the link, the bias acceleration dJ*nu of a link at the current joint positions and velocities,
+    * i.e. its acceleration when dnu/dt = 0, with J the Jacobian of getJacobian().
+    * See idynutils::contact_kinematics.
+    * @param link the link
+    * @param dJ_nu a 6 vector (or block), [acceleration of the origin of the link; angular acceleration]
+    * in world frame
+    * @param base_velocity velocity of the floating base in world frame, [linear velocity of its
+    * origin; angular velocity]. The model keeps the floating base still, so it is null by default
+    * @return false if the link or the floating base link is not a link of the KDL tree
+    */
+   bool getBiasAcceleration(const LinkHandle& link,
+                            Eigen::Ref<Eigen::VectorXd> dJ_nu,
+                            const KDL::Twist& base_velocity = KDL::Twist::Zero());
+
+   /**
+    * @brief getCOMBiasAcceleration computes analytically the bias acceleration dJCoM*nu of the CoM,
+    * from the rate of change of the linear momentum dA*dq of getCentroidalMomentumMatrix(),
+    * without computing A
+    * @param dJCoM_nu a 3 vector (or block), in world frame
+    * @param base_velocity as in getBiasAcceleration()
+    * @return false if the floating base link is not a link of the KDL tree
+    */
+   bool getCOMBiasAcceleration(Eigen::Ref<Eigen::VectorXd> dJCoM_nu,
+                               const KDL::Twist& base_velocity = KDL::Twist::Zero());
+
    /**
     * @brief checkCollisionWithWorld checks whether the robot is in collision with the environment
     * @return true if the robot is in collision with the environment
@@ -579,10 +859,71 @@ public:
    void disableDynamicsUpdate();
 
    bool getJacobian(const int distal_link_index, Eigen::MatrixXd& J);
+   bool getJacobian(const LinkHandle& distal_link, Eigen::MatrixXd& J);
    bool getRelativeJacobian(const int distal_link_index,
                             const int base_link_index,
                             Eigen::MatrixXd& J,
                             bool global=false);
+   bool getRelativeJacobian(const LinkHandle& distal_link,
+                            const LinkHandle& base_link,
+                            Eigen::MatrixXd& J,
+                            bool global=false);
+
+   /**
+    * @brief getJacobian writes the 6 x (6+#DOFs) Jacobian of distal_link_index
+    * into caller preallocated storage (e.g. a block of a bigger matrix), without temporaries
+    * @param distal_link_index
+    * @param J a 6 x (6+#DOFs) matrix (or block)
+    * @return false if the Jacobian could not be computed
+    */
+   bool getJacobian(const int distal_link_index, Eigen::Ref<Eigen::MatrixXd> J);
+   bool getJacobian(const LinkHandle& distal_link, Eigen::Ref<Eigen::MatrixXd> J);
+
+   /**
+    * @brief getJacobian writes into caller preallocated storage only the columns
+    * of the Jacobian of distal_link_index relative to the joints of chain
+    * @param distal_link_index
+    * @param chain the kinematic chain whose columns are extracted
+    * @param J a 6 x chain.getNrOfDOFs() matrix (or block)
+    * @return false if the Jacobian could not be computed
+    */
+   bool getJacobian(const int distal_link_index,
+                    const kinematic_chain& chain,
+                    Eigen::Ref<Eigen::MatrixXd> J);
+
+   /**
+    * @brief getRelativeJacobian writes the 6 x #DOFs relative Jacobian
+    * into caller preallocated storage, without temporaries
+    * @param distal_link_index
+    * @param base_link_index
+    * @param J a 6 x #DOFs matrix (or block)
+    * @param global
+    * @return false if the Jacobian could not be computed
+    */
+   bool getRelativeJacobian(const int distal_link_index,
+                            const int base_link_index,
+                            Eigen::Ref<Eigen::MatrixXd> J,
+                            bool global=false);
+   bool getRelativeJacobian(const LinkHandle& distal_link,
+                            const LinkHandle& base_link,
+                            Eigen::Ref<Eigen::MatrixXd> J,
+                            bool global=false);
+
+   /**
+    * @brief getRelativeJacobian writes into caller preallocated storage only the columns
+    * of the relative Jacobian relative to the joints of chain
+    * @param distal_link_index
+    * @param base_link_index
+    * @param chain the kinematic chain whose columns are extracted
+    * @param J a 6 x chain.getNrOfDOFs() matrix (or block)
+    * @param global
+    * @return false if the Jacobian could not be computed
+    */
+   bool getRelativeJacobian(const int distal_link_index,
+                            const int base_link_index,
+                            const kinematic_chain& chain,
+                            Eigen::Ref<Eigen::MatrixXd> J,
+                            bool global=false);
 
    Eigen::MatrixXd getPosition(const int link_index, bool inverse = false);
    Eigen::MatrixXd getPosition(const int first_link, const int second_link);
@@ -591,6 +932,64 @@ public:
    Eigen::VectorXd getVelCOM();
    Eigen::VectorXd getCentroidalMomentum();
 
+   /**
+    * @brief getCentroidalMomentumMatrix computes, in O(#links), the centroidal momentum matrix A
+    * and the bias term dA*dq at the current joint positions and velocities, so that
+    * h = A nu and dh/dt = A dnu/dt + dA*dq, h = [linear momentum; angular momentum about the CoM]
+    * in world frame and nu = [floating base velocity; dq] as in getJacobian().
+    * See idynutils::centroidal_dynamics.
+    * @param A a 6 x (6+#DOFs) matrix (or block)
+    * @param dA_dq a 6 vector (or block)
+    * @param base_velocity velocity of the floating base in world frame, [linear velocity of its
+    * origin; angular velocity]. The model keeps the floating base still, so it is null by default
+    * @return false if the floating base link is not a link of the KDL tree
+    */
+   bool getCentroidalMomentumMatrix(Eigen::Ref<Eigen::MatrixXd> A,
+                                    Eigen::Ref<Eigen::VectorXd> dA_dq,
+                                    const KDL::Twist& base_velocity = KDL::Twist::Zero());
+
+   /**
+    * @brief getForwardDynamics computes, in O(#links), the accelerations produced by the joint
+    * torques tau and gravity at the current joint positions and velocities, with the Articulated
+    * Body Algorithm. No external wrench acts on the robot, i.e. the floating base is free.
+    * See idynutils::forward_dynamics.
+    * @param tau joint torques
+    * @param dnu a 6+#DOFs vector (or block), dnu/dt with nu = [floating base velocity; dq]
+    * as in getJacobian()
+    * @param base_velocity velocity of the floating base in world frame, [linear velocity of its
+    * origin; angular velocity]. The model keeps the floating base still, so it is null by default
+    * @return false if the floating base link is not a link of the KDL tree
+    */
+   bool getForwardDynamics(const Eigen::Ref<const Eigen::VectorXd>& tau,
+                           Eigen::Ref<Eigen::VectorXd> dnu,
+                           const KDL::Twist& base_velocity = KDL::Twist::Zero());
+
+   /**
+    * @brief getMassMatrix computes, in O(#links * depth of the tree) and without iDynTree, the
+    * mass matrix M at the current joint positions with the Composite Rigid Body Algorithm, for
+    * nu = [floating base velocity; dq] as in getJacobian() and getForwardDynamics().
+    * See idynutils::forward_dynamics.
+    * @param M a (6+#DOFs) x (6+#DOFs) matrix (or block)
+    * @return false if the floating base link is not a link of the KDL tree
+    */
+   bool getMassMatrix(Eigen::Ref<Eigen::MatrixXd> M);
+
+   /**
+    * @brief factorizeMassMatrix computes M with getMassMatrix() and factorizes it exploiting
+    * the branches of the tree, see idynutils::mass_matrix_factorization
+    * @return false if the floating base link is not a link of the KDL tree or M is not
+    * positive definite
+    */
+   bool factorizeMassMatrix();
+
+   /**
+    * @brief solveMassMatrix computes M^-1 X in place, in O(#DOFs * depth of the tree) per column,
+    * M being the mass matrix of the last factorizeMassMatrix()
+    * @param X a (6+#DOFs) x k matrix (or block)
+    * @return false if the last factorizeMassMatrix() failed or was never called
+    */
+   bool solveMassMatrix(Eigen::Ref<Eigen::MatrixXd> X) const;
+
    Eigen::VectorXd getJointBoundMin();
    Eigen::VectorXd getJointBoundMax();
 
@@ -599,12 +998,52 @@ public:
    Eigen::VectorXd getAng();
    Eigen::VectorXd getDAng();
 
+   /**
+    * @brief getJointBoundMin, getJointBoundMax and getJointTorqueMax write the joint limits
+    * into caller preallocated storage. In real-time mode they read the limits saved by warmup()
+    * @param bound a #DOFs vector (or block)
+    */
+   void getJointBoundMin(Eigen::Ref<Eigen::VectorXd> bound);
+   void getJointBoundMax(Eigen::Ref<Eigen::VectorXd> bound);
+   void getJointTorqueMax(Eigen::Ref<Eigen::VectorXd> tau_max);
+
+   /**
+    * @brief getTorques writes the joint torques into caller preallocated storage
+    * @param tau a #DOFs vector (or block)
+    */
+   void getTorques(Eigen::Ref<Eigen::VectorXd> tau);
+
+   /**
+    * @brief getAng and getDAng write the joint positions and velocities of iDyn3_model, as
+    * getAng() and getDAng(), into caller preallocated storage. In real-time mode they do not
+    * query iDynTree, returning the ones last set through updateiDyn3Model() or setAng()
+    * @param q a #DOFs vector (or block)
+    */
+   void getAng(Eigen::Ref<Eigen::VectorXd> q) const;
+   void getDAng(Eigen::Ref<Eigen::VectorXd> dq) const;
+
    Eigen::VectorXd setAng(const Eigen::VectorXd& q);
 
    bool getFloatingBaseMassMatrix(Eigen::MatrixXd & fb_mass_matrix);
 
+   /**
+    * @brief getFloatingBaseMassMatrix writes the (6+#DOFs) x (6+#DOFs) mass matrix
+    * into caller preallocated storage, without temporaries
+    * @param fb_mass_matrix a (6+#DOFs) x (6+#DOFs) matrix (or block)
+    * @return false if the mass matrix could not be computed
+    */
+   bool getFloatingBaseMassMatrix(Eigen::Ref<Eigen::MatrixXd> fb_mass_matrix);
+
    bool getCOMJacobian(Eigen::MatrixXd& JCoM);
 
+   /**
+    * @brief getCOMJacobian writes the CoM Jacobian into caller preallocated storage,
+    * without temporaries
+    * @param JCoM a matrix (or block) of the size of the iDynTree CoM Jacobian
+    * @return false if the Jacobian could not be computed
+    */
+   bool getCOMJacobian(Eigen::Ref<Eigen::MatrixXd> JCoM);
+
    bool getSensorMeasurement(const int sensor_index, Eigen::VectorXd &ftm);
 
 
@@ -616,12 +1055,158 @@ public:
     */
    void enableDynamicsUpdate();
 
+   /**
+    * @brief enableLazyUpdate enables the lazy update of the model: after enabling it, updateiDyn3Model
+    * only sets q, dq, ddq (and the world pose, if requested) and marks the computed quantities as dirty.
+    * Kinematic RNEA, dynamic RNEA and link positions are then computed on demand by the getters
+    * of this class (getPose, getJacobian, getTorques, getCOM, getFloatingBaseMassMatrix, ...),
+    * only for the stages they need and only once per state change.
+    * Notice that in lazy mode dynamics is computed whenever it is requested by a getter,
+    * regardless of disableDynamicsUpdate().
+    * Notice also that quantities read directly from iDyn3_model are NOT updated by the lazy mode:
+    * use the getters of this class, or disable the lazy mode to go back to the usual behavior.
+    */
+   void enableLazyUpdate();
+
+   /**
+    * @brief disableLazyUpdate disables the lazy update of the model (default behavior), computing
+    * all the pending stages so that iDyn3_model is up to date
+    */
+   void disableLazyUpdate();
+
+   /**
+    * @brief isLazyUpdateEnabled
+    * @return true if the lazy update of the model is enabled
+    */
+   bool isLazyUpdateEnabled() const;
+
+   /**
+    * @brief The profiled_stage enum lists the stages timed by the profiler of iDynUtils.
+    * PROFILE_UPDATE_MODEL is the whole updateiDyn3Model, which includes the world pose, IMU,
+    * gravity, RNEA and positions stages when they are not computed lazily.
+    */
+   enum profiled_stage
+   {
+       PROFILE_UPDATE_MODEL = 0,
+       PROFILE_WORLD_POSE,
+       PROFILE_IMU_ORIENTATION,
+       PROFILE_GRAVITY,
+       PROFILE_KINEMATIC_RNEA,
+       PROFILE_DYNAMIC_RNEA,
+       PROFILE_COMPUTE_POSITIONS,
+       PROFILE_ROBOT_STATE,
+       PROFILE_SELF_COLLISION,
+       PROFILE_WORLD_COLLISION
+   };
+
+   /**
+    * @brief getProfiler returns the timing statistics of the stages in profiled_stage, e.g.
+    *
+    *     robot.getProfiler().getStatistics(iDynUtils::PROFILE_KINEMATIC_RNEA).p99
+    *     robot.getProfiler().dump("/tmp/idynutils_timings.txt");
+    *
+    * Samples are recorded only if idynutils has been built with IDYNUTILS_ENABLE_PROFILING,
+    * otherwise the instrumentation compiles to nothing and all the statistics stay zero.
+    * Copies of iDynUtils start with an empty profiler.
+    */
+   idynutils::stage_profiler& getProfiler();
+   const idynutils::stage_profiler& getProfiler() const;
+
+   /**
+    * @brief setGeneratedKinematics makes getPose() and getCoM("world") use the forward kinematics
+    * generated by idynutils_codegen for this robot instead of iDynTree, e.g.
+    *
+    *     robot.setGeneratedKinematics(boost::shared_ptr<idynutils::generated_kinematics>(
+    *                                      new idynutils::bigman_generated_kinematics()));
+    *
+    * The generated kinematics is evaluated on the first query after each update.
+    * Jacobians, dynamics and the other getters keep using iDynTree. Since a non-lazy
+    * updateiDyn3Model still computes all the iDynTree positions, the generated
+    * kinematics pays off together with enableLazyUpdate().
+    * @param kinematics the generated kinematics, a NULL pointer goes back to iDynTree
+    * @return false if kinematics has been generated from a different urdf or srdf,
+    * in which case iDynTree is used. Nothing is printed, reporting it is up to the caller
+    */
+   bool setGeneratedKinematics(const boost::shared_ptr<idynutils::generated_kinematics>& kinematics);
+
+   /**
+    * @brief isGeneratedKinematicsEnabled
+    * @return true if getPose() uses a generated kinematics, see setGeneratedKinematics()
+    */
+   bool isGeneratedKinematicsEnabled() const;
+
+   /**
+    * @brief warmup enables the real-time mode: it saves the joint limits and evaluates
+    * updateiDyn3Model() and the getters once, so that all the buffers they use are allocated.
+    * Afterwards updateiDyn3Model(), the queries writing into caller preallocated storage
+    * (getPose, getJacobian, getTorques(Eigen::Ref), getAng(Eigen::Ref), ...) and the support
+    * polygon do not allocate nor print, beyond what iDynTree itself does.
+    * Errors are pushed into getRealTimeErrors() instead of being printed: as the error ring has
+    * a single producer, in real-time mode this object must be used by one thread only (the
+    * errors can be printed by another one). Use a clone() per thread otherwise.
+    * Call updateiDyn3Model(q, true) before warmup() if the world pose is going to be used,
+    * since its first computation is not real-time safe.
+    */
+   void warmup();
+
+   /**
+    * @brief disableRealTimeMode goes back to printing errors and reading limits from iDynTree
+    */
+   void disableRealTimeMode();
+
+   /**
+    * @brief isRealTimeModeEnabled
+    * @return true if warmup() has been called, and the real-time mode has not been disabled
+    */
+   bool isRealTimeModeEnabled() const;
+
+   /**
+    * @brief getRealTimeErrors returns the errors reported in real-time mode. They should be
+    * printed by a non real-time thread, e.g.
+    *
+    *     robot.getRealTimeErrors().print(std::cerr);
+    *
+    * Copies of iDynUtils start with an empty error ring.
+    */
+   idynutils::rt_error_ring& getRealTimeErrors();
+
 protected:
    /**
     * @brief _computeDynamics defines whether we should update dynamics quantities during the updateIdyn3Model call
     */
    bool _computeDynamics;
 
+   /**
+    * @brief _lazyUpdate defines whether updateIdyn3Model only marks the model as dirty,
+    * leaving the computations to the getters
+    */
+   bool _lazyUpdate;
+
+   /**
+    * @brief _kinematics_dirty, _dynamics_dirty and _positions_dirty are true
+    * when the corresponding computation stage has not yet been run for the current state
+    */
+   bool _kinematics_dirty;
+   bool _dynamics_dirty;
+   bool _positions_dirty;
+
+   /**
+    * @brief computeKinematics computes the gravity vector in base link coordinates
+    * and runs the kinematic RNEA, if not already done for the current state
+    */
+   void computeKinematics();
+
+   /**
+    * @brief computeDynamics runs the dynamic RNEA (and the kinematic RNEA it depends on),
+    * if not already done for the current state
+    */
+   void computeDynamics();
+
+   /**
+    * @brief computePositions computes the link positions, if not already done for the current state
+    */
+   void computePositions();
+
     /**
      * @brief joint_names this vector contains ALL the active joint names
      */
@@ -632,11 +1217,37 @@ protected:
      */
     std::vector<std::string> fixed_joint_names;
 
+    /**
+     * @brief _dof_names joint_names in iDynTree DOF order, see getDOFNames()
+     */
+    std::vector<std::string> _dof_names;
+
+    /**
+     * @brief setDOFNames fills _dof_names from joint_names, checking that every active joint
+     * is a DOF of iDyn3_model
+     * @return false if joint_names and the DOFs of iDyn3_model do not match
+     */
+    bool setDOFNames();
+
     /**
      * @brief links_in_contact list of links (reference frames) that are in contact with the environment
      */
     std::list<std::string> links_in_contact;
 
+    /**
+     * @brief _links_in_contact_indices iDynTree indices of links_in_contact, resolved once
+     * in setLinksInContact()
+     */
+    std::vector<int> _links_in_contact_indices;
+
+    /**
+     * @brief _support_polygon_reference, _support_polygon_reference_index the last link used as
+     * reference frame of getSupportPolygonPoints(idynutils::support_polygon&, ...) and its iDynTree
+     * index, resolved only when the reference frame changes
+     */
+    std::string _support_polygon_reference;
+    int _support_polygon_reference_index;
+
     KDL::Tree robot_kdl_tree; // A KDL Tree
 
     std::string anchor_name;    // last anchor used
@@ -645,6 +1256,24 @@ protected:
      */
     KDL::Frame anchor_T_world;  // offset between inertial frame and anchor link (e.g., l_sole)
 
+    /**
+     * @brief _anchor_candidates iDynTree indices of the links set by setAnchorCandidates()
+     * and their cached candidate_T_world
+     */
+    std::vector<std::pair<int, KDL::Frame> > _anchor_candidates;
+    /**
+     * @brief _anchor_candidates_dirty the cached transforms are not coherent with the
+     * current joint positions and world pose
+     */
+    bool _anchor_candidates_dirty;
+
+    /**
+     * @brief updateAnchorCandidates computes candidate_T_world of the anchor candidates
+     * from the current anchor_T_world, following the kinematic path from each candidate
+     * to the anchor
+     */
+    void updateAnchorCandidates();
+
     void setJointNumbers(kinematic_chain& chain);
 
     /**
@@ -698,9 +1327,36 @@ protected:
     
     /**
      * @brief iDyn3Model load robot urdf and srdf, setup iDynThree
+     * @param cache if not NULL, sensors, base link and joint limits are taken from the model cache
+     * instead of being computed from the srdf and urdf
      * @return return true if the model is loaded in iDynThree and urdf/srdf are correctly found
      */
-    bool iDyn3Model();
+    bool iDyn3Model(const idynutils::model_cache* cache = NULL);
+
+    /**
+     * @brief checkModelCache checks the model cache is consistent with iDyn3_model,
+     * i.e. it describes the same joints in the same order
+     * @param cache a model cache built for the loaded urdf and srdf
+     * @return true if the cache can be used
+     */
+    bool checkModelCache(const idynutils::model_cache& cache) const;
+
+    /**
+     * @brief loadModelCache sets joint names, kinematic chains and sensor frames from the model cache
+     * @param cache a model cache built for the loaded urdf and srdf
+     */
+    void loadModelCache(const idynutils::model_cache& cache);
+
+    /**
+     * @brief fillModelCache fills the model cache with the information computed from urdf and srdf
+     * @param cache the model cache to fill
+     */
+    void fillModelCache(idynutils::model_cache& cache);
+
+    /**
+     * @brief _model_loaded_from_cache true if the model information has been read from the model cache
+     */
+    bool _model_loaded_from_cache;
 
     /**
      * @brief setWorldPose updates the transformation bTw from the world frame {W} to the base link {B},
@@ -737,8 +1393,26 @@ protected:
      */
     void updateRobotState(const yarp::sig::Vector &q);
 
+    /**
+     * @brief setMoveItVariableIndices computes the MoveIt variable index of every iDynTree DOF,
+     * used by updateRobotState to write the joint positions without looking up the joints by name
+     */
+    void setMoveItVariableIndices();
+
+    /**
+     * @brief _moveit_variable_indices the MoveIt variable of every iDynTree DOF (-1 if none)
+     */
+    std::vector<int> _moveit_variable_indices;
+
     bool updateForceTorqueMeasurement(const ft_measure& force_torque_measurement);
 
+    /**
+     * @brief updateForceTorqueMeasurements sets the FT measurements after the (possibly
+     * deferred) dynamicRNEA(), so that it does not overwrite them
+     * @param force_torque_measurement the FT measurements
+     */
+    void updateForceTorqueMeasurements(const std::vector<ft_measure>& force_torque_measurement);
+
     bool readForceTorqueSensorsNames();
 
     bool readIMUSensorsNames();
@@ -753,6 +1427,47 @@ protected:
      */
     yarp::sig::Vector g;
 
+    /**
+     * @brief _q_buffer, _dq_buffer and _ddq_buffer are preallocated buffers used to
+     * pass Eigen joint vectors to iDynTree without creating temporaries. They hold
+     * the joint state last set through updateiDyn3Model() or setAng(), see syncJointBuffers()
+     */
+    yarp::sig::Vector _q_buffer;
+    yarp::sig::Vector _dq_buffer;
+    yarp::sig::Vector _ddq_buffer;
+
+    /**
+     * @brief _zero3 a 3d vector of zeros, used as (fake) angular velocity and acceleration
+     * of the inertial measure
+     */
+    yarp::sig::Vector _zero3;
+
+    /**
+     * @brief preallocated buffers where iDynTree writes Jacobians and mass matrix
+     * before they get copied into the Eigen outputs
+     */
+    yarp::sig::Matrix _jacobian_buffer;
+    yarp::sig::Matrix _relative_jacobian_buffer;
+    yarp::sig::Matrix _com_jacobian_buffer;
+    yarp::sig::Matrix _mass_matrix_buffer;
+
+    /**
+     * @brief scatterJointStateMsg writes the joint state msg content into q, dq and tau
+     * (which can be NULL), updating the msg to iDynTree mapping if the msg names changed.
+     * To keep the check O(1), a change is detected from the number of names and the first and
+     * last one: a publisher reordering only the joints in between, with the same number of
+     * joints, is not supported
+     */
+    void scatterJointStateMsg(const sensor_msgs::JointState& msg,
+                              double* q, double* dq, double* tau);
+
+    /**
+     * @brief _joint_state_names names of the last joint state msg, and
+     * _joint_state_dofs the iDynTree DOF of each of them (-1 if the joint is not in the model)
+     */
+    std::vector<std::string> _joint_state_names;
+    std::vector<int> _joint_state_dofs;
+
     /**
      * @brief base_link_name is the link to which the floating base is attached during robot loading
      * Notice that, while the floating base link can be changed, the base_link_name will remain constant
@@ -768,8 +1483,133 @@ protected:
     std::vector<std::string> _ft_sensor_frames;
     std::vector<std::string> _imu_sensor_frames;
 
+    /**
+     * @brief _ft_sensor_joint_names and _imu_link_idyntree are the sensor descriptions
+     * used to construct iDyn3_model
+     */
+    std::vector<std::string> _ft_sensor_joint_names;
+    std::string _imu_link_idyntree;
+
     imu_orientation_measure _w_R_imu;
 
+    idynutils::stage_profiler _profiler;
+
+    /**
+     * @brief _generated_kinematics the kinematics set by setGeneratedKinematics(), NULL if none.
+     * _generated_link_indices maps iDynTree link indices to generated link indices.
+     */
+    boost::shared_ptr<idynutils::generated_kinematics> _generated_kinematics;
+    std::vector<int> _generated_link_indices;
+    int _generated_floating_base;
+    bool _generated_kinematics_dirty;
+
+    /**
+     * @brief updateGeneratedKinematics evaluates the generated kinematics, if the joint
+     * positions changed since the last evaluation
+     */
+    void updateGeneratedKinematics();
+
+    /**
+     * @brief syncJointBuffers copies the joint positions and velocities of iDyn3_model into
+     * _q_buffer and _dq_buffer, since iDyn3_model can be updated without going through
+     * iDynUtils, and marks the generated kinematics and the anchor candidates dirty if they
+     * changed. It does nothing in real-time mode, where the model must be updated through
+     * iDynUtils, as DynTree::getAng() allocates
+     */
+    void syncJointBuffers();
+
+    /**
+     * @brief getWorld_T_GeneratedRoot
+     * @return the pose of the root of the generated kinematics in world frame
+     */
+    KDL::Frame getWorld_T_GeneratedRoot() const;
+
+    /**
+     * @brief _centroidal_dynamics built at the first call to getCentroidalMomentumMatrix(),
+     * getCOMBiasAcceleration() or getSupportPolygonPoints() with the "COM" reference frame
+     */
+    boost::shared_ptr<idynutils::centroidal_dynamics> _centroidal_dynamics;
+
+    /**
+     * @brief _centroidal_floating_base, _centroidal_base_segment the iDynTree index of the floating
+     * base the last time _centroidal_dynamics was used, and its index in _centroidal_dynamics
+     */
+    int _centroidal_floating_base;
+    int _centroidal_base_segment;
+
+    /**
+     * @brief updateCentroidalDynamicsBase builds _centroidal_dynamics if needed and follows the
+     * floating base of iDyn3_model
+     * @return false if the floating base link is not a link of the KDL tree
+     */
+    bool updateCentroidalDynamicsBase();
+
+    /**
+     * @brief _contact_kinematics built at the first call to getContactKinematics(), its contacts
+     * are the links in contact. _contact_floating_base and _contact_base_segment as
+     * _centroidal_floating_base and _centroidal_base_segment
+     */
+    boost::shared_ptr<idynutils::contact_kinematics> _contact_kinematics;
+    int _contact_floating_base;
+    int _contact_base_segment;
+
+    /**
+     * @brief updateContactKinematicsLinks sets the links in contact as contacts of
+     * _contact_kinematics, if it has been built
+     */
+    void updateContactKinematicsLinks();
+
+    /**
+     * @brief _bias_kinematics built at the first call to getBiasAcceleration(), its only contact
+     * (_bias_link) is the last link queried. _bias_link_segments the index in _bias_kinematics
+     * of every iDynTree link. _bias_floating_base and _bias_base_segment as
+     * _centroidal_floating_base and _centroidal_base_segment
+     */
+    boost::shared_ptr<idynutils::contact_kinematics> _bias_kinematics;
+    std::vector<int> _bias_link_segments;
+    std::vector<int> _bias_link;
+    int _bias_floating_base;
+    int _bias_base_segment;
+
+    /**
+     * @brief _forward_dynamics built at the first call to getForwardDynamics(), getMassMatrix()
+     * or factorizeMassMatrix(). _forward_floating_base and _forward_base_segment as
+     * _centroidal_floating_base and _centroidal_base_segment
+     */
+    boost::shared_ptr<idynutils::forward_dynamics> _forward_dynamics;
+    int _forward_floating_base;
+    int _forward_base_segment;
+
+    /**
+     * @brief updateForwardDynamicsBase builds _forward_dynamics if needed and follows the
+     * floating base of iDyn3_model, also in _mass_matrix_factorization
+     * @return false if the floating base link is not a link of the KDL tree
+     */
+    bool updateForwardDynamicsBase();
+
+    /**
+     * @brief _mass_matrix_factorization built at the first call to factorizeMassMatrix(), the
+     * factorization of _mass_matrix if _mass_matrix_factorized
+     */
+    boost::shared_ptr<idynutils::mass_matrix_factorization> _mass_matrix_factorization;
+    Eigen::MatrixXd _mass_matrix;
+    bool _mass_matrix_factorized;
+
+    /**
+     * @brief _real_time_mode true after warmup(), see isRealTimeModeEnabled()
+     */
+    bool _real_time_mode;
+
+    /**
+     * @brief _joint_bound_min, _joint_bound_max and _joint_torque_max the joint limits
+     * saved by warmup()
+     */
+    Eigen::VectorXd _joint_bound_min;
+    Eigen::VectorXd _joint_bound_max;
+    Eigen::VectorXd _joint_torque_max;
+
+    idynutils::rt_error_ring _real_time_errors;
+
     void updateWorldOrientationWithIMU();
 
 
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _INCREMENTAL_KINEMATICS_H_
+#define _INCREMENTAL_KINEMATICS_H_
+
+#include <idynutils/idynutils.h>
+#include <idynutils/kinematic_tree.h>
+#include <Eigen/Dense>
+#include <kdl/frames.hpp>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The incremental_kinematics class computes the forward kinematics of a robot
+ * recomputing, at each query, only the poses of the links in the subtrees of the joints
+ * which changed since the previous query. Poses of the other links are kept from the
+ * previous computation.
+ * It is meant for loops (e.g. IK iterations) where only few kinematic chains move:
+ *
+ *     idynutils::incremental_kinematics fk(robot);
+ *     int hand = fk.getLinkIndex("r_wrist");
+ *     while(...) {
+ *         fk.setJointPositions(robot.right_arm, q_right_arm);
+ *         KDL::Frame w_T_hand = fk.getPose(hand);   // only the right arm gets recomputed
+ *     }
+ *
+ * The pose of the root of the tree in world frame is the one of the model at
+ * construction time, it can be changed through setWorldPose().
+ */
+class incremental_kinematics
+{
+public:
+    /**
+     * @brief incremental_kinematics builds the kinematics from the KDL tree of the model,
+     * initializing joint positions and world pose from the model
+     * @param model the robot model
+     */
+    incremental_kinematics(const iDynUtils& model);
+
+    /**
+     * @brief setJointPositions sets the positions of all the joints. Only joints whose
+     * value changed invalidate the poses of their subtree
+     * @param q joint positions, in iDynTree order
+     */
+    void setJointPositions(const Eigen::Ref<const Eigen::VectorXd>& q);
+
+    /**
+     * @brief setJointPositions sets the positions of the joints of a kinematic chain
+     * @param chain the kinematic chain
+     * @param q_chain joint positions of the chain, in the order of chain.joint_numbers
+     */
+    void setJointPositions(const kinematic_chain& chain,
+                           const Eigen::Ref<const Eigen::VectorXd>& q_chain);
+
+    /**
+     * @brief setWorldPose sets the pose of the root of the tree in world frame
+     * @param world_T_root pose of the root link in world frame
+     */
+    void setWorldPose(const KDL::Frame& world_T_root);
+
+    /**
+     * @brief getLinkIndex
+     * @param link a link name
+     * @return the index of the link, to be used in the queries, -1 if it does not exist
+     */
+    int getLinkIndex(const std::string& link) const;
+
+    /**
+     * @brief getPose return the pose of link expressed in world frame
+     * @param link a valid link index
+     */
+    const KDL::Frame& getPose(const int link);
+
+    /**
+     * @brief getPose return the pose of second_link expressed in first_link
+     * @param first_link a valid link index
+     * @param second_link a valid link index
+     */
+    KDL::Frame getPose(const int first_link, const int second_link);
+
+    /**
+     * @brief getJacobian computes the Jacobian of the origin of link in world frame,
+     * [linear; angular] velocity, without the floating base columns
+     * @param link a valid link index
+     * @param J a 6 x #DOFs preallocated matrix
+     */
+    void getJacobian(const int link, Eigen::Ref<Eigen::MatrixXd> J);
+
+    /**
+     * @brief getNrOfUpdatedLinks
+     * @return the number of link poses recomputed by the last update
+     */
+    unsigned int getNrOfUpdatedLinks() const;
+
+    const kinematic_tree& getTree() const;
+
+private:
+    void update();
+
+    kinematic_tree _tree;
+    Eigen::VectorXd _q;
+    std::vector<KDL::Frame> _poses;
+    std::vector<char> _changed;
+    bool _dirty;
+    unsigned int _updated_links;
+};
+
+}
+
+#endif
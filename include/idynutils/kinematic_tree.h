@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _KINEMATIC_TREE_H_
+#define _KINEMATIC_TREE_H_
+
+#include <kdl/tree.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+class iDynUtils;
+
+namespace idynutils
+{
+
+/**
+ * @brief The kinematic_tree class stores the topology of a KDL::Tree in flat arrays.
+ * Segments are sorted depth-first, so that every segment comes after its parent and
+ * the subtree of segment i is the range [i, i + getSubtreeSize(i)).
+ * Segment 0 is the root of the tree, its pose is the identity.
+ * The DOFs are numbered as in the joint_names vector given to the constructor: for the
+ * model of an iDynUtils use kinematic_tree(const iDynUtils&), or iDynUtils::getDOFNames(),
+ * so that DOF i is element i of the iDynTree joint vectors (iDynUtils::getJointNames()
+ * follows the MoveIt order instead).
+ */
+class kinematic_tree
+{
+public:
+    /**
+     * @brief kinematic_tree builds the flat representation of a KDL tree
+     * @param tree the KDL tree
+     * @param joint_names the names of the moving joints, in DOF order. Joints of the tree
+     *        not in this list are considered fixed
+     */
+    kinematic_tree(const KDL::Tree& tree, const std::vector<std::string>& joint_names);
+
+    /**
+     * @brief kinematic_tree builds the flat representation of the KDL tree of a model,
+     * with the DOFs in iDynTree order
+     * @param model the robot model, see iDynUtils::getKDLTree() and iDynUtils::getDOFNames()
+     */
+    kinematic_tree(const iDynUtils& model);
+
+    unsigned int getNrOfSegments() const { return _segments.size(); }
+    unsigned int getNrOfDOFs() const { return _dof_segment.size(); }
+
+    /**
+     * @brief getSegmentIndex
+     * @param name name of the segment (i.e. of the urdf link)
+     * @return the index of the segment, -1 if it does not exist
+     */
+    int getSegmentIndex(const std::string& name) const;
+
+    const std::string& getSegmentName(const unsigned int segment) const { return _segments[segment].getName(); }
+    const KDL::Segment& getSegment(const unsigned int segment) const { return _segments[segment]; }
+
+    /**
+     * @brief getParent
+     * @return the index of the parent segment, -1 for the root
+     */
+    int getParent(const unsigned int segment) const { return _parents[segment]; }
+
+    /**
+     * @brief getDOF
+     * @return the DOF moving the segment wrt its parent, -1 for fixed segments
+     */
+    int getDOF(const unsigned int segment) const { return _dofs[segment]; }
+
+    /**
+     * @brief getDOFSegment
+     * @return the segment moved by the DOF
+     */
+    unsigned int getDOFSegment(const unsigned int dof) const { return _dof_segment[dof]; }
+
+    /**
+     * @brief getSubtreeSize
+     * @return number of segments in the subtree rooted at segment, segment included
+     */
+    unsigned int getSubtreeSize(const unsigned int segment) const { return _subtree_sizes[segment]; }
+
+    /**
+     * @brief isAncestor
+     * @return true if segment is on the path from the root to link (link included)
+     */
+    bool isAncestor(const unsigned int segment, const unsigned int link) const
+    {
+        return link >= segment && link < segment + _subtree_sizes[segment];
+    }
+
+    /**
+     * @brief getCarriers computes, for the tree rooted at base (e.g. a floating base), the DOF
+     * carrying each DOF, i.e. the first DOF met on the path from its segment to base
+     * @param base a segment
+     * @param carriers resized to getNrOfSegments(), the segment of the DOF carrying each segment
+     *        with a DOF, -1 if it is carried by base only (and for segments without a DOF)
+     */
+    void getCarriers(const unsigned int base, std::vector<int>& carriers) const;
+
+private:
+    void init(const KDL::Tree& tree, const std::vector<std::string>& joint_names);
+
+    void addSubtree(const KDL::SegmentMap::const_iterator& element, const int parent,
+                    const std::vector<std::string>& joint_names);
+
+    std::vector<KDL::Segment> _segments;
+    std::vector<int> _parents;
+    std::vector<int> _dofs;
+    std::vector<unsigned int> _subtree_sizes;
+    std::vector<unsigned int> _dof_segment;
+    std::map<std::string, int> _segment_indices;
+};
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _MASS_MATRIX_FACTORIZATION_H_
+#define _MASS_MATRIX_FACTORIZATION_H_
+
+#include <idynutils/kinematic_tree.h>
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The mass_matrix_factorization class factorizes the (6+#DOFs) x (6+#DOFs) floating base
+ * mass matrix M of iDynUtils (getMassMatrix(), getFloatingBaseMassMatrix()) exploiting the sparsity due to the
+ * branches of the kinematic tree: M(i,j) is not zero only if i and j are the floating base or
+ * DOFs on the same path from the floating base to a leaf.
+ * Reordering the variables so that every DOF comes after the ones it is carried by,
+ * M = P' L' D L P with L unit lower triangular and as sparse as M (LTDL factorization,
+ * Featherstone, Rigid Body Dynamics Algorithms, 6.5), so that factorization costs
+ * O(n d^2) and solves O(n d), d being the depth of the tree.
+ * All the buffers are allocated by the constructor and by setFloatingBase().
+ */
+class mass_matrix_factorization
+{
+public:
+    /**
+     * @brief mass_matrix_factorization builds the flat representation of the tree
+     * @param tree the KDL tree of the robot, e.g. iDynUtils::getKDLTree()
+     * @param joint_names the names of the moving joints, in DOF order,
+     *        e.g. iDynUtils::getDOFNames()
+     */
+    mass_matrix_factorization(const KDL::Tree& tree, const std::vector<std::string>& joint_names);
+
+    /**
+     * @brief setFloatingBase computes the sparsity pattern of M for a floating base link
+     * @param link the floating base link
+     * @return false if link is not a link of the tree, in which case the floating base is not changed
+     */
+    bool setFloatingBase(const std::string& link);
+
+    /**
+     * @brief getSize
+     * @return the size of M, 6+#DOFs
+     */
+    unsigned int getSize() const { return _parents.size(); }
+
+    /**
+     * @brief factorize computes the LTDL factorization of M
+     * @param M the (6+#DOFs) x (6+#DOFs) mass matrix, ordered as in iDynUtils
+     * @return false if M is not positive definite, or the floating base has not been set
+     */
+    bool factorize(const Eigen::Ref<const Eigen::MatrixXd>& M);
+
+    /**
+     * @brief solve computes M^-1 X in place
+     * @param X a (6+#DOFs) x k matrix (or block)
+     */
+    void solve(Eigen::Ref<Eigen::MatrixXd> X) const;
+
+    /**
+     * @brief multiplyByInverseSqrt computes S X in place, with S = D^-1/2 L^-T P so that
+     * S' S = M^-1, e.g. J M^-1 J' = (S J')' (S J'). Rows of the result are ordered as the
+     * factorization, not as M
+     * @param X a (6+#DOFs) x k matrix (or block)
+     */
+    void multiplyByInverseSqrt(Eigen::Ref<Eigen::MatrixXd> X) const;
+
+    /**
+     * @brief multiplyByInverseSqrtTranspose computes S' X in place, so that
+     * multiplyByInverseSqrt() followed by multiplyByInverseSqrtTranspose() is solve()
+     * @param X a (6+#DOFs) x k matrix (or block)
+     */
+    void multiplyByInverseSqrtTranspose(Eigen::Ref<Eigen::MatrixXd> X) const;
+
+private:
+    kinematic_tree _tree;
+
+    /**
+     * @brief _order the variable of M at each position of the factorization,
+     * _parents the position of the variable carrying it, -1 for the first one
+     */
+    std::vector<int> _order;
+    std::vector<int> _parents;
+
+    /**
+     * @brief _H the reordered M, replaced by L (strictly lower part) and D (diagonal)
+     */
+    Eigen::MatrixXd _H;
+
+    /**
+     * @brief _inverse_sqrt_D D^-1/2, and _x a reordered column of the right hand side of the solves
+     */
+    Eigen::VectorXd _inverse_sqrt_D;
+    mutable Eigen::VectorXd _x;
+
+    bool _factorized;
+    bool _has_floating_base;
+};
+
+}
+
+#endif
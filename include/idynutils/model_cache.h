@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _MODEL_CACHE_H_
+#define _MODEL_CACHE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The model_cache class holds what iDynUtils resolves from the urdf and srdf
+ * of a robot (joint ordering, kinematic chains, force/torque and IMU sensors, joint limits)
+ * so that it can be stored in a versioned binary file and memory-mapped at startup.
+ * The file is keyed by a hash of the urdf and srdf contents: a cache built for different
+ * (or modified) robot description files is never loaded.
+ * Notice the file is written in the native byte order, it is not meant to be moved across
+ * different architectures.
+ */
+class model_cache
+{
+public:
+    /**
+     * @brief VERSION has to be increased each time the content of the file changes
+     */
+    static const uint32_t VERSION = 1;
+
+    /**
+     * @brief The chain struct describes a kinematic chain of the robot
+     */
+    struct chain
+    {
+        std::string chain_name;
+        std::string end_effector_name;
+        std::vector<std::string> joint_names;
+        std::vector<std::string> fixed_joint_names;
+        std::vector<unsigned int> joint_numbers;
+    };
+
+    model_cache();
+
+    /**
+     * @brief computeHash computes the FNV-1a hash of the urdf and srdf files contents
+     * @param urdf_path path to the urdf file
+     * @param srdf_path path to the srdf file
+     * @param hash the computed hash
+     * @return false if one of the files can not be read
+     */
+    static bool computeHash(const std::string& urdf_path,
+                            const std::string& srdf_path,
+                            uint64_t& hash);
+
+    /**
+     * @brief load memory-maps the cache file and reads its content
+     * @param cache_path path to the cache file
+     * @param expected_hash the hash of the urdf and srdf the cache has to be built from
+     * @return false if the file does not exist, is corrupted, has a different version or
+     * has been built from different urdf and srdf
+     */
+    bool load(const std::string& cache_path, const uint64_t expected_hash);
+
+    /**
+     * @brief save writes the cache file (atomically, through a temporary file)
+     * @param cache_path path to the cache file
+     * @return false if the file can not be written
+     */
+    bool save(const std::string& cache_path) const;
+
+    uint64_t hash;
+
+    std::vector<std::string> joint_names;
+    std::vector<std::string> fixed_joint_names;
+    std::vector<chain> chains;
+
+    std::string base_link_name;
+    std::vector<std::string> ft_sensor_joint_names;
+    std::string imu_link_idyntree;
+    std::vector<std::string> ft_sensor_frames;
+    std::vector<std::string> imu_sensor_frames;
+
+    std::vector<double> joint_bound_min;
+    std::vector<double> joint_bound_max;
+    std::vector<double> joint_torque_max;
+};
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _OPERATIONAL_SPACE_H_
+#define _OPERATIONAL_SPACE_H_
+
+#include <idynutils/idynutils.h>
+#include <idynutils/mass_matrix_factorization.h>
+#include <Eigen/Dense>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The operational_space class computes, for tasks with Jacobians J (m x (6+#DOFs)),
+ * the operational space quantities of task-priority controllers:
+ *  - M^-1 J'
+ *  - the operational space inertia Lambda = (J M^-1 J')^-1
+ *  - the dynamically consistent generalized inverse Jbar = M^-1 J' Lambda
+ *  - the dynamically consistent null-space projector N = I - Jbar J
+ * M, the floating base mass matrix of iDynUtils, is factorized once by update() (see
+ * idynutils::mass_matrix_factorization) and the factorization is reused by all the tasks,
+ * so that no matrix of the size of M is ever inverted: a task costs O(m n d + m^2 n),
+ * plus O(m n^2) for N.
+ *
+ * Outputs are written into caller buffers, resized only if their size is wrong,
+ * as are the internal buffers of every task slot: once every buffer has been used,
+ * update() and compute() do not allocate memory.
+ */
+class operational_space
+{
+public:
+    /**
+     * @brief The task struct holds the Jacobian of a task and its output buffers.
+     * A NULL buffer means the output is not requested, and it is not computed.
+     */
+    struct task
+    {
+        task() : J(NULL), Lambda(NULL), Minv_JT(NULL), Jbar(NULL), N(NULL) {}
+
+        const Eigen::MatrixXd* J;
+        Eigen::MatrixXd* Lambda;
+        Eigen::MatrixXd* Minv_JT;
+        Eigen::MatrixXd* Jbar;
+        Eigen::MatrixXd* N;
+    };
+
+    /**
+     * @brief operational_space allocates the buffers for the mass matrix of model
+     * @param model the robot model
+     */
+    operational_space(const iDynUtils& model);
+
+    /**
+     * @brief update computes and factorizes the mass matrix of model in its current state,
+     * to be called once per control loop before compute()
+     * @param model the robot model given to the constructor, updated (updateiDyn3Model())
+     * @return false if the mass matrix could not be computed or factorized
+     */
+    bool update(iDynUtils& model);
+
+    /**
+     * @brief compute computes the requested outputs of a task
+     * @param t the task
+     * @return false if J M^-1 J' is singular (e.g. J has not full row rank) or update()
+     *         has not succeeded
+     */
+    bool compute(const task& t);
+
+    /**
+     * @brief compute computes the requested outputs of a batch of tasks, each one
+     * with its own internal buffers
+     * @param tasks the tasks
+     * @return false if compute() fails for some task, in which case the following ones are
+     *         computed anyway
+     */
+    bool compute(const std::vector<task>& tasks);
+
+    /**
+     * @brief solve computes M^-1 X in place with the factorization of the last update()
+     * @param X a (6+#DOFs) x k matrix (or block)
+     */
+    void solve(Eigen::Ref<Eigen::MatrixXd> X) const;
+
+    const mass_matrix_factorization& getFactorization() const { return _factorization; }
+
+private:
+    /**
+     * @brief The workspace struct holds the internal buffers of a task slot:
+     * Z = D^-1/2 L^-T P J', M^-1 J', J M^-1 J' and its Cholesky factorization, Jbar'
+     */
+    struct workspace
+    {
+        Eigen::MatrixXd Z;
+        Eigen::MatrixXd Minv_JT;
+        Eigen::MatrixXd Lambda_inverse;
+        Eigen::LLT<Eigen::MatrixXd> llt;
+        Eigen::MatrixXd JbarT;
+    };
+
+    bool compute(const task& t, workspace& w);
+
+    mass_matrix_factorization _factorization;
+    Eigen::MatrixXd _M;
+
+    /**
+     * @brief _floating_base the iDynTree index of the floating base at the last update()
+     */
+    int _floating_base;
+    bool _factorized;
+
+    std::vector<workspace> _workspaces;
+};
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _RT_ERROR_RING_H_
+#define _RT_ERROR_RING_H_
+
+#include <boost/atomic.hpp>
+#include <iostream>
+
+namespace idynutils
+{
+
+/**
+ * @brief The rt_error_ring class is a fixed capacity, lock-free queue of errors, used by
+ * iDynUtils and RobotUtils in real-time mode instead of printing on the standard output.
+ * A single (real-time) thread pushes the errors, a single (non real-time) thread pops or
+ * prints them: objects sharing a ring must all push from the same thread.
+ * Errors are not copied: message and context must outlive the ring, e.g. string literals
+ * and names owned by the objects reporting the errors.
+ * When the ring is full, new errors are dropped and counted.
+ */
+class rt_error_ring
+{
+public:
+    static const unsigned int CAPACITY = 64;
+
+    struct error
+    {
+        const char* message;
+        const char* context;
+    };
+
+    rt_error_ring();
+
+    /**
+     * @brief push queues an error, does not allocate, lock or block
+     * @param message what went wrong
+     * @param context where it went wrong (e.g. a kinematic chain name), can be NULL
+     * @return false if the ring is full and the error has been dropped
+     */
+    bool push(const char* message, const char* context = NULL);
+
+    /**
+     * @brief pop removes the oldest error
+     * @param e the oldest error
+     * @return false if there are no errors
+     */
+    bool pop(error& e);
+
+    /**
+     * @brief print pops all the errors and prints them, together with the number of errors
+     * dropped since the last call. It is not real-time safe
+     * @param out the stream where to print
+     * @return the number of errors printed
+     */
+    unsigned int print(std::ostream& out = std::cout);
+
+    /**
+     * @brief getNrOfDroppedErrors
+     * @return the number of errors dropped because the ring was full, since the last print()
+     */
+    unsigned int getNrOfDroppedErrors() const;
+
+private:
+    rt_error_ring(const rt_error_ring&);
+    rt_error_ring& operator=(const rt_error_ring&);
+
+    error _errors[CAPACITY];
+    boost::atomic<unsigned int> _head;
+    boost::atomic<unsigned int> _tail;
+    boost::atomic<unsigned int> _dropped;
+};
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _SIMD_KERNELS_H_
+#define _SIMD_KERNELS_H_
+
+namespace idynutils
+{
+
+/**
+ * @brief simd_kernels are the vectorized loops of simd_kinematics. They are the only code
+ * compiled with IDYNUTILS_SIMD_FLAGS: this header and src/simd_kernels.cpp must include
+ * neither Eigen, KDL nor any other header with inline functions, otherwise copies of those
+ * functions using the SIMD instruction set could be picked by the linker for the whole
+ * library. Data is exchanged through plain arrays only.
+ */
+namespace simd_kernels
+{
+
+/**
+ * @brief The segment_motion struct describes the pose of a segment wrt its parent
+ * as A * M(q) * B, where A is a translation to the joint origin, M(q) the rotation
+ * about (or the translation along) axis and B a constant frame
+ */
+struct segment_motion
+{
+    int parent;
+    int dof;
+    bool revolute;
+    double origin[3];
+    double axis[3];
+    double B_rotation[9];
+    double B_position[3];
+};
+
+/**
+ * @brief getNrOfLanes
+ * @return the number of configurations computed together, depending on the instruction set
+ */
+unsigned int getNrOfLanes();
+
+/**
+ * @brief computeBlock computes the poses of a block of getNrOfLanes() configurations
+ * @param motions the motions of all the segments
+ * @param segments the segments to compute, every parent before its children
+ * @param nr_of_segments the size of segments
+ * @param q_block joint values of the block, #DOFs arrays of getNrOfLanes() values
+ * @param poses_block poses of the segments in world frame, for every segment 12 arrays
+ * of getNrOfLanes() values: the rotation in row-major order followed by the position.
+ * The pose of the root segment is an input
+ */
+void computeBlock(const segment_motion* motions,
+                  const unsigned int* segments,
+                  const unsigned int nr_of_segments,
+                  const double* q_block,
+                  double* poses_block);
+
+}
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _SIMD_KINEMATICS_H_
+#define _SIMD_KINEMATICS_H_
+
+#include <idynutils/idynutils.h>
+#include <idynutils/kinematic_tree.h>
+#include <idynutils/simd_kernels.h>
+#include <Eigen/Dense>
+#include <kdl/frames.hpp>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The simd_kinematics class computes the forward kinematics of a robot for many
+ * configurations at once, e.g. for collision sampling or reachability maps.
+ * Configurations are processed in blocks of getNrOfLanes() configurations: joint values and
+ * link transforms of a block are stored as structure of arrays (one array of getNrOfLanes()
+ * doubles for every entry of every transform), so that each step of the tree traversal
+ * processes the whole block with one vector instruction.
+ *
+ * The number of lanes is chosen when compiling idynutils: 8 with AVX-512, 4 with AVX/AVX2
+ * and 4 (scalar code) otherwise, see the IDYNUTILS_SIMD_FLAGS CMake option. Only the
+ * loops in simd_kernels get compiled with those flags.
+ *
+ * Outputs are written into a caller preallocated, column-major buffer (e.g. the data()
+ * of an Eigen::MatrixXd) with one configuration per column, holding the 4x4 column-major
+ * homogeneous transforms of the links in world frame, one after the other, as in
+ * batch_evaluator.
+ * Only the links on the paths from the root to the requested links get computed.
+ *
+ * The pose of the root of the tree in world frame is the one of the model at
+ * construction time, it can be changed through setWorldPose().
+ */
+class simd_kinematics
+{
+public:
+    /**
+     * @brief simd_kinematics builds the kinematics from the KDL tree of the model
+     * @param model the robot model
+     * @param links the links whose poses are computed
+     */
+    simd_kinematics(const iDynUtils& model, const std::vector<std::string>& links);
+
+    /**
+     * @brief evaluate computes the poses of the links at the configurations Q
+     * @param Q a #DOFs x #configurations matrix of joint positions
+     * @param poses the output buffer, getPosesSize() x Q.cols()
+     * @return false if one of the links does not exist
+     */
+    bool evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q, double* poses);
+
+    /**
+     * @brief setWorldPose sets the pose of the root of the tree in world frame
+     * @param world_T_root the pose of the root segment in world frame
+     */
+    void setWorldPose(const KDL::Frame& world_T_root);
+
+    /**
+     * @brief getNrOfLanes
+     * @return the number of configurations computed together
+     */
+    static unsigned int getNrOfLanes();
+
+    /**
+     * @brief getNumberOfDOFs
+     * @return the number of DOFs of the model, i.e. the rows of Q
+     */
+    unsigned int getNumberOfDOFs() const;
+
+    /**
+     * @brief getPosesSize
+     * @return the rows of the poses output buffer
+     */
+    unsigned int getPosesSize() const;
+
+private:
+    kinematic_tree _tree;
+    std::vector<simd_kernels::segment_motion> _motions;
+    std::vector<unsigned int> _segments_to_compute;
+    std::vector<int> _links;
+    bool _links_valid;
+
+    /**
+     * @brief _q_block joint values of the block, #DOFs arrays of getNrOfLanes() values
+     */
+    std::vector<double> _q_block;
+
+    /**
+     * @brief _poses_block link poses of the block, for every segment 12 arrays of
+     * getNrOfLanes() values: the rotation in row-major order followed by the position
+     */
+    std::vector<double> _poses_block;
+};
+
+}
+
+#endif
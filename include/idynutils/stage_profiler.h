@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _STAGE_PROFILER_H_
+#define _STAGE_PROFILER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * IDYNUTILS_PROFILE_STAGE(profiler, stage) measures the time spent from the macro
+ * to the end of the enclosing scope and records it in the given stage of profiler.
+ * It expands to nothing unless IDYNUTILS_PROFILING is defined, which happens when
+ * idynutils is configured with IDYNUTILS_ENABLE_PROFILING.
+ */
+#ifdef IDYNUTILS_PROFILING
+#define IDYNUTILS_PROFILE_CONCAT_(a, b) a##b
+#define IDYNUTILS_PROFILE_CONCAT(a, b) IDYNUTILS_PROFILE_CONCAT_(a, b)
+#define IDYNUTILS_PROFILE_STAGE(profiler, stage) \
+    idynutils::stage_profiler::scoped_timer IDYNUTILS_PROFILE_CONCAT(_stage_timer_, __LINE__)(profiler, stage)
+#else
+#define IDYNUTILS_PROFILE_STAGE(profiler, stage)
+#endif
+
+namespace idynutils
+{
+
+/**
+ * @brief The stage_profiler class collects timing statistics of a set of named stages
+ * (e.g. the steps of a control loop). For every stage it keeps the number of samples,
+ * minimum, maximum, mean and a log-scale histogram of the durations, from which
+ * percentiles are estimated with a relative error below 12.5%.
+ * Recording a sample does not allocate memory and costs two monotonic clock reads.
+ */
+class stage_profiler
+{
+public:
+    /**
+     * @brief The stage_statistics struct summarizes the samples of a stage, times are in seconds
+     */
+    struct stage_statistics
+    {
+        std::string name;
+        uint64_t count;
+        double min;
+        double mean;
+        double p99;
+        double max;
+    };
+
+    /**
+     * @brief The scoped_timer class records in a stage the time elapsed between
+     * its construction and its destruction
+     */
+    class scoped_timer
+    {
+    public:
+        scoped_timer(stage_profiler& profiler, const unsigned int stage);
+        ~scoped_timer();
+    private:
+        stage_profiler& _profiler;
+        const unsigned int _stage;
+        const uint64_t _start;
+    };
+
+    /**
+     * @brief stage_profiler creates a profiler for the given stages
+     * @param stage_names the names of the stages, a stage is identified by its index
+     */
+    stage_profiler(const std::vector<std::string>& stage_names);
+
+    /**
+     * @brief now
+     * @return the current time of the monotonic clock, in nanoseconds
+     */
+    static uint64_t now();
+
+    /**
+     * @brief addSample records a sample of a stage
+     * @param stage the index of the stage
+     * @param duration the duration of the sample, in nanoseconds
+     */
+    void addSample(const unsigned int stage, const uint64_t duration);
+
+    /**
+     * @brief reset discards all the samples of all the stages
+     */
+    void reset();
+
+    unsigned int getNrOfStages() const;
+
+    const std::string& getStageName(const unsigned int stage) const;
+
+    /**
+     * @brief getStatistics
+     * @param stage the index of the stage
+     * @return the statistics of the stage, all zeros if no samples were recorded
+     */
+    stage_statistics getStatistics(const unsigned int stage) const;
+
+    /**
+     * @brief getPercentile estimates a percentile of the durations of a stage
+     * @param stage the index of the stage
+     * @param percentile in [0, 100]
+     * @return the estimated percentile in seconds, 0 if no samples were recorded
+     */
+    double getPercentile(const unsigned int stage, const double percentile) const;
+
+    /**
+     * @brief dump writes the statistics of all the stages to a text file,
+     * one stage per line: name count min mean p99 max (times in microseconds)
+     * @param file_path path to the file
+     * @return false if the file can not be written
+     */
+    bool dump(const std::string& file_path) const;
+
+private:
+    static const unsigned int SUB_BUCKETS = 8;
+    static const unsigned int NR_OF_BUCKETS = 64*SUB_BUCKETS;
+
+    static unsigned int getBucket(const uint64_t duration);
+    static uint64_t getBucketUpperBound(const unsigned int bucket);
+
+    struct stage
+    {
+        std::string name;
+        uint64_t count;
+        uint64_t min;
+        uint64_t max;
+        uint64_t sum;
+        std::vector<uint64_t> histogram;
+    };
+
+    std::vector<stage> _stages;
+};
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _SUPPORT_POLYGON_H_
+#define _SUPPORT_POLYGON_H_
+
+#include <kdl/frames.hpp>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The support_polygon class holds the contact points of the robot in a fixed
+ * capacity buffer and computes their convex hull on the x-y plane, without any memory
+ * allocation, so that it can be used at every control loop:
+ *
+ *     idynutils::support_polygon polygon;
+ *     while(...) {
+ *         robot.getSupportPolygonPoints(polygon);
+ *         polygon.computeConvexHull();
+ *         for(unsigned int i = 0; i < polygon.getNrOfHullVertices(); ++i)
+ *             ... polygon.getHullVertex(i) ...
+ *     }
+ *
+ * It replaces the PCL pipeline of convex_hull for points which are already expressed
+ * in a frame with the z axis normal to the support surface (e.g. "COM" or "world").
+ */
+class support_polygon
+{
+public:
+    static const unsigned int MAX_POINTS = 64;
+
+    support_polygon();
+
+    /**
+     * @brief clear removes all the points (and the hull)
+     */
+    void clear();
+
+    /**
+     * @brief push_back adds a point
+     * @param point the point
+     * @return false if the buffer is full, the point is not added
+     */
+    bool push_back(const KDL::Vector& point);
+
+    unsigned int size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const KDL::Vector& operator[](const unsigned int i) const { return _points[i]; }
+
+    /**
+     * @brief computeConvexHull computes the convex hull of the points projected on the
+     * plane z = 0 (Andrew's monotone chain)
+     * @return true if the hull is a polygon, i.e. it has at least 3 vertices
+     */
+    bool computeConvexHull();
+
+    /**
+     * @brief getNrOfHullVertices
+     * @return the number of vertices of the last computed hull
+     */
+    unsigned int getNrOfHullVertices() const { return _hull_size; }
+
+    /**
+     * @brief getHullVertex
+     * @param i the vertex index, vertices are sorted counterclockwise and collinear
+     * points are removed
+     * @return a vertex of the hull, on the plane z = 0
+     */
+    const KDL::Vector& getHullVertex(const unsigned int i) const { return _hull[i]; }
+
+    /**
+     * @brief getConvexHull copies the vertices of the last computed hull, as in
+     * convex_hull::getConvexHull()
+     * @param ch the vertices of the convex hull
+     */
+    void getConvexHull(std::vector<KDL::Vector>& ch) const;
+
+private:
+    KDL::Vector _points[MAX_POINTS];
+    unsigned int _size;
+
+    /**
+     * @brief _sorted the indices of the points, sorted by x and y
+     */
+    unsigned int _sorted[MAX_POINTS];
+
+    /**
+     * @brief _hull the vertices of the hull, the monotone chain needs one more
+     * slot than the number of points
+     */
+    KDL::Vector _hull[MAX_POINTS + 1];
+    unsigned int _hull_size;
+};
+
+}
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _TRAJECTORY_DYNAMICS_H_
+#define _TRAJECTORY_DYNAMICS_H_
+
+#include <idynutils/idynutils.h>
+#include <idynutils/kinematic_tree.h>
+#include <idynutils/worker_pool.h>
+#include <Eigen/Dense>
+#include <kdl/frames.hpp>
+#include <kdl/rigidbodyinertia.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace idynutils
+{
+
+/**
+ * @brief The trajectory_dynamics class computes the inverse dynamics of a robot along whole
+ * trajectories of (q, dq, ddq) samples, e.g. to validate them offline.
+ * It runs its own allocation free recursive Newton-Euler algorithm on the KDL tree of the
+ * model, without going through iDynTree and yarp, splitting the samples among a number of
+ * threads, started at construction and reused by every evaluation. As in iDynUtils, the
+ * floating base is kept still and the only external wrench acts on it. Its world pose is the
+ * one it has in the model at construction time, and it is not updated with the samples: the
+ * torques match the ones of iDynUtils only for updateiDyn3Model(..., set_world_pose = false).
+ *
+ * Outputs are written into caller preallocated, column-major buffers (e.g. the data()
+ * of an Eigen::MatrixXd) holding one sample per column:
+ *  - torques: #DOFs rows, the joint torques
+ *  - base_wrenches: 6 rows, [force; torque] that the environment exerts on the floating base,
+ *                   in world frame, the torque being about the origin of the floating base
+ *  - com: 3 rows, the CoM expressed in world frame
+ *  - torque_limits_exceeded: 1 row, the number of joints whose torque exceeds
+ *                            iDynUtils::getJointTorqueMax() (needs torques)
+ * A NULL buffer means the output is not requested, and it is not computed.
+ *
+ * Long trajectories can be streamed through a sample_reader and a result_writer, which
+ * are called in chunks by evaluate(sample_reader&, result_writer&, ...).
+ */
+class trajectory_dynamics
+{
+public:
+    /**
+     * @brief The outputs struct holds the output buffers of an evaluation
+     */
+    struct outputs
+    {
+        outputs() : torques(NULL), base_wrenches(NULL), com(NULL), torque_limits_exceeded(NULL) {}
+
+        double* torques;
+        double* base_wrenches;
+        double* com;
+        int* torque_limits_exceeded;
+    };
+
+    /**
+     * @brief The sample_reader class is the source of the samples of a streamed trajectory
+     */
+    class sample_reader
+    {
+    public:
+        virtual ~sample_reader() {}
+
+        /**
+         * @brief read reads the next samples into the columns of Q, dQ, ddQ
+         * @return the number of samples read, less than Q.cols() only at the end of the trajectory
+         */
+        virtual unsigned int read(Eigen::Ref<Eigen::MatrixXd> Q,
+                                  Eigen::Ref<Eigen::MatrixXd> dQ,
+                                  Eigen::Ref<Eigen::MatrixXd> ddQ) = 0;
+    };
+
+    /**
+     * @brief The result_writer class receives the results of a streamed trajectory
+     */
+    class result_writer
+    {
+    public:
+        virtual ~result_writer() {}
+
+        /**
+         * @brief write receives the results of the samples [first_sample, first_sample + samples)
+         * @param out the output buffers, with samples columns, NULL for the outputs not requested
+         */
+        virtual void write(const unsigned int first_sample,
+                           const unsigned int samples,
+                           const outputs& out) = 0;
+    };
+
+    /**
+     * @brief The text_sample_reader class reads a sample per line, as the 3 x #DOFs values of
+     * q, dq and ddq separated by spaces, tabs or commas. Empty lines and lines starting with #
+     * are skipped, lines with less values are skipped and counted, see getNrOfSkippedSamples().
+     */
+    class text_sample_reader : public sample_reader
+    {
+    public:
+        text_sample_reader(std::istream& stream, const unsigned int number_of_dofs);
+
+        unsigned int read(Eigen::Ref<Eigen::MatrixXd> Q,
+                          Eigen::Ref<Eigen::MatrixXd> dQ,
+                          Eigen::Ref<Eigen::MatrixXd> ddQ);
+
+        /**
+         * @brief getNrOfSkippedSamples
+         * @return the number of lines skipped since they had less than 3 x #DOFs values
+         */
+        unsigned int getNrOfSkippedSamples() const;
+
+    private:
+        std::istream& _stream;
+        std::string _line;
+        std::vector<double> _values;
+        unsigned int _skipped;
+    };
+
+    /**
+     * @brief The text_result_writer class writes a line per sample: the index of the sample
+     * followed by the requested outputs, separated by spaces
+     */
+    class text_result_writer : public result_writer
+    {
+    public:
+        text_result_writer(std::ostream& stream, const unsigned int number_of_dofs);
+
+        void write(const unsigned int first_sample,
+                   const unsigned int samples,
+                   const outputs& out);
+
+    private:
+        std::ostream& _stream;
+        unsigned int _nDOFs;
+    };
+
+    /**
+     * @brief trajectory_dynamics builds the dynamics from the KDL tree of the model
+     * @param model the robot model: floating base, its world pose and torque limits are taken from it.
+     *        If the floating base is not a link of its KDL tree, isValid() and evaluate() return false
+     * @param number_of_threads number of threads used, 0 to use one thread per core
+     */
+    trajectory_dynamics(const iDynUtils& model, const unsigned int number_of_threads = 0);
+
+    /**
+     * @brief isValid
+     * @return false if the floating base of the model is not a link of its KDL tree
+     */
+    bool isValid() const;
+
+    /**
+     * @brief evaluate computes the inverse dynamics at the samples (Q, dQ, ddQ)
+     * @param Q a #DOFs x #samples matrix of joint positions
+     * @param dQ a #DOFs x #samples matrix of joint velocities
+     * @param ddQ a #DOFs x #samples matrix of joint accelerations
+     * @param out the output buffers, with Q.cols() columns
+     * @return false if the floating base of the model is not a link of its KDL tree
+     */
+    bool evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q,
+                  const Eigen::Ref<const Eigen::MatrixXd>& dQ,
+                  const Eigen::Ref<const Eigen::MatrixXd>& ddQ,
+                  const outputs& out);
+
+    /**
+     * @brief evaluate streams a trajectory from reader to writer, chunk_size samples at a time
+     * @param reader the source of the samples
+     * @param writer the destination of the results
+     * @param torques do we compute the joint torques?
+     * @param base_wrenches do we compute the wrenches on the floating base?
+     * @param com do we compute the CoM?
+     * @param torque_limits do we count the joints exceeding their torque limits?
+     * @param chunk_size number of samples read, evaluated and written at a time
+     * @return the number of samples processed, 0 if the trajectory_dynamics is not valid
+     */
+    unsigned int evaluate(sample_reader& reader,
+                          result_writer& writer,
+                          const bool torques = true,
+                          const bool base_wrenches = false,
+                          const bool com = false,
+                          const bool torque_limits = false,
+                          const unsigned int chunk_size = 1024);
+
+    /**
+     * @brief countTorqueLimitsExceeded counts, for every sample, the joints whose absolute
+     * torque exceeds the torque limit
+     * @param torques a #DOFs x #samples matrix of joint torques
+     * @param exceeded a #samples vector
+     */
+    void countTorqueLimitsExceeded(const Eigen::Ref<const Eigen::MatrixXd>& torques,
+                                   Eigen::Ref<Eigen::VectorXi> exceeded) const;
+
+    /**
+     * @brief getNumberOfThreads
+     * @return the number of threads used to evaluate the samples
+     */
+    unsigned int getNumberOfThreads() const;
+
+    /**
+     * @brief getNumberOfDOFs
+     * @return the number of DOFs of the model, i.e. the rows of Q and of the torques
+     */
+    unsigned int getNumberOfDOFs() const;
+
+private:
+    /**
+     * @brief The workspace struct holds the buffers of the RNEA of a thread: poses, velocities,
+     * accelerations and wrenches of the links, in world frame with the world origin as
+     * reference point
+     */
+    struct workspace
+    {
+        workspace(const unsigned int nr_of_segments);
+
+        std::vector<KDL::Frame> poses;
+        std::vector<KDL::Twist> motions;
+        std::vector<KDL::Twist> velocities;
+        std::vector<KDL::Twist> accelerations;
+        std::vector<KDL::Wrench> wrenches;
+    };
+
+    /**
+     * @brief The job struct holds inputs and outputs of an evaluation
+     */
+    struct job
+    {
+        const Eigen::Ref<const Eigen::MatrixXd>* Q;
+        const Eigen::Ref<const Eigen::MatrixXd>* dQ;
+        const Eigen::Ref<const Eigen::MatrixXd>* ddQ;
+        const outputs* out;
+        int threads;
+    };
+
+    /**
+     * @brief evaluateChunk is run by every thread on its share of the samples
+     */
+    void evaluateChunk(const unsigned int thread, const job* j);
+
+    /**
+     * @brief rnea computes the inverse dynamics of a sample
+     */
+    void rnea(workspace& w,
+              const Eigen::Ref<const Eigen::VectorXd>& q,
+              const Eigen::Ref<const Eigen::VectorXd>& dq,
+              const Eigen::Ref<const Eigen::VectorXd>& ddq,
+              double* torques, double* base_wrench, double* com) const;
+
+    worker_pool _workers;
+    kinematic_tree _tree;
+    std::vector<char> _prismatic;
+    std::vector<char> _on_base_path;
+    int _base_link;
+    KDL::Frame _world_T_base;
+    KDL::Vector _gravity;
+    Eigen::VectorXd _torque_limits;
+    std::vector<workspace> _workspaces;
+
+    /**
+     * @brief _Q, _dQ, _ddQ, _torques, _base_wrenches, _com, _exceeded the buffers of a chunk
+     * of a streamed trajectory
+     */
+    Eigen::MatrixXd _Q, _dQ, _ddQ;
+    Eigen::MatrixXd _torques, _base_wrenches, _com;
+    Eigen::VectorXi _exceeded;
+};
+
+}
+
+#endif
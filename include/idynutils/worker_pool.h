@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace idynutils
+{
+
+/**
+ * @brief The worker_pool class runs a task on a fixed set of threads, started at
+ * construction and joined at destruction, so that parallel evaluations do not pay the
+ * creation of threads at every call. The calling thread takes part in the work: a pool of
+ * n threads starts n - 1 workers.
+ * run() must be called by one thread at a time.
+ */
+class worker_pool
+{
+public:
+    /**
+     * @brief task is called with the index of the thread running it, in [0, number of tasks)
+     */
+    typedef boost::function<void (const unsigned int)> task;
+
+    /**
+     * @brief worker_pool starts the workers
+     * @param number_of_threads number of threads, calling thread included, 0 to use one
+     *        thread per core
+     */
+    explicit worker_pool(const unsigned int number_of_threads = 0);
+
+    ~worker_pool();
+
+    /**
+     * @brief run calls t(0) on the calling thread and t(i), 0 < i < number_of_tasks, on the
+     * workers, and returns when all of them are done
+     * @param t the task
+     * @param number_of_tasks at most getNumberOfThreads()
+     */
+    void run(const task& t, const unsigned int number_of_tasks);
+
+    /**
+     * @brief getNumberOfThreads
+     * @return the number of threads, calling thread included
+     */
+    unsigned int getNumberOfThreads() const;
+
+private:
+    worker_pool(const worker_pool&);
+    worker_pool& operator=(const worker_pool&);
+
+    /**
+     * @brief work is the loop of worker i, waiting for a new _generation of tasks
+     */
+    void work(const unsigned int i);
+
+    boost::thread_group _workers;
+    boost::mutex _mutex;
+    boost::condition_variable _started;
+    boost::condition_variable _finished;
+
+    const task* _task;
+    unsigned int _number_of_tasks;
+    unsigned int _pending;
+    unsigned long _generation;
+    bool _stop;
+    unsigned int _number_of_threads;
+};
+
+}
+
+#endif
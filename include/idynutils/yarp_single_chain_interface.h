@@ -29,6 +29,7 @@
 #include <yarp/os/BufferedPort.h>
 #include <yarp/dev/IInteractionMode.h>
 #include <idynutils/ControlType.hpp>
+#include <idynutils/rt_error_ring.h>
 
 
 /**
@@ -183,6 +184,17 @@ public:
     
     bool moveDone();
 
+    /**
+     * @brief setRealTimeErrors makes move() push its errors into an error ring instead of
+     * printing them, see iDynUtils::warmup()
+     * @param errors the error ring, which must outlive this chain. NULL goes back to printing.
+     * Rings support a single producer: when a ring is shared (e.g. by RobotUtils::warmup()),
+     * all the objects pushing into it must be used by the same thread.
+     * The context of the errors points to the name of the chain: pop them before assigning
+     * this chain (operator=) or destroying it
+     */
+    void setRealTimeErrors(idynutils::rt_error_ring* errors);
+
     /**
      * @brief setReferenceSpeed set a desired reference speed vector for all joints in the chain
      * when moving using position mode
@@ -361,6 +373,7 @@ private:
     int joints_number;
     std::string module_prefix;
     yarp::sig::Vector q_buffer;
+    yarp::sig::Vector u_buffer;
     yarp::sig::Vector qdot_buffer;
     yarp::sig::Vector tau_buffer;
     yarp::sig::Vector q_motor_buffer;
@@ -389,6 +402,17 @@ private:
     yarp::dev::IImpedanceControl *impedancePositionControl;
     yarp::dev::ITorqueControl *torqueControl;
     yarp::dev::IVelocityControl2 *velocityControl;
+
+    /**
+     * @brief _real_time_errors the error ring set by setRealTimeErrors(), NULL if none
+     */
+    idynutils::rt_error_ring* _real_time_errors;
+
+    /**
+     * @brief reportRealTimeError pushes an error into the error ring, if there is one
+     * @return false if the error should be printed, since there is no error ring
+     */
+    bool reportRealTimeError(const char* message);
 };
 
 
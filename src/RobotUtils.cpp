@@ -22,6 +22,16 @@
 using namespace iCub::iDynTree;
 using namespace yarp::math;
 
+/**
+ * @brief copyVector copies from into to, which gets resized only if its size is different
+ */
+static void copyVector(const yarp::sig::Vector& from, yarp::sig::Vector& to)
+{
+    if(to.size() != from.size())
+        to.resize(from.size());
+    std::copy(from.data(), from.data() + from.size(), to.data());
+}
+
 RobotUtils::RobotUtils(const std::string moduleName, 
 		       const std::string robotName,
 		       const std::string urdf_path, 
@@ -80,6 +90,27 @@ RobotUtils::RobotUtils(const std::string moduleName,
     loadForceTorqueSensors();
 }
 
+void RobotUtils::warmup()
+{
+    idynutils.warmup();
+
+    idynutils::rt_error_ring* errors = &idynutils.getRealTimeErrors();
+    right_hand.setRealTimeErrors(errors);
+    left_hand.setRealTimeErrors(errors);
+    right_arm.setRealTimeErrors(errors);
+    left_arm.setRealTimeErrors(errors);
+    torso.setRealTimeErrors(errors);
+    right_leg.setRealTimeErrors(errors);
+    left_leg.setRealTimeErrors(errors);
+    head.setRealTimeErrors(errors);
+
+    // sensing once, so that the readings buffers get their final size
+    this->sensePosition();
+    this->senseVelocity();
+    this->senseTorque();
+    this->senseftSensors();
+}
+
 bool RobotUtils::hasHands()
 {
     return left_hand.isAvailable && right_hand.isAvailable;
@@ -156,8 +187,8 @@ bool RobotUtils::moveDone()
 bool RobotUtils::moveHands(const yarp::sig::Vector &q_left_hand,
                            const yarp::sig::Vector &q_right_hand)
 {
-    q_commanded_left_hand = q_left_hand;
-    q_commanded_right_hand = q_right_hand;
+    copyVector(q_left_hand, q_commanded_left_hand);
+    copyVector(q_right_hand, q_commanded_right_hand);
 
     if(left_hand.isAvailable)
         left_hand.move(q_commanded_left_hand);
@@ -358,9 +389,9 @@ void RobotUtils::sense(yarp::sig::Vector &q,
                        yarp::sig::Vector &qdot,
                        yarp::sig::Vector &tau)
 {
-    q = sensePosition();
-    qdot = senseVelocity();
-    tau = senseTorque();
+    copyVector(sensePosition(), q);
+    copyVector(senseVelocity(), qdot);
+    copyVector(senseTorque(), tau);
 }
 
 yarp::sig::Vector &RobotUtils::sensePosition()
@@ -482,10 +513,10 @@ yarp::sig::Vector& RobotUtils::sensePositionRefFeedback()
 
 RobotUtils::ftReadings& RobotUtils::senseftSensors()
 {
-    ft_readings.clear();
+    // readings are written in place, so that after the first call no map node is allocated
     for( ftPtrMap::iterator i = ftSensors.begin(); i != ftSensors.end(); ++i)
     {
-        ft_readings[i->first] = i->second->sense();
+        i->second->sense(ft_readings[i->first]);
     }
     return ft_readings;
 }
@@ -493,10 +524,9 @@ RobotUtils::ftReadings& RobotUtils::senseftSensors()
 bool RobotUtils::senseftSensor(const std::string &ft_frame,
                                yarp::sig::Vector &ftReading)
 {
-    if(ftSensors[ft_frame]) {
-        ftPtr ft(ftSensors[ft_frame]);
-        return ft->sense(ftReading);
-    }
+    ftPtrMap::const_iterator ft = ftSensors.find(ft_frame);
+    if(ft != ftSensors.end() && ft->second)
+        return ft->second->sense(ftReading);
     return false;
 }
 
@@ -505,12 +535,12 @@ bool RobotUtils::senseHandsPosition(yarp::sig::Vector &q_left_hand,
 {
     if(left_hand.isAvailable) {
         left_hand.sensePosition(q_sensed_left_hand);
-        q_left_hand = q_sensed_left_hand;
+        copyVector(q_sensed_left_hand, q_left_hand);
     }
 
     if(right_hand.isAvailable) {
         right_hand.sensePosition(q_sensed_right_hand);
-        q_right_hand = q_sensed_right_hand;
+        copyVector(q_sensed_right_hand, q_right_hand);
     }
 
     return hasHands();
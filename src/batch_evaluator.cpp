@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/batch_evaluator.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cassert>
+
+using namespace idynutils;
+
+batch_evaluator::batch_evaluator(const iDynUtils& model,
+                                 const std::vector<std::string>& links,
+                                 const unsigned int number_of_threads) :
+    _workers(number_of_threads),
+    _links_valid(true),
+    _nDOFs(model.getDOFNames().size())
+{
+    const unsigned int n = _workers.getNumberOfThreads();
+
+    for(unsigned int i = 0; i < links.size(); ++i)
+    {
+        _links.push_back(model.getLinkHandle(links[i]));
+        if(!_links.back().isValid())
+            _links_valid = false;
+    }
+
+    for(unsigned int i = 0; i < n; ++i)
+    {
+        // no collision checking takes place, the planning scene is not needed
+        _models.push_back(model.clone(false));
+        // every clone computes only the quantities requested by the caller
+        _models.back()->enableLazyUpdate();
+    }
+
+    _poses_buffers.resize(n, poses_vector(_links.size()));
+}
+
+bool batch_evaluator::evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q,
+                               const outputs& out,
+                               const bool set_world_pose)
+{
+    job j;
+    j.Q = &Q;
+    j.dQ = NULL;
+    j.ddQ = NULL;
+    j.out = &out;
+    j.set_world_pose = set_world_pose;
+
+    return this->run(j);
+}
+
+bool batch_evaluator::evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q,
+                               const Eigen::Ref<const Eigen::MatrixXd>& dQ,
+                               const Eigen::Ref<const Eigen::MatrixXd>& ddQ,
+                               const outputs& out,
+                               const bool set_world_pose)
+{
+    assert(dQ.rows() == Q.rows() && dQ.cols() == Q.cols());
+    assert(ddQ.rows() == Q.rows() && ddQ.cols() == Q.cols());
+
+    job j;
+    j.Q = &Q;
+    j.dQ = &dQ;
+    j.ddQ = &ddQ;
+    j.out = &out;
+    j.set_world_pose = set_world_pose;
+
+    return this->run(j);
+}
+
+bool batch_evaluator::run(job& j)
+{
+    assert(j.Q->rows() == (int)_nDOFs);
+
+    j.threads = std::min<int>(_models.size(), j.Q->cols());
+    _workers.run(boost::bind(&batch_evaluator::evaluateChunk, this, _1, &j), j.threads);
+
+    return _links_valid;
+}
+
+void batch_evaluator::evaluateChunk(const unsigned int thread, const job* j)
+{
+    // static partitioning: every configuration costs the same
+    const int configurations = j->Q->cols();
+    const int chunk = configurations / j->threads;
+    const int remainder = configurations % j->threads;
+    const int begin = thread*chunk + std::min<int>(thread, remainder);
+    const int end = begin + chunk + ((int)thread < remainder ? 1 : 0);
+
+    iDynUtils& model = *_models[thread];
+    poses_vector& poses = _poses_buffers[thread];
+
+    const unsigned int nLinks = _links.size();
+    const unsigned int jacobian_size = 6*(_nDOFs+6);
+
+    for(int c = begin; c < end; ++c)
+    {
+        if(j->dQ)
+            model.updateiDyn3Model(j->Q->col(c), j->dQ->col(c), j->ddQ->col(c), j->set_world_pose);
+        else
+            model.updateiDyn3Model(j->Q->col(c), j->set_world_pose);
+
+        if(j->out->poses && nLinks > 0)
+        {
+            model.getPoses(_links, &poses[0]);
+            double* column = j->out->poses + (size_t)c*16*nLinks;
+            for(unsigned int l = 0; l < nLinks; ++l)
+                Eigen::Map<Eigen::Matrix4d>(column + 16*l) = poses[l];
+        }
+
+        if(j->out->com)
+        {
+            KDL::Vector com = model.getCoM();
+            double* column = j->out->com + (size_t)c*3;
+            column[0] = com.x(); column[1] = com.y(); column[2] = com.z();
+        }
+
+        if(j->out->jacobians)
+        {
+            double* column = j->out->jacobians + (size_t)c*jacobian_size*nLinks;
+            for(unsigned int l = 0; l < nLinks; ++l)
+            {
+                Eigen::Map<Eigen::MatrixXd> J(column + jacobian_size*l, 6, _nDOFs+6);
+                if(!model.getJacobian(_links[l], J))
+                    J.setZero();
+            }
+        }
+
+        if(j->out->torques)
+        {
+            Eigen::Map<Eigen::VectorXd> tau(j->out->torques + (size_t)c*_nDOFs, _nDOFs);
+            model.getTorques(tau);
+        }
+    }
+}
+
+bool batch_evaluator::isValid() const
+{
+    return _links_valid;
+}
+
+unsigned int batch_evaluator::getNumberOfThreads() const
+{
+    return _models.size();
+}
+
+unsigned int batch_evaluator::getNumberOfDOFs() const
+{
+    return _nDOFs;
+}
+
+unsigned int batch_evaluator::getPosesSize() const
+{
+    return 16*_links.size();
+}
+
+unsigned int batch_evaluator::getJacobiansSize() const
+{
+    return 6*(_nDOFs+6)*_links.size();
+}
@@ -218,6 +218,14 @@ void cartesian_utils::fromKDLFrameToYARPMatrix(const KDL::Frame &Ti, yarp::sig::
     To(2,0) = Ti.M.UnitX().z(); To(2,1) = Ti.M.UnitY().z(); To(2,2) = Ti.M.UnitZ().z(); To(2,3) = Ti.p.z();
 }
 
+void cartesian_utils::fromKDLFrameToEigenMatrix(const KDL::Frame& Ti, Eigen::Matrix4d& To)
+{
+    To(0,0) = Ti.M(0,0); To(0,1) = Ti.M(0,1); To(0,2) = Ti.M(0,2); To(0,3) = Ti.p.x();
+    To(1,0) = Ti.M(1,0); To(1,1) = Ti.M(1,1); To(1,2) = Ti.M(1,2); To(1,3) = Ti.p.y();
+    To(2,0) = Ti.M(2,0); To(2,1) = Ti.M(2,1); To(2,2) = Ti.M(2,2); To(2,3) = Ti.p.z();
+    To(3,0) = 0.0;       To(3,1) = 0.0;       To(3,2) = 0.0;       To(3,3) = 1.0;
+}
+
 void cartesian_utils::fromKDLRotationToYARPMatrix(const KDL::Rotation& Ri, yarp::sig::Matrix& Ro)
 {
     Ro.resize(3,3);
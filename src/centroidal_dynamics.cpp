@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/centroidal_dynamics.h>
+#include <cassert>
+
+using namespace idynutils;
+
+centroidal_dynamics::centroidal_dynamics(const KDL::Tree& tree,
+                                         const std::vector<std::string>& joint_names) :
+    _tree(tree, joint_names),
+    _prismatic(_tree.getNrOfSegments(), 0),
+    _on_base_path(_tree.getNrOfSegments(), 0),
+    _poses(_tree.getNrOfSegments(), KDL::Frame::Identity()),
+    _motions(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _velocities(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _accelerations(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _inertias(_tree.getNrOfSegments(), KDL::RigidBodyInertia::Zero()),
+    _total_inertia(KDL::RigidBodyInertia::Zero()),
+    _com(KDL::Vector::Zero())
+{
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        const KDL::Joint::JointType type = _tree.getSegment(i).getJoint().getType();
+        _prismatic[i] = type == KDL::Joint::TransAxis || type == KDL::Joint::TransX ||
+                        type == KDL::Joint::TransY || type == KDL::Joint::TransZ;
+    }
+}
+
+int centroidal_dynamics::getLinkIndex(const std::string& link) const
+{
+    return _tree.getSegmentIndex(link);
+}
+
+double centroidal_dynamics::getJointPosition(const unsigned int segment,
+                                             const Eigen::Ref<const Eigen::VectorXd>& q) const
+{
+    const int dof = _tree.getDOF(segment);
+    return dof == -1 ? 0.0 : q[dof];
+}
+
+void centroidal_dynamics::computePoses(const int base_link,
+                                       const KDL::Frame& world_T_base,
+                                       const Eigen::Ref<const Eigen::VectorXd>& q)
+{
+    const unsigned int nSegments = _tree.getNrOfSegments();
+
+    // the root of the tree is placed so that the floating base is at world_T_base
+    KDL::Frame root_T_base = KDL::Frame::Identity();
+    std::fill(_on_base_path.begin(), _on_base_path.end(), 0);
+    for(int i = base_link; i > 0; i = _tree.getParent(i)) {
+        root_T_base = _tree.getSegment(i).pose(getJointPosition(i, q)) * root_T_base;
+        _on_base_path[i] = 1;
+    }
+    _poses[0] = world_T_base * root_T_base.Inverse();
+
+    // poses and joint motion subspaces, the reference point of twists is the world origin
+    for(unsigned int i = 1; i < nSegments; ++i)
+    {
+        const KDL::Frame& world_T_parent = _poses[_tree.getParent(i)];
+        const KDL::Segment& segment = _tree.getSegment(i);
+        _poses[i] = world_T_parent * segment.pose(getJointPosition(i, q));
+
+        if(_tree.getDOF(i) == -1)
+            continue;
+
+        const KDL::Vector axis = world_T_parent.M * segment.getJoint().JointAxis();
+        if(_prismatic[i])
+            _motions[i] = KDL::Twist(axis, KDL::Vector::Zero());
+        else
+            _motions[i] = KDL::Twist((world_T_parent * segment.getJoint().JointOrigin()) * axis, axis);
+    }
+}
+
+const KDL::Vector& centroidal_dynamics::computeCOM(const int base_link,
+                                                   const KDL::Frame& world_T_base,
+                                                   const Eigen::Ref<const Eigen::VectorXd>& q)
+{
+    assert(base_link >= 0 && base_link < (int)_tree.getNrOfSegments());
+    assert(q.size() == (int)_tree.getNrOfDOFs());
+
+    this->computePoses(base_link, world_T_base, q);
+
+    _total_inertia = KDL::RigidBodyInertia::Zero();
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+        _total_inertia = _total_inertia + _poses[i] * _tree.getSegment(i).getInertia();
+    _com = _total_inertia.getCOG();
+    return _com;
+}
+
+KDL::Wrench centroidal_dynamics::computeMomentumBias(const int base_link,
+                                                     const KDL::Frame& world_T_base,
+                                                     const KDL::Twist& base_velocity,
+                                                     const Eigen::Ref<const Eigen::VectorXd>& q,
+                                                     const Eigen::Ref<const Eigen::VectorXd>& dq)
+{
+    const unsigned int nSegments = _tree.getNrOfSegments();
+    assert(base_link >= 0 && base_link < (int)nSegments);
+    assert(q.size() == (int)_tree.getNrOfDOFs() && dq.size() == (int)_tree.getNrOfDOFs());
+
+    this->computePoses(base_link, world_T_base, q);
+
+    // velocities and bias accelerations (dnu = 0): the ones of the root are such that
+    // the floating base moves with base_velocity and has null acceleration
+    const KDL::Twist base_twist = base_velocity.RefPoint(-world_T_base.p);
+    const KDL::Twist base_acceleration(-(base_velocity.rot * base_velocity.vel), KDL::Vector::Zero());
+
+    _velocities[0] = base_twist;
+    for(int i = base_link; i > 0; i = _tree.getParent(i))
+        if(_tree.getDOF(i) != -1)
+            _velocities[0] -= _motions[i] * dq[_tree.getDOF(i)];
+    for(unsigned int i = 1; i < nSegments; ++i) {
+        _velocities[i] = _velocities[_tree.getParent(i)];
+        if(_tree.getDOF(i) != -1)
+            _velocities[i] += _motions[i] * dq[_tree.getDOF(i)];
+    }
+
+    _accelerations[0] = base_acceleration;
+    for(int i = base_link; i > 0; i = _tree.getParent(i))
+        if(_tree.getDOF(i) != -1)
+            _accelerations[0] -= (_velocities[_tree.getParent(i)] * _motions[i]) * dq[_tree.getDOF(i)];
+    for(unsigned int i = 1; i < nSegments; ++i) {
+        _accelerations[i] = _accelerations[_tree.getParent(i)];
+        if(_tree.getDOF(i) != -1)
+            _accelerations[i] += (_velocities[_tree.getParent(i)] * _motions[i]) * dq[_tree.getDOF(i)];
+    }
+
+    // rate of change of the momentum due to the bias accelerations
+    KDL::Wrench dh = KDL::Wrench::Zero();
+    _total_inertia = KDL::RigidBodyInertia::Zero();
+    for(unsigned int i = 0; i < nSegments; ++i)
+    {
+        _inertias[i] = _poses[i] * _tree.getSegment(i).getInertia();
+        _total_inertia = _total_inertia + _inertias[i];
+        dh += _inertias[i] * _accelerations[i] + _velocities[i] * (_inertias[i] * _velocities[i]);
+    }
+    _com = _total_inertia.getCOG();
+
+    return dh;
+}
+
+void centroidal_dynamics::compute(const int base_link,
+                                  const KDL::Frame& world_T_base,
+                                  const KDL::Twist& base_velocity,
+                                  const Eigen::Ref<const Eigen::VectorXd>& q,
+                                  const Eigen::Ref<const Eigen::VectorXd>& dq,
+                                  Eigen::Ref<Eigen::MatrixXd> A,
+                                  Eigen::Ref<Eigen::VectorXd> dA_dq)
+{
+    const unsigned int nDOFs = _tree.getNrOfDOFs();
+    const unsigned int nSegments = _tree.getNrOfSegments();
+    assert(A.rows() == 6 && A.cols() == (int)nDOFs + 6 && dA_dq.size() == 6);
+
+    KDL::Wrench dh = this->computeMomentumBias(base_link, world_T_base, base_velocity, q, dq);
+
+    // composite inertias
+    for(unsigned int i = nSegments - 1; i > 0; --i)
+        _inertias[_tree.getParent(i)] = _inertias[_tree.getParent(i)] + _inertias[i];
+
+    const KDL::RigidBodyInertia& total_inertia = _total_inertia;
+
+    // the columns of A are momenta wrt the world origin, moved to the CoM:
+    // k_CoM = k_O - CoM x l. As dCoM/dt x l = 0, the same holds for dA*dq
+    KDL::Wrench h;
+    for(unsigned int k = 0; k < 3; ++k)
+    {
+        KDL::Vector e = KDL::Vector::Zero();
+        e[k] = 1.0;
+
+        h = (total_inertia * KDL::Twist(e, KDL::Vector::Zero())).RefPoint(_com);
+        A.col(k) << h.force.x(), h.force.y(), h.force.z(), h.torque.x(), h.torque.y(), h.torque.z();
+
+        h = (total_inertia * KDL::Twist(KDL::Vector::Zero(), e).RefPoint(-world_T_base.p)).RefPoint(_com);
+        A.col(3+k) << h.force.x(), h.force.y(), h.force.z(), h.torque.x(), h.torque.y(), h.torque.z();
+    }
+
+    A.rightCols(nDOFs).setZero();
+    for(unsigned int i = 1; i < nSegments; ++i)
+    {
+        const int dof = _tree.getDOF(i);
+        if(dof == -1)
+            continue;
+
+        // with the floating base still, a joint on the path to the floating base
+        // moves everything but its subtree, in the opposite direction
+        h = _inertias[i] * _motions[i];
+        if(_on_base_path[i])
+            h = h - total_inertia * _motions[i];
+        h = h.RefPoint(_com);
+        A.col(6+dof) << h.force.x(), h.force.y(), h.force.z(), h.torque.x(), h.torque.y(), h.torque.z();
+    }
+
+    dh = dh.RefPoint(_com);
+    dA_dq << dh.force.x(), dh.force.y(), dh.force.z(), dh.torque.x(), dh.torque.y(), dh.torque.z();
+}
+
+void centroidal_dynamics::computeBias(const int base_link,
+                                      const KDL::Frame& world_T_base,
+                                      const KDL::Twist& base_velocity,
+                                      const Eigen::Ref<const Eigen::VectorXd>& q,
+                                      const Eigen::Ref<const Eigen::VectorXd>& dq,
+                                      Eigen::Ref<Eigen::VectorXd> dA_dq)
+{
+    assert(dA_dq.size() == 6);
+
+    const KDL::Wrench dh = this->computeMomentumBias(base_link, world_T_base, base_velocity, q, dq).RefPoint(_com);
+    dA_dq << dh.force.x(), dh.force.y(), dh.force.z(), dh.torque.x(), dh.torque.y(), dh.torque.z();
+}
+
+double centroidal_dynamics::getMass() const
+{
+    return _total_inertia.getMass();
+}
+
+const KDL::Vector& centroidal_dynamics::getCOM() const
+{
+    return _com;
+}
@@ -288,7 +288,8 @@ void ComputeLinksDistance::generatePairsToCheck()
             }
         }
     }
-    std::cout << "Checking " << pairsToCheck.size() << " pairs for collision" << std::endl;
+    if(!model.isRealTimeModeEnabled())
+        std::cout << "Checking " << pairsToCheck.size() << " pairs for collision" << std::endl;
 }
 
 ComputeLinksDistance::ComputeLinksDistance(iDynUtils &model) : model(model)
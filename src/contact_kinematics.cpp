@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/contact_kinematics.h>
+#include <algorithm>
+#include <cassert>
+
+using namespace idynutils;
+
+contact_kinematics::contact_kinematics(const KDL::Tree& tree,
+                                       const std::vector<std::string>& joint_names) :
+    _tree(tree, joint_names),
+    _prismatic(_tree.getNrOfSegments(), 0),
+    _active(_tree.getNrOfSegments(), 0),
+    _active_base(-1),
+    _poses(_tree.getNrOfSegments(), KDL::Frame::Identity()),
+    _motions(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _velocities(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _accelerations(_tree.getNrOfSegments(), KDL::Twist::Zero())
+{
+    _active_segments.reserve(_tree.getNrOfSegments());
+
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        const KDL::Joint::JointType type = _tree.getSegment(i).getJoint().getType();
+        _prismatic[i] = type == KDL::Joint::TransAxis || type == KDL::Joint::TransX ||
+                        type == KDL::Joint::TransY || type == KDL::Joint::TransZ;
+    }
+}
+
+int contact_kinematics::getLinkIndex(const std::string& link) const
+{
+    return _tree.getSegmentIndex(link);
+}
+
+bool contact_kinematics::setContacts(const std::vector<int>& contacts)
+{
+    for(unsigned int c = 0; c < contacts.size(); ++c)
+        if(contacts[c] < 0 || contacts[c] >= (int)_tree.getNrOfSegments())
+            return false;
+
+    _contacts = contacts;
+    _active_base = -1;
+    return true;
+}
+
+double contact_kinematics::getJointPosition(const unsigned int segment,
+                                            const Eigen::Ref<const Eigen::VectorXd>& q) const
+{
+    const int dof = _tree.getDOF(segment);
+    return dof == -1 ? 0.0 : q[dof];
+}
+
+bool contact_kinematics::isAncestor(const unsigned int segment, const unsigned int link) const
+{
+    return link >= segment && link < segment + _tree.getSubtreeSize(segment);
+}
+
+void contact_kinematics::updateActiveSegments(const int base_link)
+{
+    std::fill(_active.begin(), _active.end(), 0);
+    _active[0] = 1;
+
+    // walking up from each link, until a path already marked is found
+    for(unsigned int c = 0; c < _contacts.size(); ++c)
+        for(int i = _contacts[c]; i > 0 && !_active[i]; i = _tree.getParent(i))
+            _active[i] = 1;
+    for(int i = base_link; i > 0 && !_active[i]; i = _tree.getParent(i))
+        _active[i] = 1;
+
+    // segments are sorted depth-first, so parents come first
+    _active_segments.clear();
+    for(unsigned int i = 0; i < _active.size(); ++i)
+        if(_active[i])
+            _active_segments.push_back(i);
+
+    _active_base = base_link;
+}
+
+void contact_kinematics::computeKinematics(const int base_link,
+                                           const KDL::Frame& world_T_base,
+                                           const KDL::Twist& base_velocity,
+                                           const Eigen::Ref<const Eigen::VectorXd>& q,
+                                           const Eigen::Ref<const Eigen::VectorXd>& dq)
+{
+    assert(base_link >= 0 && base_link < (int)_tree.getNrOfSegments());
+    assert(q.size() == (int)_tree.getNrOfDOFs() && dq.size() == (int)_tree.getNrOfDOFs());
+
+    if(base_link != _active_base)
+        this->updateActiveSegments(base_link);
+
+    // the root of the tree is placed so that the floating base is at world_T_base
+    KDL::Frame root_T_base = KDL::Frame::Identity();
+    for(int i = base_link; i > 0; i = _tree.getParent(i))
+        root_T_base = _tree.getSegment(i).pose(getJointPosition(i, q)) * root_T_base;
+    _poses[0] = world_T_base * root_T_base.Inverse();
+
+    // poses and joint motion subspaces, the reference point of twists is the world origin
+    for(unsigned int k = 1; k < _active_segments.size(); ++k)
+    {
+        const unsigned int i = _active_segments[k];
+        const KDL::Frame& world_T_parent = _poses[_tree.getParent(i)];
+        const KDL::Segment& segment = _tree.getSegment(i);
+        _poses[i] = world_T_parent * segment.pose(getJointPosition(i, q));
+
+        if(_tree.getDOF(i) == -1)
+            continue;
+
+        const KDL::Vector axis = world_T_parent.M * segment.getJoint().JointAxis();
+        if(_prismatic[i])
+            _motions[i] = KDL::Twist(axis, KDL::Vector::Zero());
+        else
+            _motions[i] = KDL::Twist((world_T_parent * segment.getJoint().JointOrigin()) * axis, axis);
+    }
+
+    // velocities and bias accelerations (dnu = 0): the ones of the root are such that
+    // the floating base moves with base_velocity and has null acceleration
+    _velocities[0] = base_velocity.RefPoint(-world_T_base.p);
+    for(int i = base_link; i > 0; i = _tree.getParent(i))
+        if(_tree.getDOF(i) != -1)
+            _velocities[0] -= _motions[i] * dq[_tree.getDOF(i)];
+    for(unsigned int k = 1; k < _active_segments.size(); ++k) {
+        const unsigned int i = _active_segments[k];
+        _velocities[i] = _velocities[_tree.getParent(i)];
+        if(_tree.getDOF(i) != -1)
+            _velocities[i] += _motions[i] * dq[_tree.getDOF(i)];
+    }
+
+    _accelerations[0] = KDL::Twist(-(base_velocity.rot * base_velocity.vel), KDL::Vector::Zero());
+    for(int i = base_link; i > 0; i = _tree.getParent(i))
+        if(_tree.getDOF(i) != -1)
+            _accelerations[0] -= (_velocities[_tree.getParent(i)] * _motions[i]) * dq[_tree.getDOF(i)];
+    for(unsigned int k = 1; k < _active_segments.size(); ++k) {
+        const unsigned int i = _active_segments[k];
+        _accelerations[i] = _accelerations[_tree.getParent(i)];
+        if(_tree.getDOF(i) != -1)
+            _accelerations[i] += (_velocities[_tree.getParent(i)] * _motions[i]) * dq[_tree.getDOF(i)];
+    }
+}
+
+void contact_kinematics::computeBiasAccelerations(Eigen::Ref<Eigen::VectorXd> dJ_nu) const
+{
+    for(unsigned int c = 0; c < _contacts.size(); ++c)
+    {
+        // spatial acceleration to the acceleration of the origin of the contact link
+        const unsigned int link = _contacts[c];
+        const KDL::Vector& p = _poses[link].p;
+        const KDL::Twist& v = _velocities[link];
+        const KDL::Twist& a = _accelerations[link];
+        const KDL::Vector acceleration = a.vel + a.rot * p + v.rot * (v.vel + v.rot * p);
+        dJ_nu.segment<6>(6*c) << acceleration.x(), acceleration.y(), acceleration.z(),
+                                 a.rot.x(), a.rot.y(), a.rot.z();
+    }
+}
+
+void contact_kinematics::compute(const int base_link,
+                                 const KDL::Frame& world_T_base,
+                                 const KDL::Twist& base_velocity,
+                                 const Eigen::Ref<const Eigen::VectorXd>& q,
+                                 const Eigen::Ref<const Eigen::VectorXd>& dq,
+                                 Eigen::Ref<Eigen::MatrixXd> J,
+                                 Eigen::Ref<Eigen::VectorXd> dJ_nu)
+{
+    const unsigned int nDOFs = _tree.getNrOfDOFs();
+    const unsigned int nContacts = _contacts.size();
+    assert(J.rows() == 6*(int)nContacts && J.cols() == (int)nDOFs + 6 &&
+           dJ_nu.size() == 6*(int)nContacts);
+
+    this->computeKinematics(base_link, world_T_base, base_velocity, q, dq);
+
+    J.setZero();
+    for(unsigned int c = 0; c < nContacts; ++c)
+    {
+        const unsigned int link = _contacts[c];
+        const KDL::Vector& p = _poses[link].p;
+        const KDL::Vector r = p - world_T_base.p;
+        const unsigned int row = 6*c;
+
+        // the floating base moves the contact as a rigid body: v = v_base + w x r
+        J.block<6,6>(row, 0).setIdentity();
+        J.block<3,3>(row, 3) << 0.0,  r.z(), -r.y(),
+                               -r.z(), 0.0,   r.x(),
+                                r.y(), -r.x(), 0.0;
+
+        // with the floating base still, the joints on the path to the floating base
+        // move the contact in the opposite direction, the ones shared by the two paths do not
+        KDL::Twist column;
+        for(int i = link; i > 0; i = _tree.getParent(i)) {
+            if(_tree.getDOF(i) == -1 || isAncestor(i, base_link))
+                continue;
+            column = _motions[i].RefPoint(p);
+            J.block<6,1>(row, 6 + _tree.getDOF(i)) << column.vel.x(), column.vel.y(), column.vel.z(),
+                                                      column.rot.x(), column.rot.y(), column.rot.z();
+        }
+        for(int i = base_link; i > 0; i = _tree.getParent(i)) {
+            if(_tree.getDOF(i) == -1 || isAncestor(i, link))
+                continue;
+            column = _motions[i].RefPoint(p);
+            J.block<6,1>(row, 6 + _tree.getDOF(i)) << -column.vel.x(), -column.vel.y(), -column.vel.z(),
+                                                      -column.rot.x(), -column.rot.y(), -column.rot.z();
+        }
+    }
+
+    this->computeBiasAccelerations(dJ_nu);
+}
+
+void contact_kinematics::computeBias(const int base_link,
+                                     const KDL::Frame& world_T_base,
+                                     const KDL::Twist& base_velocity,
+                                     const Eigen::Ref<const Eigen::VectorXd>& q,
+                                     const Eigen::Ref<const Eigen::VectorXd>& dq,
+                                     Eigen::Ref<Eigen::VectorXd> dJ_nu)
+{
+    assert(dJ_nu.size() == 6*(int)_contacts.size());
+
+    this->computeKinematics(base_link, world_T_base, base_velocity, q, dq);
+    this->computeBiasAccelerations(dJ_nu);
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/forward_dynamics.h>
+#include <cassert>
+
+using namespace idynutils;
+
+forward_dynamics::forward_dynamics(const KDL::Tree& tree,
+                                   const std::vector<std::string>& joint_names) :
+    _tree(tree, joint_names),
+    _prismatic(_tree.getNrOfSegments(), 0),
+    _carriers(_tree.getNrOfSegments(), -1),
+    _carriers_base(-1),
+    _poses(_tree.getNrOfSegments(), KDL::Frame::Identity()),
+    _motions(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _velocities(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _bias_accelerations(_tree.getNrOfSegments(), KDL::Twist::Zero()),
+    _inertias(_tree.getNrOfSegments(), KDL::RigidBodyInertia::Zero()),
+    _articulated_inertias(_tree.getNrOfSegments(), Matrix6d::Zero()),
+    _bias_forces(_tree.getNrOfSegments(), Vector6d::Zero()),
+    _U(_tree.getNrOfSegments(), Vector6d::Zero()),
+    _D(_tree.getNrOfSegments(), 0.0),
+    _u(_tree.getNrOfSegments(), 0.0),
+    _accelerations(_tree.getNrOfSegments(), Vector6d::Zero())
+{
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        const KDL::Joint::JointType type = _tree.getSegment(i).getJoint().getType();
+        _prismatic[i] = type == KDL::Joint::TransAxis || type == KDL::Joint::TransX ||
+                        type == KDL::Joint::TransY || type == KDL::Joint::TransZ;
+    }
+}
+
+int forward_dynamics::getLinkIndex(const std::string& link) const
+{
+    return _tree.getSegmentIndex(link);
+}
+
+double forward_dynamics::getJointPosition(const unsigned int segment,
+                                          const Eigen::Ref<const Eigen::VectorXd>& q) const
+{
+    const int dof = _tree.getDOF(segment);
+    return dof == -1 ? 0.0 : q[dof];
+}
+
+static KDL::Twist unitTwist(const unsigned int k)
+{
+    KDL::Twist t = KDL::Twist::Zero();
+    if(k < 3)
+        t.vel[k] = 1.0;
+    else
+        t.rot[k-3] = 1.0;
+    return t;
+}
+
+void forward_dynamics::updatePoses(const int base_link,
+                                   const KDL::Frame& world_T_base,
+                                   const Eigen::Ref<const Eigen::VectorXd>& q)
+{
+    // the root of the tree is placed so that the floating base is at world_T_base
+    KDL::Frame root_T_base = KDL::Frame::Identity();
+    for(int i = base_link; i > 0; i = _tree.getParent(i))
+        root_T_base = _tree.getSegment(i).pose(getJointPosition(i, q)) * root_T_base;
+    _poses[0] = world_T_base * root_T_base.Inverse();
+
+    // poses and joint motion subspaces, the reference point of twists is the world origin
+    for(unsigned int i = 1; i < _tree.getNrOfSegments(); ++i)
+    {
+        const KDL::Frame& world_T_parent = _poses[_tree.getParent(i)];
+        const KDL::Segment& segment = _tree.getSegment(i);
+        _poses[i] = world_T_parent * segment.pose(getJointPosition(i, q));
+
+        if(_tree.getDOF(i) == -1)
+            continue;
+
+        const KDL::Vector axis = world_T_parent.M * segment.getJoint().JointAxis();
+        if(_prismatic[i])
+            _motions[i] = KDL::Twist(axis, KDL::Vector::Zero());
+        else
+            _motions[i] = KDL::Twist((world_T_parent * segment.getJoint().JointOrigin()) * axis, axis);
+    }
+}
+
+void forward_dynamics::computeAccelerations(const int base_link,
+                                            const KDL::Frame& world_T_base,
+                                            const KDL::Twist& base_velocity,
+                                            const Eigen::Ref<const Eigen::VectorXd>& q,
+                                            const Eigen::Ref<const Eigen::VectorXd>& dq,
+                                            const Eigen::Ref<const Eigen::VectorXd>& tau,
+                                            const KDL::Vector& gravity,
+                                            Eigen::Ref<Eigen::VectorXd> dnu)
+{
+    const unsigned int nDOFs = _tree.getNrOfDOFs();
+    const unsigned int nSegments = _tree.getNrOfSegments();
+    assert(base_link >= 0 && base_link < (int)nSegments);
+    assert(q.size() == (int)nDOFs && dq.size() == (int)nDOFs && tau.size() == (int)nDOFs);
+    assert(dnu.size() == (int)nDOFs + 6);
+
+    this->updatePoses(base_link, world_T_base, q);
+
+    // velocities: the one of the root is such that the floating base moves with base_velocity
+    _velocities[0] = base_velocity.RefPoint(-world_T_base.p);
+    for(int i = base_link; i > 0; i = _tree.getParent(i))
+        if(_tree.getDOF(i) != -1)
+            _velocities[0] -= _motions[i] * dq[_tree.getDOF(i)];
+    for(unsigned int i = 1; i < nSegments; ++i) {
+        const KDL::Twist& parent_velocity = _velocities[_tree.getParent(i)];
+        _velocities[i] = parent_velocity;
+        _bias_accelerations[i] = KDL::Twist::Zero();
+        if(_tree.getDOF(i) != -1) {
+            _velocities[i] += _motions[i] * dq[_tree.getDOF(i)];
+            _bias_accelerations[i] = (parent_velocity * _motions[i]) * dq[_tree.getDOF(i)];
+        }
+    }
+
+    // rigid body inertias and bias forces, gravity being an external force
+    const KDL::Twist gravity_acceleration(gravity, KDL::Vector::Zero());
+    KDL::Wrench w;
+    for(unsigned int i = 0; i < nSegments; ++i)
+    {
+        _inertias[i] = _poses[i] * _tree.getSegment(i).getInertia();
+        for(unsigned int k = 0; k < 6; ++k) {
+            w = _inertias[i] * unitTwist(k);
+            _articulated_inertias[i].col(k) << w.force.x(), w.force.y(), w.force.z(),
+                                               w.torque.x(), w.torque.y(), w.torque.z();
+        }
+        w = _velocities[i] * (_inertias[i] * _velocities[i]) - _inertias[i] * gravity_acceleration;
+        _bias_forces[i] << w.force.x(), w.force.y(), w.force.z(), w.torque.x(), w.torque.y(), w.torque.z();
+    }
+
+    // articulated inertias and bias forces, from the leaves
+    Vector6d s, c;
+    for(unsigned int i = nSegments - 1; i > 0; --i)
+    {
+        const int parent = _tree.getParent(i);
+        const int dof = _tree.getDOF(i);
+        if(dof != -1)
+        {
+            s << _motions[i].vel.x(), _motions[i].vel.y(), _motions[i].vel.z(),
+                 _motions[i].rot.x(), _motions[i].rot.y(), _motions[i].rot.z();
+            const KDL::Twist& bias = _bias_accelerations[i];
+            c << bias.vel.x(), bias.vel.y(), bias.vel.z(), bias.rot.x(), bias.rot.y(), bias.rot.z();
+
+            _U[i].noalias() = _articulated_inertias[i] * s;
+            _D[i] = s.dot(_U[i]);
+            _u[i] = tau[dof] - s.dot(_bias_forces[i]);
+
+            _articulated_inertias[i].noalias() -= _U[i] * (_U[i].transpose() / _D[i]);
+            _bias_forces[i].noalias() += _articulated_inertias[i] * c + _U[i] * (_u[i] / _D[i]);
+        }
+        _articulated_inertias[parent] += _articulated_inertias[i];
+        _bias_forces[parent] += _bias_forces[i];
+    }
+
+    // the root is free, then the accelerations go down to the leaves
+    _accelerations[0] = -_articulated_inertias[0].ldlt().solve(_bias_forces[0]);
+    for(unsigned int i = 1; i < nSegments; ++i)
+    {
+        const KDL::Twist& bias = _bias_accelerations[i];
+        c << bias.vel.x(), bias.vel.y(), bias.vel.z(), bias.rot.x(), bias.rot.y(), bias.rot.z();
+        _accelerations[i] = _accelerations[_tree.getParent(i)] + c;
+
+        const int dof = _tree.getDOF(i);
+        if(dof == -1)
+            continue;
+
+        s << _motions[i].vel.x(), _motions[i].vel.y(), _motions[i].vel.z(),
+             _motions[i].rot.x(), _motions[i].rot.y(), _motions[i].rot.z();
+        dnu[6 + dof] = (_u[i] - _U[i].dot(_accelerations[i])) / _D[i];
+        _accelerations[i] += s * dnu[6 + dof];
+    }
+
+    // spatial acceleration to the acceleration of the origin of the floating base
+    const Vector6d& a = _accelerations[base_link];
+    const KDL::Vector a_O(a[0], a[1], a[2]);
+    const KDL::Vector alpha(a[3], a[4], a[5]);
+    const KDL::Twist& v = _velocities[base_link];
+    const KDL::Vector& p = world_T_base.p;
+    const KDL::Vector acceleration = a_O + alpha * p + v.rot * (v.vel + v.rot * p);
+    dnu.head<6>() << acceleration.x(), acceleration.y(), acceleration.z(), alpha.x(), alpha.y(), alpha.z();
+}
+
+void forward_dynamics::computeMassMatrix(const int base_link,
+                                         const KDL::Frame& world_T_base,
+                                         const Eigen::Ref<const Eigen::VectorXd>& q,
+                                         Eigen::Ref<Eigen::MatrixXd> M)
+{
+    const unsigned int nDOFs = _tree.getNrOfDOFs();
+    const unsigned int nSegments = _tree.getNrOfSegments();
+    assert(base_link >= 0 && base_link < (int)nSegments);
+    assert(q.size() == (int)nDOFs);
+    assert(M.rows() == (int)nDOFs + 6 && M.cols() == (int)nDOFs + 6);
+
+    this->updatePoses(base_link, world_T_base, q);
+    if(base_link != _carriers_base) {
+        _tree.getCarriers(base_link, _carriers);
+        _carriers_base = base_link;
+    }
+
+    // composite inertias
+    for(unsigned int i = 0; i < nSegments; ++i)
+        _inertias[i] = _poses[i] * _tree.getSegment(i).getInertia();
+    for(unsigned int i = nSegments - 1; i > 0; --i)
+        _inertias[_tree.getParent(i)] = _inertias[_tree.getParent(i)] + _inertias[i];
+    const KDL::RigidBodyInertia& total_inertia = _inertias[0];
+
+    M.setZero();
+
+    // the floating base moves all the links as a rigid body
+    KDL::Twist base_motions[6];
+    KDL::Wrench base_forces[6];
+    for(unsigned int k = 0; k < 6; ++k) {
+        base_motions[k] = k < 3 ? unitTwist(k) : unitTwist(k).RefPoint(-world_T_base.p);
+        base_forces[k] = total_inertia * base_motions[k];
+    }
+    for(unsigned int k = 0; k < 6; ++k)
+        for(unsigned int l = 0; l < 6; ++l)
+            M(k, l) = KDL::dot(base_motions[k], base_forces[l]);
+
+    // with the floating base still, a joint moves the links it carries, a joint on the path to
+    // the floating base everything but its subtree, in the opposite direction. M(i,j) is not zero
+    // only if i carries j (or j carries i)
+    KDL::Twist motion;
+    KDL::Wrench force;
+    for(unsigned int j = 1; j < nSegments; ++j)
+    {
+        const int dof = _tree.getDOF(j);
+        if(dof == -1)
+            continue;
+
+        if(_tree.isAncestor(j, base_link)) {
+            motion = -_motions[j];
+            force = total_inertia * motion - _inertias[j] * motion;
+        } else {
+            motion = _motions[j];
+            force = _inertias[j] * motion;
+        }
+
+        M(6 + dof, 6 + dof) = KDL::dot(motion, force);
+        for(unsigned int k = 0; k < 6; ++k)
+            M(k, 6 + dof) = M(6 + dof, k) = KDL::dot(base_motions[k], force);
+
+        for(int i = _carriers[j]; i != -1; i = _carriers[i]) {
+            motion = _tree.isAncestor(i, base_link) ? -_motions[i] : _motions[i];
+            M(6 + _tree.getDOF(i), 6 + dof) = M(6 + dof, 6 + _tree.getDOF(i)) = KDL::dot(motion, force);
+        }
+    }
+}
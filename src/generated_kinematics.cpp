@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/generated_kinematics.h>
+#include <cassert>
+#include <cstring>
+
+using namespace idynutils;
+
+generated_kinematics::generated_kinematics(const uint64_t model_hash,
+                                           const unsigned int nr_of_links,
+                                           const unsigned int nr_of_dofs,
+                                           const char* const* link_names,
+                                           const int* parents,
+                                           const int* dofs,
+                                           const int* joint_types,
+                                           const double (*axes)[3]) :
+    _model_hash(model_hash),
+    _nr_of_links(nr_of_links),
+    _nr_of_dofs(nr_of_dofs),
+    _link_names(link_names),
+    _parents(parents),
+    _dofs(dofs),
+    _joint_types(joint_types),
+    _axes(axes),
+    _poses(nr_of_links, KDL::Frame::Identity()),
+    _com(KDL::Vector::Zero())
+{
+
+}
+
+generated_kinematics::~generated_kinematics()
+{
+
+}
+
+int generated_kinematics::getLinkIndex(const std::string& link) const
+{
+    for(unsigned int i = 0; i < _nr_of_links; ++i)
+        if(std::strcmp(_link_names[i], link.c_str()) == 0)
+            return i;
+    return -1;
+}
+
+void generated_kinematics::setJointPositions(const Eigen::Ref<const Eigen::VectorXd>& q)
+{
+    assert(q.size() == (int)_nr_of_dofs);
+    // a Ref to a VectorXd always has unit inner stride
+    setJointPositions(q.data());
+}
+
+void generated_kinematics::setJointPositions(const double* q)
+{
+    computePoses(q, &_poses[0], _com);
+}
+
+void generated_kinematics::getJacobian(const int link, Eigen::Ref<Eigen::MatrixXd> J) const
+{
+    assert(J.rows() == 6 && J.cols() == (int)_nr_of_dofs);
+
+    J.setZero();
+    const KDL::Vector& p_link = _poses[link].p;
+
+    // the joint of a link moves it about (along) an axis through the origin of the link
+    for(int i = link; i > 0; i = _parents[i])
+    {
+        if(_joint_types[i] == FIXED)
+            continue;
+
+        const int dof = _dofs[i];
+        const KDL::Vector axis = _poses[i].M * KDL::Vector(_axes[i][0], _axes[i][1], _axes[i][2]);
+        KDL::Vector linear = axis;
+        KDL::Vector angular = KDL::Vector::Zero();
+        if(_joint_types[i] == REVOLUTE) {
+            linear = axis * (p_link - _poses[i].p);
+            angular = axis;
+        }
+
+        J(0,dof) = linear.x(); J(1,dof) = linear.y(); J(2,dof) = linear.z();
+        J(3,dof) = angular.x(); J(4,dof) = angular.y(); J(5,dof) = angular.z();
+    }
+}
@@ -22,6 +22,7 @@
 #include <idynutils/yarp_single_chain_interface.h>
 #include <yarp/math/SVD.h>
 #include <idynutils/cartesian_utils.h>
+#include <idynutils/model_cache.h>
 #include <moveit/robot_model/joint_model.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/robot_state/robot_state.h>
@@ -36,9 +37,32 @@ using namespace yarp::math;
 #define RED "\033[0;31m"
 #define DEFAULT "\033[0m"
 
+namespace {
+    /**
+     * @brief profiledStageNames the names of the stages in iDynUtils::profiled_stage
+     */
+    std::vector<std::string> profiledStageNames()
+    {
+        std::vector<std::string> names;
+        names.push_back("updateiDyn3Model");
+        names.push_back("world_pose");
+        names.push_back("imu_orientation");
+        names.push_back("gravity");
+        names.push_back("kinematicRNEA");
+        names.push_back("dynamicRNEA");
+        names.push_back("computePositions");
+        names.push_back("updateRobotState");
+        names.push_back("self_collision");
+        names.push_back("world_collision");
+        return names;
+    }
+}
+
 iDynUtils::iDynUtils(const std::string robot_name_,
 		     const std::string urdf_path,
-		     const std::string srdf_path) :
+		     const std::string srdf_path,
+		     const std::string model_cache_path,
+		     const bool lazy_planning_scene) :
     right_arm(walkman::robot::right_arm),
     right_leg(walkman::robot::right_leg),
     left_arm(walkman::robot::left_arm),
@@ -47,9 +71,30 @@ iDynUtils::iDynUtils(const std::string robot_name_,
     head(walkman::robot::head),
     robot_name(robot_name_),
     g(3,0.0),
+    _zero3(3,0.0),
+    _support_polygon_reference_index(-1),
     anchor_name(""),  // temporary value. Will get updated as soon as we load kinematic chains
+    _anchor_candidates_dirty(true),
     world_is_inited(false),
-    _computeDynamics(true)
+    _computeDynamics(true),
+    _lazyUpdate(false),
+    _kinematics_dirty(true),
+    _dynamics_dirty(true),
+    _positions_dirty(true),
+    _model_loaded_from_cache(false),
+    _profiler(profiledStageNames()),
+    _generated_floating_base(-1),
+    _generated_kinematics_dirty(true),
+    _centroidal_floating_base(-1),
+    _centroidal_base_segment(-1),
+    _contact_floating_base(-1),
+    _contact_base_segment(-1),
+    _bias_floating_base(-1),
+    _bias_base_segment(-1),
+    _forward_floating_base(-1),
+    _forward_base_segment(-1),
+    _mass_matrix_factorized(false),
+    _real_time_mode(false)
 {
     worldT.resize(4,4);
     worldT.eye();
@@ -66,22 +111,60 @@ iDynUtils::iDynUtils(const std::string robot_name_,
     else
         std::cout << "The srdf path is empty!" << std::endl;
     
-    bool iDyn3Model_loaded = iDyn3Model();
+    idynutils::model_cache cache;
+    if(model_cache_path != "")
+    {
+        uint64_t hash;
+        if(idynutils::model_cache::computeHash(robot_urdf_folder, robot_srdf_folder, hash))
+        {
+            _model_loaded_from_cache = cache.load(model_cache_path, hash);
+            cache.hash = hash;
+        }
+    }
+
+    bool iDyn3Model_loaded = iDyn3Model(_model_loaded_from_cache ? &cache : NULL);
     if(!iDyn3Model_loaded){
         std::cout<<"Problem Loading iDyn3Model"<<std::endl;
         assert(iDyn3Model_loaded);}
 
-    bool setJointNames_ok = setJointNames();
-    if(!setJointNames_ok){
-        std::cout<<"Problems Setting Joint names"<<std::endl;
-        assert(setJointNames_ok && "No chains found!");}
+    if(_model_loaded_from_cache)
+    {
+        loadModelCache(cache);
+        std::cout<<"Model information loaded from cache "<<model_cache_path<<std::endl;
+    }
+    else
+    {
+        bool setJointNames_ok = setJointNames();
+        if(!setJointNames_ok){
+            std::cout<<"Problems Setting Joint names"<<std::endl;
+            assert(setJointNames_ok && "No chains found!");}
+
+        setControlledKinematicChainsJointNumbers();
+    }
+
+    bool setDOFNames_ok = setDOFNames();
+    if(!setDOFNames_ok){
+        std::cout<<"Active joints do not match the iDynTree DOFs"<<std::endl;
+        assert(setDOFNames_ok && "Active joints do not match the iDynTree DOFs!");}
+
     anchor_name = left_leg.end_effector_name;
 
-    setControlledKinematicChainsJointNumbers();
+    setMoveItVariableIndices();
+    if(!lazy_planning_scene)
+        initPlanningScene();
 
     zeros.resize(iDyn3_model.getNrOfDOFs(),0.0);
     zerosXd.setZero(iDyn3_model.getNrOfDOFs());
 
+    _q_buffer.resize(iDyn3_model.getNrOfDOFs(),0.0);
+    _dq_buffer.resize(iDyn3_model.getNrOfDOFs(),0.0);
+    _ddq_buffer.resize(iDyn3_model.getNrOfDOFs(),0.0);
+
+    _jacobian_buffer.resize(6, iDyn3_model.getNrOfDOFs()+6);
+    _relative_jacobian_buffer.resize(6, iDyn3_model.getNrOfDOFs());
+    _com_jacobian_buffer.resize(6, iDyn3_model.getNrOfDOFs()+6);
+    _mass_matrix_buffer.resize(iDyn3_model.getNrOfDOFs()+6, iDyn3_model.getNrOfDOFs()+6);
+
     links_in_contact.push_back("l_foot_lower_left_link");
     links_in_contact.push_back("l_foot_lower_right_link");
     links_in_contact.push_back("l_foot_upper_left_link");
@@ -90,9 +173,25 @@ iDynUtils::iDynUtils(const std::string robot_name_,
     links_in_contact.push_back("r_foot_lower_right_link");
     links_in_contact.push_back("r_foot_upper_left_link");
     links_in_contact.push_back("r_foot_upper_right_link");
+    for(std::list<std::string>::const_iterator it = links_in_contact.begin(); it != links_in_contact.end(); it++)
+    {
+        int link_index = iDyn3_model.getLinkIndex(*it);
+        if(link_index != -1)
+            _links_in_contact_indices.push_back(link_index);
+    }
+
+    if(!_model_loaded_from_cache)
+    {
+        readForceTorqueSensorsNames();
+        readIMUSensorsNames();
 
-    readForceTorqueSensorsNames();
-    readIMUSensorsNames();
+        if(model_cache_path != "" && cache.hash != 0)
+        {
+            fillModelCache(cache);
+            if(!cache.save(model_cache_path))
+                std::cout<<"Could not write model cache "<<model_cache_path<<std::endl;
+        }
+    }
     _w_R_imu.first = "";
     _w_R_imu.second = yarp::sig::Matrix();
 }
@@ -105,6 +204,32 @@ const std::vector<std::string>& iDynUtils::getFixedJointNames() const {
     return this->fixed_joint_names;
 }
 
+const std::vector<std::string>& iDynUtils::getDOFNames() const {
+    return this->_dof_names;
+}
+
+bool iDynUtils::setDOFNames()
+{
+    _dof_names.assign(iDyn3_model.getNrOfDOFs(), "");
+    if(joint_names.size() != _dof_names.size())
+        return false;
+
+    for(unsigned int i = 0; i < joint_names.size(); ++i)
+    {
+        int dof = iDyn3_model.getDOFIndex(joint_names[i]);
+        if(dof < 0 || dof >= (int)_dof_names.size() || !_dof_names[dof].empty()) {
+            std::cout<<"Joint "<<joint_names[i]<<" is not a DOF of the iDynTree model"<<std::endl;
+            return false;
+        }
+        _dof_names[dof] = joint_names[i];
+    }
+    return true;
+}
+
+const KDL::Tree& iDynUtils::getKDLTree() const {
+    return this->robot_kdl_tree;
+}
+
 bool iDynUtils::findGroupChain(const std::vector<std::string>& chain_list, const std::vector<srdf::Model::Group>& groups,std::string chain_name, int& group_index)
 {
     for (std::vector<std::string>::const_iterator it_chain = chain_list.begin();
@@ -244,7 +369,143 @@ bool iDynUtils::setJointNames()
 
 
 
-bool iDynUtils::iDyn3Model()
+iDynUtils::iDynUtils(const iDynUtils& other, const bool copy_planning_scene) :
+    left_leg(other.left_leg),
+    left_arm(other.left_arm),
+    right_leg(other.right_leg),
+    right_arm(other.right_arm),
+    torso(other.torso),
+    head(other.head),
+    urdf_model(other.urdf_model),
+    robot_srdf(other.robot_srdf),
+    moveit_robot_model(other.moveit_robot_model),
+    zeros(other.zeros),
+    zerosXd(other.zerosXd),
+    _computeDynamics(other._computeDynamics),
+    _lazyUpdate(other._lazyUpdate),
+    _kinematics_dirty(true),
+    _dynamics_dirty(true),
+    _positions_dirty(true),
+    joint_names(other.joint_names),
+    fixed_joint_names(other.fixed_joint_names),
+    _dof_names(other._dof_names),
+    links_in_contact(other.links_in_contact),
+    _links_in_contact_indices(other._links_in_contact_indices),
+    _support_polygon_reference(other._support_polygon_reference),
+    _support_polygon_reference_index(other._support_polygon_reference_index),
+    robot_kdl_tree(other.robot_kdl_tree),
+    anchor_name(other.anchor_name),
+    anchor_T_world(other.anchor_T_world),
+    _anchor_candidates(other._anchor_candidates),
+    _anchor_candidates_dirty(other._anchor_candidates_dirty),
+    _model_loaded_from_cache(other._model_loaded_from_cache),
+    _moveit_variable_indices(other._moveit_variable_indices),
+    worldT(other.worldT),
+    g(other.g),
+    _q_buffer(other._q_buffer),
+    _dq_buffer(other._dq_buffer),
+    _ddq_buffer(other._ddq_buffer),
+    _zero3(other._zero3),
+    _jacobian_buffer(other._jacobian_buffer),
+    _relative_jacobian_buffer(other._relative_jacobian_buffer),
+    _com_jacobian_buffer(other._com_jacobian_buffer),
+    _mass_matrix_buffer(other._mass_matrix_buffer),
+    _joint_state_names(other._joint_state_names),
+    _joint_state_dofs(other._joint_state_dofs),
+    base_link_name(other.base_link_name),
+    robot_name(other.robot_name),
+    robot_urdf_folder(other.robot_urdf_folder),
+    robot_srdf_folder(other.robot_srdf_folder),
+    world_is_inited(other.world_is_inited),
+    _ft_sensor_frames(other._ft_sensor_frames),
+    _imu_sensor_frames(other._imu_sensor_frames),
+    _ft_sensor_joint_names(other._ft_sensor_joint_names),
+    _imu_link_idyntree(other._imu_link_idyntree),
+    _w_R_imu(other._w_R_imu),
+    _profiler(profiledStageNames()),
+    _generated_kinematics(other._generated_kinematics ?
+                              other._generated_kinematics->clone() : NULL),
+    _generated_link_indices(other._generated_link_indices),
+    _generated_floating_base(other._generated_floating_base),
+    _generated_kinematics_dirty(true),
+    _centroidal_dynamics(other._centroidal_dynamics ?
+                             new idynutils::centroidal_dynamics(*other._centroidal_dynamics) : NULL),
+    _centroidal_floating_base(other._centroidal_floating_base),
+    _centroidal_base_segment(other._centroidal_base_segment),
+    _contact_kinematics(other._contact_kinematics ?
+                            new idynutils::contact_kinematics(*other._contact_kinematics) : NULL),
+    _contact_floating_base(other._contact_floating_base),
+    _contact_base_segment(other._contact_base_segment),
+    _bias_kinematics(other._bias_kinematics ?
+                         new idynutils::contact_kinematics(*other._bias_kinematics) : NULL),
+    _bias_link_segments(other._bias_link_segments),
+    _bias_link(other._bias_link),
+    _bias_floating_base(other._bias_floating_base),
+    _bias_base_segment(other._bias_base_segment),
+    _forward_dynamics(other._forward_dynamics ?
+                          new idynutils::forward_dynamics(*other._forward_dynamics) : NULL),
+    _forward_floating_base(other._forward_floating_base),
+    _forward_base_segment(other._forward_base_segment),
+    _mass_matrix_factorization(other._mass_matrix_factorization ?
+                                   new idynutils::mass_matrix_factorization(*other._mass_matrix_factorization) : NULL),
+    _mass_matrix(other._mass_matrix),
+    _mass_matrix_factorized(other._mass_matrix_factorized),
+    _real_time_mode(other._real_time_mode),
+    _joint_bound_min(other._joint_bound_min),
+    _joint_bound_max(other._joint_bound_max),
+    _joint_torque_max(other._joint_torque_max)
+{
+    // the planning scene gets copied (without a parent scene),
+    // robot model and collision geometries are shared
+    if(copy_planning_scene && other.moveit_planning_scene)
+    {
+        moveit_planning_scene = planning_scene::PlanningScene::clone(other.moveit_planning_scene);
+        moveit_collision_robot = moveit_planning_scene->getCollisionRobotNonConst();
+    }
+
+    // iDynTree models can not be copied, we build a new one from the KDL tree
+    iDyn3_model.constructor(robot_kdl_tree, _ft_sensor_joint_names, _imu_link_idyntree);
+
+    // iDynTree getters are not const
+    iCub::iDynTree::DynTree& other_model = const_cast<iCub::iDynTree::DynTree&>(other.iDyn3_model);
+
+    iDyn3_model.setJointBoundMax(other_model.getJointBoundMax());
+    iDyn3_model.setJointBoundMin(other_model.getJointBoundMin());
+    iDyn3_model.setJointTorqueBoundMax(other_model.getJointTorqueMax());
+
+    iDyn3_model.setFloatingBaseLink(other_model.getFloatingBaseLink());
+    iDyn3_model.setWorldBasePose(worldT);
+    iDyn3_model.setAng(other_model.getAng());
+    iDyn3_model.setDAng(other_model.getDAng());
+    iDyn3_model.setD2Ang(other_model.getD2Ang());
+
+    if(!_lazyUpdate)
+    {
+        this->computeKinematics();
+
+        if(_computeDynamics)
+            this->computeDynamics();
+
+        this->computePositions();
+
+        _dynamics_dirty = false;
+    }
+    else if(!other._dynamics_dirty)
+        this->computeDynamics();
+
+    // dynamicRNEA() overwrites the FT measurements, so they are copied after it
+    yarp::sig::Vector ft_measurement;
+    for(int i = 0; i < other_model.getNrOfFTSensors(); ++i)
+        if(other_model.getSensorMeasurement(i, ft_measurement))
+            iDyn3_model.setSensorMeasurement(i, ft_measurement);
+}
+
+boost::shared_ptr<iDynUtils> iDynUtils::clone(const bool copy_planning_scene) const
+{
+    return boost::shared_ptr<iDynUtils>(new iDynUtils(*this, copy_planning_scene));
+}
+
+bool iDynUtils::iDyn3Model(const idynutils::model_cache* cache)
 {
     /// iDyn3 Model creation
     // Giving name to references for FT sensors and IMU
@@ -272,17 +533,17 @@ bool iDynUtils::iDyn3Model()
         {
             std::cout<<"SRDF LOADED"<<std::endl;
 
-            moveit_planning_scene.reset(new planning_scene::PlanningScene(urdf_model, robot_srdf));
-            moveit_robot_model = moveit_planning_scene->getRobotModel();
+            // the planning scene is built by initPlanningScene() on top of this model
+            moveit_robot_model.reset(new moveit::core::RobotModel(urdf_model, robot_srdf));
             std::ostringstream robot_info;
             moveit_robot_model->printModelInfo(robot_info);
-            moveit_collision_robot = moveit_planning_scene->getCollisionRobotNonConst();
             std::cout<<"ROBOT LOADED in MOVEIT!"<<std::endl;
         }
     }
     
+    // sensors and base link are always read from the srdf, so that they are right
+    // also when the cache gets rejected
     std::vector<srdf::Model::Group> groups = robot_srdf->getGroups();
-
     for(std::vector<srdf::Model::Group>::iterator it_groups = groups.begin();
         it_groups != groups.end();
         ++it_groups)
@@ -324,12 +585,44 @@ bool iDynUtils::iDyn3Model()
         imu_link_idyntree = imu_link_names[0]; //The first IMU is used in the constructor of idyntree
     else
         imu_link_idyntree = base_link_name; //The base_link is used as imu_link in idyntree
+
+    if(cache && (cache->base_link_name != base_link_name ||
+                 cache->ft_sensor_joint_names != joint_ft_sensor_names ||
+                 cache->imu_link_idyntree != imu_link_idyntree))
+    {
+        std::cout<<"Model cache sensors are not consistent with the SRDF, ignoring it"<<std::endl;
+        _model_loaded_from_cache = false;
+        cache = NULL;
+    }
     iDyn3_model.constructor(robot_kdl_tree, joint_ft_sensor_names, imu_link_idyntree);
+    _ft_sensor_joint_names = joint_ft_sensor_names;
+    _imu_link_idyntree = imu_link_idyntree;
     std::cout<<"Loaded"<<robot_name<<"in iDynTree!"<<std::endl;
     
     int nJ = iDyn3_model.getNrOfDOFs();
     yarp::sig::Vector qMax; qMax.resize(nJ,0.0);
     yarp::sig::Vector qMin; qMin.resize(nJ,0.0);
+
+    if(cache && !checkModelCache(*cache))
+    {
+        std::cout<<"Model cache is not consistent with the iDynTree model, ignoring it"<<std::endl;
+        _model_loaded_from_cache = false;
+        cache = NULL;
+    }
+
+    if(cache)
+    {
+        yarp::sig::Vector tauMax; tauMax.resize(nJ,1.0);
+        for(int j = 0; j < nJ; ++j) {
+            qMax[j] = cache->joint_bound_max[j];
+            qMin[j] = cache->joint_bound_min[j];
+            tauMax[j] = cache->joint_torque_max[j];
+        }
+        iDyn3_model.setJointBoundMax(qMax);
+        iDyn3_model.setJointBoundMin(qMin);
+        iDyn3_model.setJointTorqueBoundMax(tauMax);
+        return true;
+    }
     
     std::map<std::string, boost::shared_ptr<urdf::Joint> >::iterator i;
     for(i = urdf_model->joints_.begin(); i != urdf_model->joints_.end(); ++i) {
@@ -381,6 +674,202 @@ bool iDynUtils::iDyn3Model()
     return true;
 }
 
+bool iDynUtils::checkModelCache(const idynutils::model_cache& cache) const
+{
+    // iDynTree getters are not const
+    iCub::iDynTree::DynTree& model = const_cast<iCub::iDynTree::DynTree&>(iDyn3_model);
+
+    if(cache.joint_names.size() != (unsigned int)model.getNrOfDOFs())
+        return false;
+
+    for(unsigned int i = 0; i < cache.joint_names.size(); ++i)
+        if(model.getDOFIndex(cache.joint_names[i]) != (int)i)
+            return false;
+
+    for(unsigned int i = 0; i < cache.chains.size(); ++i)
+        for(unsigned int j = 0; j < cache.chains[i].joint_numbers.size(); ++j)
+            if(cache.chains[i].joint_numbers[j] >= cache.joint_names.size())
+                return false;
+
+    return true;
+}
+
+void iDynUtils::loadModelCache(const idynutils::model_cache& cache)
+{
+    joint_names = cache.joint_names;
+    fixed_joint_names = cache.fixed_joint_names;
+    _ft_sensor_frames = cache.ft_sensor_frames;
+    _imu_sensor_frames = cache.imu_sensor_frames;
+
+    kinematic_chain* chains[] = {&left_leg, &left_arm, &right_leg, &right_arm, &torso, &head};
+    for(unsigned int i = 0; i < sizeof(chains)/sizeof(chains[0]); ++i)
+    {
+        for(unsigned int j = 0; j < cache.chains.size(); ++j)
+        {
+            const idynutils::model_cache::chain& cached_chain = cache.chains[j];
+            if(cached_chain.chain_name != chains[i]->chain_name)
+                continue;
+
+            chains[i]->joint_names = cached_chain.joint_names;
+            chains[i]->fixed_joint_names = cached_chain.fixed_joint_names;
+            chains[i]->joint_numbers = cached_chain.joint_numbers;
+            if(!cached_chain.end_effector_name.empty())
+                setChainIndex(cached_chain.end_effector_name, *chains[i]);
+        }
+    }
+}
+
+void iDynUtils::fillModelCache(idynutils::model_cache& cache)
+{
+    cache.joint_names = joint_names;
+    cache.fixed_joint_names = fixed_joint_names;
+    cache.base_link_name = base_link_name;
+    cache.ft_sensor_joint_names = _ft_sensor_joint_names;
+    cache.imu_link_idyntree = _imu_link_idyntree;
+    cache.ft_sensor_frames = _ft_sensor_frames;
+    cache.imu_sensor_frames = _imu_sensor_frames;
+
+    const kinematic_chain* chains[] = {&left_leg, &left_arm, &right_leg, &right_arm, &torso, &head};
+    cache.chains.resize(sizeof(chains)/sizeof(chains[0]));
+    for(unsigned int i = 0; i < cache.chains.size(); ++i)
+    {
+        cache.chains[i].chain_name = chains[i]->chain_name;
+        cache.chains[i].end_effector_name = chains[i]->end_effector_name;
+        cache.chains[i].joint_names = chains[i]->joint_names;
+        cache.chains[i].fixed_joint_names = chains[i]->fixed_joint_names;
+        cache.chains[i].joint_numbers = chains[i]->joint_numbers;
+    }
+
+    yarp::sig::Vector qMax = iDyn3_model.getJointBoundMax();
+    yarp::sig::Vector qMin = iDyn3_model.getJointBoundMin();
+    yarp::sig::Vector tauMax = iDyn3_model.getJointTorqueMax();
+    cache.joint_bound_max.assign(qMax.data(), qMax.data() + qMax.size());
+    cache.joint_bound_min.assign(qMin.data(), qMin.data() + qMin.size());
+    cache.joint_torque_max.assign(tauMax.data(), tauMax.data() + tauMax.size());
+}
+
+bool iDynUtils::isModelLoadedFromCache() const
+{
+    return _model_loaded_from_cache;
+}
+
+idynutils::stage_profiler& iDynUtils::getProfiler()
+{
+    return _profiler;
+}
+
+const idynutils::stage_profiler& iDynUtils::getProfiler() const
+{
+    return _profiler;
+}
+
+bool iDynUtils::setGeneratedKinematics(const boost::shared_ptr<idynutils::generated_kinematics>& kinematics)
+{
+    _generated_kinematics.reset();
+    _generated_link_indices.clear();
+    _generated_floating_base = -1;
+    if(!kinematics)
+        return true;
+
+    uint64_t hash;
+    if(!idynutils::model_cache::computeHash(robot_urdf_folder, robot_srdf_folder, hash) ||
+       hash != kinematics->getModelHash() ||
+       kinematics->getNrOfDOFs() != iDyn3_model.getNrOfDOFs())
+        return false;
+
+    std::vector<int> link_indices(iDyn3_model.getNrOfLinks(), -1);
+    for(unsigned int i = 0; i < kinematics->getNrOfLinks(); ++i)
+    {
+        int idyntree_index = iDyn3_model.getLinkIndex(kinematics->getLinkName(i));
+        if(idyntree_index != -1)
+            link_indices[idyntree_index] = i;
+    }
+    if(std::find(link_indices.begin(), link_indices.end(), -1) != link_indices.end())
+        return false;
+
+    _generated_kinematics = kinematics;
+    _generated_link_indices = link_indices;
+    _generated_floating_base = link_indices[iDyn3_model.getFloatingBaseLink()];
+    _generated_kinematics_dirty = true;
+    return true;
+}
+
+bool iDynUtils::isGeneratedKinematicsEnabled() const
+{
+    return (bool)_generated_kinematics;
+}
+
+void iDynUtils::updateGeneratedKinematics()
+{
+    this->syncJointBuffers();
+    if(!_generated_kinematics_dirty)
+        return;
+
+    _generated_kinematics->setJointPositions(_q_buffer.data());
+    _generated_kinematics_dirty = false;
+}
+
+void iDynUtils::warmup()
+{
+    this->syncJointBuffers();
+
+    _joint_bound_min = cartesian_utils::toEigen(iDyn3_model.getJointBoundMin());
+    _joint_bound_max = cartesian_utils::toEigen(iDyn3_model.getJointBoundMax());
+    _joint_torque_max = cartesian_utils::toEigen(iDyn3_model.getJointTorqueMax());
+
+    // evaluating every stage once, so that all the buffers are allocated
+    this->updateiDyn3Model(_q_buffer, _dq_buffer, _ddq_buffer, world_is_inited);
+    this->computeDynamics();
+    this->computePositions();
+    if(_generated_kinematics)
+        this->updateGeneratedKinematics();
+
+    Eigen::MatrixXd A(6, 6 + iDyn3_model.getNrOfDOFs());
+    Eigen::VectorXd dA_dq(6);
+    this->getCentroidalMomentumMatrix(A, dA_dq);
+
+    if(!_links_in_contact_indices.empty())
+    {
+        const unsigned int k = _links_in_contact_indices.size();
+        Eigen::MatrixXd J(6*k, 6 + iDyn3_model.getNrOfDOFs());
+        Eigen::VectorXd dJ_nu(6*k);
+        this->getContactKinematics(J, dJ_nu);
+    }
+
+    Eigen::VectorXd dJ_nu(6);
+    this->getBiasAcceleration(LinkHandle(iDyn3_model.getFloatingBaseLink()), dJ_nu);
+    this->getCOMBiasAcceleration(dJ_nu.head(3));
+
+    Eigen::VectorXd dnu(6 + iDyn3_model.getNrOfDOFs());
+    this->getForwardDynamics(Eigen::VectorXd::Zero(iDyn3_model.getNrOfDOFs()), dnu);
+    this->factorizeMassMatrix();
+
+    _real_time_mode = true;
+}
+
+void iDynUtils::disableRealTimeMode()
+{
+    _real_time_mode = false;
+}
+
+bool iDynUtils::isRealTimeModeEnabled() const
+{
+    return _real_time_mode;
+}
+
+idynutils::rt_error_ring& iDynUtils::getRealTimeErrors()
+{
+    return _real_time_errors;
+}
+
+KDL::Frame iDynUtils::getWorld_T_GeneratedRoot() const
+{
+    // worldT is the pose of the floating base in world frame
+    KDL::Frame world_T_base;
+    cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+    return world_T_base * _generated_kinematics->getPose(_generated_floating_base).Inverse();
+}
+
 bool iDynUtils::setChainIndex(std::string endeffector_name,kinematic_chain& chain)
 {
     chain.end_effector_name=endeffector_name;
@@ -413,15 +902,57 @@ void iDynUtils::fromIDynToRobot(const yarp::sig::Vector& q,
 
 yarp::sig::Vector iDynUtils::fromJointStateMsgToiDyn(const sensor_msgs::JointStateConstPtr &msg)
 {
-    yarp::sig::Vector q(iDyn3_model.getNrOfDOFs());
+    yarp::sig::Vector q(iDyn3_model.getNrOfDOFs(), 0.0);
 
-    for(unsigned int i = 0; i < msg->position.size(); ++i) {
-        q[iDyn3_model.getDOFIndex(msg->name[i])]=msg->position[i];
-    }
+    this->scatterJointStateMsg(*msg, q.data(), NULL, NULL);
 
     return q;
 }
 
+void iDynUtils::fromJointStateMsgToiDyn(const sensor_msgs::JointStateConstPtr& msg,
+                                        Eigen::Ref<Eigen::VectorXd> q,
+                                        Eigen::Ref<Eigen::VectorXd> dq,
+                                        Eigen::Ref<Eigen::VectorXd> tau)
+{
+    assert(q.size() == iDyn3_model.getNrOfDOFs() &&
+           dq.size() == iDyn3_model.getNrOfDOFs() &&
+           tau.size() == iDyn3_model.getNrOfDOFs());
+
+    this->scatterJointStateMsg(*msg, q.data(), dq.data(), tau.data());
+}
+
+void iDynUtils::scatterJointStateMsg(const sensor_msgs::JointState& msg,
+                                     double* q, double* dq, double* tau)
+{
+    // publishers keep the same joint ordering: only the number of joints and the first and
+    // last names are compared, and the DOF indices get looked up again when they change
+    const unsigned int n = msg.name.size();
+    if(n != _joint_state_names.size() ||
+       (n > 0 && (msg.name[0] != _joint_state_names[0] ||
+                  msg.name[n-1] != _joint_state_names[n-1])))
+    {
+        _joint_state_names.assign(msg.name.begin(), msg.name.end());
+        _joint_state_dofs.resize(msg.name.size());
+        for(unsigned int i = 0; i < msg.name.size(); ++i)
+            _joint_state_dofs[i] = iDyn3_model.getDOFIndex(msg.name[i]);
+    }
+
+    const bool has_velocity = msg.velocity.size() == msg.name.size();
+    const bool has_effort = msg.effort.size() == msg.name.size();
+    for(unsigned int i = 0; i < msg.position.size() && i < _joint_state_dofs.size(); ++i)
+    {
+        const int dof = _joint_state_dofs[i];
+        if(dof == -1)
+            continue;
+
+        q[dof] = msg.position[i];
+        if(dq && has_velocity)
+            dq[dof] = msg.velocity[i];
+        if(tau && has_effort)
+            tau[dof] = msg.effort[i];
+    }
+}
+
 void iDynUtils::initWorldPose()
 {
     // saving old values of Ang,DAng,D2Ang
@@ -438,6 +969,7 @@ void iDynUtils::initWorldPose()
     iDyn3_model.computePositions();
 
     this->anchor_T_world = this->setWorldPose(anchor_name);
+    _anchor_candidates_dirty = true;
 
     // restoring old values for Ang,DAng,D2Ang
     iDyn3_model.setAng(Ang);
@@ -475,23 +1007,26 @@ KDL::Frame iDynUtils::setWorldPose(const std::string& anchor)
     }
 
     iDyn3_model.setWorldBasePose(worldT);
+    _anchor_candidates_dirty = true;
 
     return anchor_T_world;
 }
 
 void iDynUtils::setWorldPose(const KDL::Frame& anchor_T_world, const std::string& anchor)
 {
+    // worldT is written in place, so that no temporary matrix gets allocated
     if(iDyn3_model.getLinkIndex(anchor) != iDyn3_model.getFloatingBaseLink()) {
-        worldT =    KDLtoYarp_position(
+        cartesian_utils::fromKDLFrameToYARPMatrix(
                         anchor_T_world.Inverse()
                         *
-                        iDyn3_model.getPositionKDL(iDyn3_model.getLinkIndex(anchor),iDyn3_model.getFloatingBaseLink())
-                    );
+                        iDyn3_model.getPositionKDL(iDyn3_model.getLinkIndex(anchor),iDyn3_model.getFloatingBaseLink()),
+                        worldT);
     } else {
-        worldT = KDLtoYarp_position(anchor_T_world.Inverse());
+        cartesian_utils::fromKDLFrameToYARPMatrix(anchor_T_world.Inverse(), worldT);
     }
 
     iDyn3_model.setWorldBasePose(worldT);
+    _anchor_candidates_dirty = true;
 }
 
 bool iDynUtils::getWorldPose(KDL::Frame &anchor_T_world, std::string &anchor) const
@@ -511,6 +1046,7 @@ void iDynUtils::setAnchor_T_World(const KDL::Frame& anchor_T_world)
 {
     world_is_inited = true;
     this->anchor_T_world = anchor_T_world;
+    _anchor_candidates_dirty = true;
 }
 
 void iDynUtils::updateiDyn3Model(const yarp::sig::Vector& q,
@@ -518,7 +1054,7 @@ void iDynUtils::updateiDyn3Model(const yarp::sig::Vector& q,
     this->updateiDyn3Model(q,zeros,zeros, set_world_pose);
 }
 
-void iDynUtils::updateiDyn3Model(const Eigen::VectorXd& q,
+void iDynUtils::updateiDyn3Model(const Eigen::Ref<const Eigen::VectorXd>& q,
                                  const bool set_world_pose) {
     this->updateiDyn3Model(q,zerosXd,zerosXd, set_world_pose);
 }
@@ -529,8 +1065,7 @@ void iDynUtils::updateiDyn3Model(const yarp::sig::Vector &q,
 {
     this->updateiDyn3Model(q, zeros, zeros, set_world_pose);
 
-    for(unsigned int i = 0; i < force_torque_measurement.size(); ++i)
-        updateForceTorqueMeasurement(force_torque_measurement[i]);
+    this->updateForceTorqueMeasurements(force_torque_measurement);
 }
 
 void iDynUtils::updateiDyn3Model(const yarp::sig::Vector& q,
@@ -539,8 +1074,8 @@ void iDynUtils::updateiDyn3Model(const yarp::sig::Vector& q,
     this->updateiDyn3Model(q,dq,zeros, set_world_pose);
 }
 
-void iDynUtils::updateiDyn3Model(const Eigen::VectorXd& q,
-                                 const Eigen::VectorXd& dq,
+void iDynUtils::updateiDyn3Model(const Eigen::Ref<const Eigen::VectorXd>& q,
+                                 const Eigen::Ref<const Eigen::VectorXd>& dq,
                                  const bool set_world_pose) {
     this->updateiDyn3Model(q,dq,zerosXd, set_world_pose);
 }
@@ -552,8 +1087,7 @@ void iDynUtils::updateiDyn3Model(const yarp::sig::Vector &q,
 {
     this->updateiDyn3Model(q, dq, zeros, set_world_pose);
 
-    for(unsigned int i = 0; i < force_torque_measurement.size(); ++i)
-        updateForceTorqueMeasurement(force_torque_measurement[i]);
+    this->updateForceTorqueMeasurements(force_torque_measurement);
 }
 
 void iDynUtils::updateiDyn3Model(const yarp::sig::Vector &q,
@@ -564,8 +1098,7 @@ void iDynUtils::updateiDyn3Model(const yarp::sig::Vector &q,
 {
     this->updateiDyn3Model(q, dq, ddq_ref, set_world_pose);
 
-    for(unsigned int i = 0; i < force_torque_measurement.size(); ++i)
-        updateForceTorqueMeasurement(force_torque_measurement[i]);
+    this->updateForceTorqueMeasurements(force_torque_measurement);
 }
 
 void iDynUtils::updateiDyn3Model(const yarp::sig::Vector& q,
@@ -573,54 +1106,138 @@ void iDynUtils::updateiDyn3Model(const yarp::sig::Vector& q,
                                  const yarp::sig::Vector& ddq_ref,
                                  const bool set_world_pose)
 {
+    IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_UPDATE_MODEL);
+
+    // keeping a copy of the joint state, which can then be read without querying iDynTree
+    if(&q != &_q_buffer) {
+        assert(q.size() == _q_buffer.size() &&
+               dq_ref.size() == _dq_buffer.size() &&
+               ddq_ref.size() == _ddq_buffer.size());
+        cartesian_utils::toEigen(_q_buffer) = cartesian_utils::toEigen(q);
+        cartesian_utils::toEigen(_dq_buffer) = cartesian_utils::toEigen(dq_ref);
+        cartesian_utils::toEigen(_ddq_buffer) = cartesian_utils::toEigen(ddq_ref);
+    }
+
     // Here we set these values in our internal model
     iDyn3_model.setAng(q);
     iDyn3_model.setDAng(dq_ref);
     iDyn3_model.setD2Ang(ddq_ref);
+    _anchor_candidates_dirty = true;
 
     // setting the world pose
 
     if(set_world_pose)
     {
-            if(!world_is_inited) {
-                this->initWorldPose();
-                world_is_inited = true;
-            } this->updateWorldPose();
+            {
+                IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_WORLD_POSE);
+                if(!world_is_inited) {
+                    this->initWorldPose();
+                    world_is_inited = true;
+                } this->updateWorldPose();
+            }
 
             // here we check if the user set also IMU orientation measurements
             if(_w_R_imu.first.compare("") != 0 && _w_R_imu.second.rows() == 3 && _w_R_imu.second.cols() == 3)
+            {
+                IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_IMU_ORIENTATION);
                 updateWorldOrientationWithIMU();
+            }
+
+            if(!_anchor_candidates.empty())
+                this->updateAnchorCandidates();
     }
 
-    // This is the fake Inertial Measure
-    g.zero();
-    g[2] = 9.81;
+    _kinematics_dirty = true;
+    _dynamics_dirty = true;
+    _positions_dirty = true;
+    _generated_kinematics_dirty = true;
 
-    // get the rotational part of worldT (w_R_b),
-    // compute the inverse (b_R_w = w_R_b^T) and multiply by w_g
-    // to obtain g expressed in base link coordinates, b_g
-    g = (worldT * iDyn3_model.getPosition(0,iDyn3_model.getFloatingBaseLink())).submatrix(0,2,0,2).transposed() * g;
+    if(!_lazyUpdate)
+    {
+        this->computeKinematics();
 
-    yarp::sig::Vector o(3,0.0);
-    iDyn3_model.setInertialMeasure(o, o, g);
+        if(_computeDynamics)
+            this->computeDynamics();
 
-    iDyn3_model.kinematicRNEA();
+        this->computePositions();
 
-    if(_computeDynamics)
-        iDyn3_model.dynamicRNEA();
+        // when dynamics is disabled, torques are simply not updated
+        _dynamics_dirty = false;
+    }
+}
+
+void iDynUtils::computeKinematics()
+{
+    if(!_kinematics_dirty)
+        return;
+
+    {
+        IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_GRAVITY);
+
+        // This is the fake Inertial Measure
+        // get the rotational part of worldT (w_R_b),
+        // compute the inverse (b_R_w = w_R_b^T) and multiply by w_g
+        // to obtain g expressed in base link coordinates, b_g.
+        // Everything is done on KDL types (on the stack) to avoid temporary yarp matrices
+        KDL::Frame world_T_base;
+        cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+        KDL::Vector b_g = (world_T_base *
+                           iDyn3_model.getPositionKDL(0,iDyn3_model.getFloatingBaseLink())).M.Inverse(
+                                KDL::Vector(0.0, 0.0, 9.81));
+        g[0] = b_g.x();
+        g[1] = b_g.y();
+        g[2] = b_g.z();
+
+        iDyn3_model.setInertialMeasure(_zero3, _zero3, g);
+    }
+
+    {
+        IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_KINEMATIC_RNEA);
+        iDyn3_model.kinematicRNEA();
+    }
+
+    _kinematics_dirty = false;
+}
+
+void iDynUtils::computeDynamics()
+{
+    if(!_dynamics_dirty)
+        return;
+
+    this->computeKinematics();
+
+    IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_DYNAMIC_RNEA);
+    iDyn3_model.dynamicRNEA();
+
+    _dynamics_dirty = false;
+}
+
+void iDynUtils::computePositions()
+{
+    if(!_positions_dirty)
+        return;
 
+    IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_COMPUTE_POSITIONS);
     iDyn3_model.computePositions();
+
+    _positions_dirty = false;
 }
 
-void iDynUtils::updateiDyn3Model(const Eigen::VectorXd& q,
-                                 const Eigen::VectorXd& dq,
-                                 const Eigen::VectorXd& ddq,
+void iDynUtils::updateiDyn3Model(const Eigen::Ref<const Eigen::VectorXd>& q,
+                                 const Eigen::Ref<const Eigen::VectorXd>& dq,
+                                 const Eigen::Ref<const Eigen::VectorXd>& ddq,
                                  const bool set_world_pose)
 {
-    this->updateiDyn3Model(cartesian_utils::fromEigentoYarp(q),
-                           cartesian_utils::fromEigentoYarp(dq),
-                           cartesian_utils::fromEigentoYarp(ddq),
-                           set_world_pose);
+    assert(q.size() == _q_buffer.size() &&
+           dq.size() == _dq_buffer.size() &&
+           ddq.size() == _ddq_buffer.size());
+
+    // we copy the inputs into the preallocated buffers, no temporaries are created
+    cartesian_utils::toEigen(_q_buffer) = q;
+    cartesian_utils::toEigen(_dq_buffer) = dq;
+    cartesian_utils::toEigen(_ddq_buffer) = ddq;
+
+    this->updateiDyn3Model(_q_buffer, _dq_buffer, _ddq_buffer, set_world_pose);
 }
 
 void iDynUtils::setJointNumbers(kinematic_chain& chain)
@@ -646,6 +1263,21 @@ bool iDynUtils::switchAnchor(const std::string& new_anchor)
     if(link_index != -1)
     {
         anchor_name = new_anchor;
+
+        // switching the anchor does not move the world frame: for a candidate,
+        // candidate_T_world is cached and worldT is already right
+        if(!_anchor_candidates_dirty)
+        {
+            for(unsigned int i = 0; i < _anchor_candidates.size(); ++i)
+            {
+                if(_anchor_candidates[i].first == link_index)
+                {
+                    anchor_T_world = _anchor_candidates[i].second;
+                    return true;
+                }
+            }
+        }
+
         anchor_T_world = iDyn3_model.getPositionKDL(link_index, true);
         setWorldPose(anchor_T_world, anchor_name);
 
@@ -654,6 +1286,39 @@ bool iDynUtils::switchAnchor(const std::string& new_anchor)
     return false;
 }
 
+bool iDynUtils::setAnchorCandidates(const std::vector<std::string>& anchors)
+{
+    std::vector<std::pair<int, KDL::Frame> > candidates;
+    for(unsigned int i = 0; i < anchors.size(); ++i)
+    {
+        int link_index = iDyn3_model.getLinkIndex(anchors[i]);
+        if(link_index == -1) {
+            std::cout << "Anchor candidate " << anchors[i] << " does not exist" << std::endl;
+            return false;
+        }
+        candidates.push_back(std::make_pair(link_index, KDL::Frame::Identity()));
+    }
+
+    _anchor_candidates = candidates;
+    _anchor_candidates_dirty = true;
+    return true;
+}
+
+void iDynUtils::updateAnchorCandidates()
+{
+    const int anchor_index = iDyn3_model.getLinkIndex(anchor_name);
+    for(unsigned int i = 0; i < _anchor_candidates.size(); ++i)
+    {
+        std::pair<int, KDL::Frame>& candidate = _anchor_candidates[i];
+        if(candidate.first == anchor_index)
+            candidate.second = anchor_T_world;
+        else
+            candidate.second = iDyn3_model.getPositionKDL(candidate.first, anchor_index) * anchor_T_world;
+    }
+
+    _anchor_candidates_dirty = false;
+}
+
 const std::string iDynUtils::getAnchor() const
 {
     return this->anchor_name;
@@ -705,43 +1370,178 @@ const std::list<std::string>& iDynUtils::getLinksInContact(){
 
 void iDynUtils::setLinksInContact(const std::list<std::string>& list_links_in_contact){
     if(list_links_in_contact.empty())
+    {
         links_in_contact.clear();
+        _links_in_contact_indices.clear();
+    }
     else
     {
         std::list<std::string> tmp_list;
+        std::vector<int> tmp_indices;
         for(std::list<std::string>::const_iterator it = list_links_in_contact.begin(); it != list_links_in_contact.end(); it++)
         {
             int link_index = iDyn3_model.getLinkIndex(*it);
-            if(!(link_index == -1))
+            if(!(link_index == -1)) {
                 tmp_list.push_back(*it);
+                tmp_indices.push_back(link_index);
+            }
         }
 
-        if(!tmp_list.empty())
+        if(!tmp_list.empty()) {
             links_in_contact = tmp_list;
+            _links_in_contact_indices = tmp_indices;
+        }
     }
 
+    this->updateContactKinematicsLinks();
 }
 
-bool iDynUtils::checkCollisionWithWorld()
+void iDynUtils::updateContactKinematicsLinks()
 {
-    return this->checkCollisionWithWorldAt(iDyn3_model.getAng());
-}
+    if(!_contact_kinematics)
+        return;
 
-bool iDynUtils::checkCollisionWithWorldAt(const yarp::sig::Vector& q)
-{
-    this->updateRobotState(q);
-    return moveit_planning_scene->isStateColliding();
+    std::vector<int> contacts;
+    for(std::list<std::string>::const_iterator it = links_in_contact.begin(); it != links_in_contact.end(); ++it)
+    {
+        int link_index = _contact_kinematics->getLinkIndex(*it);
+        if(link_index == -1) {
+            contacts.clear();
+            break;
+        }
+        contacts.push_back(link_index);
+    }
+    _contact_kinematics->setContacts(contacts);
 }
 
-void iDynUtils::resetOccupancyMap()
+bool iDynUtils::getContactKinematics(Eigen::Ref<Eigen::MatrixXd> J,
+                                     Eigen::Ref<Eigen::VectorXd> dJ_nu,
+                                     Eigen::Matrix4d* poses,
+                                     const KDL::Twist& base_velocity)
 {
-    this->moveit_planning_scene->
-        getWorldNonConst()->
-            removeObject(
-                planning_scene::PlanningScene::OCTOMAP_NS);
+    if(!_contact_kinematics) {
+        _contact_kinematics.reset(new idynutils::contact_kinematics(robot_kdl_tree, _dof_names));
+        this->updateContactKinematicsLinks();
+    }
+
+    if(_contact_floating_base != iDyn3_model.getFloatingBaseLink())
+    {
+        std::string floating_base;
+        _contact_floating_base = iDyn3_model.getFloatingBaseLink();
+        iDyn3_model.getLinkName(_contact_floating_base, floating_base);
+        _contact_base_segment = _contact_kinematics->getLinkIndex(floating_base);
+    }
+    if(_contact_base_segment == -1 || _contact_kinematics->getNrOfContacts() == 0)
+        return false;
+
+    this->syncJointBuffers();
+    // worldT is the pose of the floating base in world frame
+    KDL::Frame world_T_base;
+    cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+
+    _contact_kinematics->compute(_contact_base_segment, world_T_base, base_velocity,
+                                 cartesian_utils::toEigen(_q_buffer),
+                                 cartesian_utils::toEigen(_dq_buffer),
+                                 J, dJ_nu);
+
+    if(poses)
+        for(unsigned int c = 0; c < _contact_kinematics->getNrOfContacts(); ++c)
+            cartesian_utils::fromKDLFrameToEigenMatrix(_contact_kinematics->getPose(c), poses[c]);
+    return true;
 }
 
-void iDynUtils::updateOccupancyMap(const octomap_msgs::Octomap& octomapMsg)
+bool iDynUtils::getBiasAcceleration(const LinkHandle& link,
+                                    Eigen::Ref<Eigen::VectorXd> dJ_nu,
+                                    const KDL::Twist& base_velocity)
+{
+    if(!link.isValid())
+        return false;
+
+    if(!_bias_kinematics)
+    {
+        _bias_kinematics.reset(new idynutils::contact_kinematics(robot_kdl_tree, _dof_names));
+        _bias_link.assign(1, -1);
+        _bias_link_segments.assign(iDyn3_model.getNrOfLinks(), -1);
+        std::string link_name;
+        for(unsigned int i = 0; i < _bias_link_segments.size(); ++i) {
+            iDyn3_model.getLinkName(i, link_name);
+            _bias_link_segments[i] = _bias_kinematics->getLinkIndex(link_name);
+        }
+    }
+
+    const int segment = _bias_link_segments[link.getIndex()];
+    if(segment == -1)
+        return false;
+    if(_bias_link[0] != segment) {
+        _bias_link[0] = segment;
+        _bias_kinematics->setContacts(_bias_link);
+    }
+
+    if(_bias_floating_base != iDyn3_model.getFloatingBaseLink())
+    {
+        std::string floating_base;
+        _bias_floating_base = iDyn3_model.getFloatingBaseLink();
+        iDyn3_model.getLinkName(_bias_floating_base, floating_base);
+        _bias_base_segment = _bias_kinematics->getLinkIndex(floating_base);
+    }
+    if(_bias_base_segment == -1)
+        return false;
+
+    this->syncJointBuffers();
+    // worldT is the pose of the floating base in world frame
+    KDL::Frame world_T_base;
+    cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+
+    _bias_kinematics->computeBias(_bias_base_segment, world_T_base, base_velocity,
+                                  cartesian_utils::toEigen(_q_buffer),
+                                  cartesian_utils::toEigen(_dq_buffer),
+                                  dJ_nu);
+    return true;
+}
+
+bool iDynUtils::getCOMBiasAcceleration(Eigen::Ref<Eigen::VectorXd> dJCoM_nu,
+                                       const KDL::Twist& base_velocity)
+{
+    if(!this->updateCentroidalDynamicsBase())
+        return false;
+
+    this->syncJointBuffers();
+    KDL::Frame world_T_base;
+    cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+
+    Eigen::Matrix<double, 6, 1> dA_dq;
+    _centroidal_dynamics->computeBias(_centroidal_base_segment, world_T_base, base_velocity,
+                                      cartesian_utils::toEigen(_q_buffer),
+                                      cartesian_utils::toEigen(_dq_buffer),
+                                      dA_dq);
+
+    // the linear momentum is m dCoM/dt
+    dJCoM_nu = dA_dq.head<3>() / _centroidal_dynamics->getMass();
+    return true;
+}
+
+bool iDynUtils::checkCollisionWithWorld()
+{
+    return this->checkCollisionWithWorldAt(iDyn3_model.getAng());
+}
+
+bool iDynUtils::checkCollisionWithWorldAt(const yarp::sig::Vector& q)
+{
+    IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_WORLD_COLLISION);
+    this->updateRobotState(q);
+    return moveit_planning_scene->isStateColliding();
+}
+
+void iDynUtils::resetOccupancyMap()
+{
+    this->initPlanningScene();
+    this->moveit_planning_scene->
+        getWorldNonConst()->
+            removeObject(
+                planning_scene::PlanningScene::OCTOMAP_NS);
+}
+
+void iDynUtils::updateOccupancyMap(const octomap_msgs::Octomap& octomapMsg)
 {
     this->updateRobotState(iDyn3_model.getAng());
     moveit_planning_scene->processOctomapMsg(octomapMsg);
@@ -779,6 +1579,7 @@ bool iDynUtils::checkSelfCollision()
 bool iDynUtils::checkSelfCollisionAt(const yarp::sig::Vector& q,
                                      std::list< std::pair<std::string,std::string> >* collisionPairs)
 {
+    IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_SELF_COLLISION);
     collision_detection::CollisionRequest req;
     collision_detection::CollisionResult res;
     this->updateRobotState(q);
@@ -820,6 +1621,7 @@ bool iDynUtils::checkCollision()
 
 bool iDynUtils::hasOccupancyMap()
 {
+    this->initPlanningScene();
     return (bool)moveit_planning_scene->
                     getWorld()->
                         getObject(
@@ -845,41 +1647,49 @@ void iDynUtils::loadDisabledCollisionsFromSRDF(srdf::Model& srdf,
 bool iDynUtils::getSupportPolygonPoints(std::list<KDL::Vector>& points,
                                         const std::string referenceFrame)
 {
+    int reference_index = -1;
     if(referenceFrame != "COM" &&
        referenceFrame != "world" &&
-       iDyn3_model.getLinkIndex(referenceFrame) < 0)
-        std::cerr << "ERROR: "
-                  << "trying to get support polygon points in "
-                  << "unknown reference frame "
-                  << referenceFrame << std::endl;
+       (reference_index = iDyn3_model.getLinkIndex(referenceFrame)) < 0)
+    {
+        if(_real_time_mode)
+            _real_time_errors.push("ERROR: trying to get support polygon points in unknown reference frame");
+        else
+            std::cerr << "ERROR: "
+                      << "trying to get support polygon points in "
+                      << "unknown reference frame "
+                      << referenceFrame << std::endl;
+    }
 
     if(links_in_contact.empty() ||
        (referenceFrame != "COM" &&
         referenceFrame != "world" &&
-        iDyn3_model.getLinkIndex(referenceFrame) < 0))
+        reference_index < 0))
         return false;
 
+    this->computePositions();
+
+    // get CoM in the world frame
     KDL::Frame world_T_CoM;
+    if(referenceFrame == "COM")
+        YarptoKDL(iDyn3_model.getCOM(), world_T_CoM.p);
+
     KDL::Frame world_T_point;
     KDL::Frame referenceFrame_T_point;
     KDL::Frame CoM_T_point;
-    for(std::list<std::string>::iterator it = links_in_contact.begin(); it != links_in_contact.end(); it++)
+    for(unsigned int i = 0; i < _links_in_contact_indices.size(); ++i)
     {
         if(referenceFrame == "COM" ||
            referenceFrame == "world")
             // get points in world frame
-            world_T_point = iDyn3_model.getPositionKDL(
-                        iDyn3_model.getLinkIndex(*it));
+            world_T_point = iDyn3_model.getPositionKDL(_links_in_contact_indices[i]);
         else
             referenceFrame_T_point = iDyn3_model.getPositionKDL(
-                        iDyn3_model.getLinkIndex(referenceFrame),
-                        iDyn3_model.getLinkIndex(*it));
+                        reference_index,
+                        _links_in_contact_indices[i]);
 
         if(referenceFrame == "COM")
         {
-            // get CoM in the world frame
-            YarptoKDL(iDyn3_model.getCOM(), world_T_CoM.p);
-
             CoM_T_point = world_T_CoM.Inverse() * world_T_point;
             points.push_back(CoM_T_point.p);
         } else if(referenceFrame == "world")
@@ -890,12 +1700,70 @@ bool iDynUtils::getSupportPolygonPoints(std::list<KDL::Vector>& points,
     return true;
 }
 
+bool iDynUtils::getSupportPolygonPoints(idynutils::support_polygon& points,
+                                        const std::string& referenceFrame)
+{
+    points.clear();
+
+    const bool com_frame = referenceFrame == "COM";
+    const bool world_frame = referenceFrame == "world";
+    if(!com_frame && !world_frame && referenceFrame != _support_polygon_reference)
+    {
+        _support_polygon_reference = referenceFrame;
+        _support_polygon_reference_index = iDyn3_model.getLinkIndex(referenceFrame);
+    }
+    const int reference_index = (com_frame || world_frame) ? -1 : _support_polygon_reference_index;
+    if(_links_in_contact_indices.empty() ||
+       (!com_frame && !world_frame && reference_index < 0))
+        return false;
+
+    this->computePositions();
+
+    // the CoM frame is oriented as the world frame. iDyn3_model.getCOM() allocates a
+    // yarp::sig::Vector, the centroidal dynamics compute the same CoM from worldT and q
+    KDL::Vector world_CoM = KDL::Vector::Zero();
+    if(com_frame)
+    {
+        if(!this->updateCentroidalDynamicsBase())
+            return false;
+
+        this->syncJointBuffers();
+        KDL::Frame world_T_base;
+        cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+        world_CoM = _centroidal_dynamics->computeCOM(_centroidal_base_segment, world_T_base,
+                                                     cartesian_utils::toEigen(_q_buffer));
+    }
+
+    KDL::Frame reference_T_world = KDL::Frame::Identity();
+    if(reference_index >= 0)
+        reference_T_world = iDyn3_model.getPositionKDL(reference_index).Inverse();
+
+    for(unsigned int i = 0; i < _links_in_contact_indices.size(); ++i)
+    {
+        const KDL::Vector world_point = iDyn3_model.getPositionKDL(_links_in_contact_indices[i]).p;
+        bool added;
+        if(com_frame)
+            added = points.push_back(world_point - world_CoM);
+        else if(world_frame)
+            added = points.push_back(world_point);
+        else
+            added = points.push_back(reference_T_world * world_point);
+        if(!added)
+            return false;
+    }
+    return true;
+}
+
 
 void iDynUtils::updateiDyn3ModelFromJoinStateMsg(const sensor_msgs::JointStateConstPtr &msg)
 {
-    yarp::sig::Vector q = this->fromJointStateMsgToiDyn(msg);
+    // the preallocated buffers are used, so that no temporaries are created
+    _q_buffer.zero();
+    _dq_buffer.zero();
+    _ddq_buffer.zero();
+    this->scatterJointStateMsg(*msg, _q_buffer.data(), _dq_buffer.data(), NULL);
 
-    this->updateiDyn3Model(q, true);
+    this->updateiDyn3Model(_q_buffer, _dq_buffer, _ddq_buffer, true);
 }
 
 moveit_msgs::DisplayRobotState iDynUtils::getDisplayRobotStateMsg()
@@ -957,6 +1825,7 @@ moveit_msgs::PlanningScene iDynUtils::getPlanningSceneMsg()
                             components.TRANSFORMS |
                             components.WORLD_OBJECT_GEOMETRY |
                             components.WORLD_OBJECT_NAMES;
+    this->initPlanningScene();
     this->moveit_planning_scene->getPlanningSceneMsg(scene, components);
     #ifdef RVIZ_DOES_NOT_TRANSFORM_OCTOMAP
     if(this->moveit_planning_scene->getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS)) {
@@ -981,46 +1850,84 @@ void iDynUtils::enableDynamicsUpdate()
     this->_computeDynamics = true;
 }
 
-void iDynUtils::updateRobotState(const yarp::sig::Vector& q)
+void iDynUtils::enableLazyUpdate()
+{
+    this->_lazyUpdate = true;
+}
+
+void iDynUtils::disableLazyUpdate()
+{
+    this->_lazyUpdate = false;
+
+    this->computeKinematics();
+    if(_computeDynamics)
+        this->computeDynamics();
+    this->computePositions();
+    _dynamics_dirty = false;
+}
+
+bool iDynUtils::isLazyUpdateEnabled() const
+{
+    return this->_lazyUpdate;
+}
+
+void iDynUtils::setMoveItVariableIndices()
 {
+    _moveit_variable_indices.assign(iDyn3_model.getNrOfDOFs(), -1);
     for(unsigned int i = 0; i < joint_names.size(); ++i) {
-        // TODO once we are sure joint_names are ALWAYS in joint order, this becomes faster
-        moveit_planning_scene->
-            getCurrentStateNonConst().setJointPositions(joint_names[i],
-                                                        &q[iDyn3_model.getDOFIndex(joint_names[i])]);
+        int dof = iDyn3_model.getDOFIndex(joint_names[i]);
+        if(dof != -1)
+            _moveit_variable_indices[dof] =
+                moveit_robot_model->getJointModel(joint_names[i])->getFirstVariableIndex();
     }
-    
-    moveit_planning_scene->getCurrentStateNonConst().updateLinkTransforms();
+}
+
+void iDynUtils::initPlanningScene()
+{
+    if(moveit_planning_scene)
+        return;
+
+    moveit_planning_scene.reset(new planning_scene::PlanningScene(moveit_robot_model));
+    moveit_collision_robot = moveit_planning_scene->getCollisionRobotNonConst();
+}
+
+bool iDynUtils::isPlanningSceneInited() const
+{
+    return (bool)moveit_planning_scene;
+}
+
+void iDynUtils::updateRobotState(const yarp::sig::Vector& q)
+{
+    this->initPlanningScene();
+    IDYNUTILS_PROFILE_STAGE(_profiler, PROFILE_ROBOT_STATE);
+    robot_state::RobotState& state = moveit_planning_scene->getCurrentStateNonConst();
+
+    // only the variables of the iDynTree DOFs are written, by index: the root joint and the
+    // joints without a DOF keep their value, the mimic joints follow the written ones
+    for(unsigned int i = 0; i < _moveit_variable_indices.size(); ++i)
+        if(_moveit_variable_indices[i] != -1)
+            state.setVariablePosition(_moveit_variable_indices[i], q[i]);
+
+    state.updateLinkTransforms();
     Eigen::Affine3d world_T_anchor;
     tf::transformKDLToEigen(this->anchor_T_world.Inverse(), world_T_anchor);
-    Eigen::Affine3d scene_T_base_link =
-        moveit_planning_scene->getCurrentState()
-            .getFrameTransform(this->getBaseLink());
-    Eigen::Affine3d scene_T_anchor =
-        moveit_planning_scene->getCurrentState()
-            .getFrameTransform(anchor_name);
+    Eigen::Affine3d scene_T_base_link = state.getFrameTransform(base_link_name);
+    Eigen::Affine3d scene_T_anchor = state.getFrameTransform(anchor_name);
     // computed so that map == world
     Eigen::Affine3d scene_T_base_link_desired =
         world_T_anchor * scene_T_anchor.inverse() * scene_T_base_link;
     if(moveit_robot_model->getRootJoint()->getType() == moveit::core::JointModel::FLOATING)
     {
         Eigen::Affine3d scene_T_root_link =
-            moveit_planning_scene->getCurrentState()
-                .getFrameTransform(moveit_robot_model->getRootLinkName());
+            state.getFrameTransform(moveit_robot_model->getRootLinkName());
         Eigen::Affine3d base_link_T_root_link =
                 scene_T_base_link.inverse() * scene_T_root_link ;
-        moveit_planning_scene->
-            getCurrentStateNonConst().
-                setJointPositions(
-                    moveit_robot_model->getRootJoint(),
-                    scene_T_base_link_desired * base_link_T_root_link);
-        moveit_planning_scene->
-            getCurrentStateNonConst().update();
+        state.setJointPositions(moveit_robot_model->getRootJoint(),
+                                scene_T_base_link_desired * base_link_T_root_link);
+        state.update();
     }
     else
-        moveit_planning_scene->getCurrentStateNonConst().
-                updateStateWithLinkAt(this->getBaseLink(),
-                                      scene_T_base_link_desired);
+        state.updateStateWithLinkAt(base_link_name, scene_T_base_link_desired);
 }
 
 bool iDynUtils::updateForceTorqueMeasurement(const ft_measure& force_torque_measurement)
@@ -1037,6 +1944,17 @@ bool iDynUtils::updateForceTorqueMeasurement(const ft_measure& force_torque_meas
     return false;
 }
 
+void iDynUtils::updateForceTorqueMeasurements(const std::vector<ft_measure>& force_torque_measurement)
+{
+    // dynamicRNEA() overwrites the FT measurements: in lazy mode it would run
+    // in the first getter, after the measurements are set, so we run it now
+    if(_lazyUpdate)
+        this->computeDynamics();
+
+    for(unsigned int i = 0; i < force_torque_measurement.size(); ++i)
+        updateForceTorqueMeasurement(force_torque_measurement[i]);
+}
+
 //TODO: ADD CHECK THAT JOINT EXISTS
 bool iDynUtils::readForceTorqueSensorsNames()
 {
@@ -1121,63 +2039,214 @@ void iDynUtils::updateWorldOrientationWithIMU()
 
 KDL::Frame iDynUtils::getPose(const std::string& first_link, const std::string& second_link)
 {
-    int first_link_id = iDyn3_model.getLinkIndex(first_link);
-    if(first_link_id == -1){
-        yarp::sig::Vector zeros(16, 0.0);
-        KDL::Frame T;
-        T.Make4x4(zeros.data());
-        return T;}
-
-    int second_link_id = iDyn3_model.getLinkIndex(second_link);
-    if(second_link_id == -1){
-        yarp::sig::Vector zeros(16, 0.0);
-        KDL::Frame T;
-        T.Make4x4(zeros.data());
-        return T;}
-
-    return iDyn3_model.getPositionKDL(first_link_id, second_link_id);
+    return this->getPose(this->getLinkHandle(first_link),
+                         this->getLinkHandle(second_link));
 }
 
 KDL::Frame iDynUtils::getPose(const std::string& link)
 {
-    int link_id = iDyn3_model.getLinkIndex(link);
-    if(link_id == -1){
-        yarp::sig::Vector zeros(16, 0.0);
-        KDL::Frame T;
-        T.Make4x4(zeros.data());
-        return T;}
-
-    return iDyn3_model.getPositionKDL(link_id);
+    return this->getPose(this->getLinkHandle(link));
 }
 
 KDL::Vector iDynUtils::getCoM(const std::string& link)
 {
     if(link.compare("world") == 0)
+    {
+        if(_generated_kinematics) {
+            this->updateGeneratedKinematics();
+            return this->getWorld_T_GeneratedRoot() * _generated_kinematics->getCOM();
+        }
+
+        this->computePositions();
         return iDyn3_model.getCOMKDL();
+    }
 
-    int link_id = iDyn3_model.getLinkIndex(link);
-    if(link_id == -1){
-        KDL::Vector v;
-        v.Zero();
-        return v;}
-    return iDyn3_model.getCOMKDL(link_id);
+    return this->getCoM(this->getLinkHandle(link));
+}
+
+LinkHandle iDynUtils::getLinkHandle(const std::string& link) const
+{
+    return LinkHandle(iDyn3_model.getLinkIndex(link));
+}
+
+/**
+ * @brief zeroFrame is the frame returned by the pose queries when a link does not exist
+ */
+static KDL::Frame zeroFrame()
+{
+    return KDL::Frame(KDL::Rotation(0.0, 0.0, 0.0,
+                                    0.0, 0.0, 0.0,
+                                    0.0, 0.0, 0.0),
+                      KDL::Vector::Zero());
+}
+
+KDL::Frame iDynUtils::getPose(const LinkHandle& first_link, const LinkHandle& second_link)
+{
+    if(!first_link.isValid() || !second_link.isValid())
+        return zeroFrame();
+
+    if(_generated_kinematics) {
+        this->updateGeneratedKinematics();
+        return _generated_kinematics->getPose(_generated_link_indices[first_link._index]).Inverse() *
+               _generated_kinematics->getPose(_generated_link_indices[second_link._index]);
+    }
+
+    this->computePositions();
+
+    return iDyn3_model.getPositionKDL(first_link._index, second_link._index);
+}
+
+KDL::Frame iDynUtils::getPose(const LinkHandle& link)
+{
+    if(!link.isValid())
+        return zeroFrame();
+
+    if(_generated_kinematics) {
+        this->updateGeneratedKinematics();
+        return this->getWorld_T_GeneratedRoot() *
+               _generated_kinematics->getPose(_generated_link_indices[link._index]);
+    }
+
+    this->computePositions();
+
+    return iDyn3_model.getPositionKDL(link._index);
+}
+
+KDL::Vector iDynUtils::getCoM(const LinkHandle& link)
+{
+    if(!link.isValid())
+        return KDL::Vector::Zero();
+
+    this->computePositions();
+
+    return iDyn3_model.getCOMKDL(link._index);
+}
+
+bool iDynUtils::getPoses(const std::vector<LinkHandle>& links, Eigen::Matrix4d* poses)
+{
+    this->computePositions();
+
+    bool all_valid = true;
+    for(unsigned int i = 0; i < links.size(); ++i)
+    {
+        if(links[i].isValid())
+            cartesian_utils::fromKDLFrameToEigenMatrix(
+                iDyn3_model.getPositionKDL(links[i]._index), poses[i]);
+        else {
+            poses[i].setZero();
+            all_valid = false;
+        }
+    }
+    return all_valid;
+}
+
+bool iDynUtils::getPoses(const std::vector<LinkHandle>& links,
+                         const LinkHandle& reference_link,
+                         Eigen::Matrix4d* poses)
+{
+    if(!reference_link.isValid())
+    {
+        for(unsigned int i = 0; i < links.size(); ++i)
+            poses[i].setZero();
+        return false;
+    }
+
+    this->computePositions();
+
+    // the reference pose gets inverted only once for all the links
+    KDL::Frame reference_T_world = iDyn3_model.getPositionKDL(reference_link._index).Inverse();
+
+    bool all_valid = true;
+    for(unsigned int i = 0; i < links.size(); ++i)
+    {
+        if(links[i].isValid())
+            cartesian_utils::fromKDLFrameToEigenMatrix(
+                reference_T_world * iDyn3_model.getPositionKDL(links[i]._index), poses[i]);
+        else {
+            poses[i].setZero();
+            all_valid = false;
+        }
+    }
+    return all_valid;
 }
 
 bool iDynUtils::getJacobian(const int distal_link_index, Eigen::MatrixXd& J)
 {
-    yarp::sig::Matrix tmp;
-    bool a = iDyn3_model.getJacobian(distal_link_index, tmp);
+    this->computePositions();
+
+    bool a = iDyn3_model.getJacobian(distal_link_index, _jacobian_buffer);
     if(a)
-        J = cartesian_utils::toEigen(tmp);
+        J = cartesian_utils::toEigen(_jacobian_buffer);
+    return a;
+}
+
+bool iDynUtils::getJacobian(const int distal_link_index, Eigen::Ref<Eigen::MatrixXd> J)
+{
+    this->computePositions();
+
+    bool a = iDyn3_model.getJacobian(distal_link_index, _jacobian_buffer);
+    if(a) {
+        assert(J.rows() == _jacobian_buffer.rows() && J.cols() == _jacobian_buffer.cols());
+        J = cartesian_utils::toEigen(_jacobian_buffer);
+    }
+    return a;
+}
+
+bool iDynUtils::getJacobian(const int distal_link_index,
+                            const kinematic_chain& chain,
+                            Eigen::Ref<Eigen::MatrixXd> J)
+{
+    assert(J.rows() == 6 && J.cols() == (int)chain.getNrOfDOFs());
+
+    this->computePositions();
+
+    bool a = iDyn3_model.getJacobian(distal_link_index, _jacobian_buffer);
+    if(a) {
+        // the first 6 columns of the Jacobian are relative to the floating base
+        Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> >
+            J_full = cartesian_utils::toEigen(
+                        static_cast<const yarp::sig::Matrix&>(_jacobian_buffer));
+        for(unsigned int i = 0; i < chain.joint_numbers.size(); ++i)
+            J.col(i) = J_full.col(6 + chain.joint_numbers[i]);
+    }
     return a;
 }
 
+bool iDynUtils::getJacobian(const LinkHandle& distal_link, Eigen::MatrixXd& J)
+{
+    if(!distal_link.isValid())
+        return false;
+
+    return this->getJacobian(distal_link._index, J);
+}
+
+bool iDynUtils::getJacobian(const LinkHandle& distal_link, Eigen::Ref<Eigen::MatrixXd> J)
+{
+    if(!distal_link.isValid())
+        return false;
+
+    return this->getJacobian(distal_link._index, J);
+}
+
 bool iDynUtils::getCOMJacobian(Eigen::MatrixXd& JCoM)
 {
-    yarp::sig::Matrix tmp;
-    bool a = iDyn3_model.getCOMJacobian(tmp);
+    this->computePositions();
+
+    bool a = iDyn3_model.getCOMJacobian(_com_jacobian_buffer);
     if(a)
-        JCoM = cartesian_utils::toEigen(tmp);
+        JCoM = cartesian_utils::toEigen(_com_jacobian_buffer);
+    return a;
+}
+
+bool iDynUtils::getCOMJacobian(Eigen::Ref<Eigen::MatrixXd> JCoM)
+{
+    this->computePositions();
+
+    bool a = iDyn3_model.getCOMJacobian(_com_jacobian_buffer);
+    if(a) {
+        assert(JCoM.rows() == _com_jacobian_buffer.rows() && JCoM.cols() == _com_jacobian_buffer.cols());
+        JCoM = cartesian_utils::toEigen(_com_jacobian_buffer);
+    }
     return a;
 }
 
@@ -1186,26 +2255,94 @@ bool iDynUtils::getRelativeJacobian(const int distal_link_index,
                          Eigen::MatrixXd& J,
                          bool global)
 {
-    yarp::sig::Matrix tmp;
+    this->computePositions();
+
     bool a = iDyn3_model.getRelativeJacobian(distal_link_index, base_link_index,
-                                             tmp, global);
+                                             _relative_jacobian_buffer, global);
     if(a)
-        J = cartesian_utils::toEigen(tmp);
+        J = cartesian_utils::toEigen(_relative_jacobian_buffer);
     return a;
 }
 
+bool iDynUtils::getRelativeJacobian(const int distal_link_index,
+                                    const int base_link_index,
+                                    Eigen::Ref<Eigen::MatrixXd> J,
+                                    bool global)
+{
+    this->computePositions();
+
+    bool a = iDyn3_model.getRelativeJacobian(distal_link_index, base_link_index,
+                                             _relative_jacobian_buffer, global);
+    if(a) {
+        assert(J.rows() == _relative_jacobian_buffer.rows() && J.cols() == _relative_jacobian_buffer.cols());
+        J = cartesian_utils::toEigen(_relative_jacobian_buffer);
+    }
+    return a;
+}
+
+bool iDynUtils::getRelativeJacobian(const int distal_link_index,
+                                    const int base_link_index,
+                                    const kinematic_chain& chain,
+                                    Eigen::Ref<Eigen::MatrixXd> J,
+                                    bool global)
+{
+    assert(J.rows() == 6 && J.cols() == (int)chain.getNrOfDOFs());
+
+    this->computePositions();
+
+    bool a = iDyn3_model.getRelativeJacobian(distal_link_index, base_link_index,
+                                             _relative_jacobian_buffer, global);
+    if(a) {
+        // the relative Jacobian has no floating base columns
+        Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> >
+            J_full = cartesian_utils::toEigen(
+                        static_cast<const yarp::sig::Matrix&>(_relative_jacobian_buffer));
+        for(unsigned int i = 0; i < chain.joint_numbers.size(); ++i)
+            J.col(i) = J_full.col(chain.joint_numbers[i]);
+    }
+    return a;
+}
+
+bool iDynUtils::getRelativeJacobian(const LinkHandle& distal_link,
+                                    const LinkHandle& base_link,
+                                    Eigen::MatrixXd& J,
+                                    bool global)
+{
+    if(!distal_link.isValid() || !base_link.isValid())
+        return false;
+
+    return this->getRelativeJacobian(distal_link._index, base_link._index, J, global);
+}
+
+bool iDynUtils::getRelativeJacobian(const LinkHandle& distal_link,
+                                    const LinkHandle& base_link,
+                                    Eigen::Ref<Eigen::MatrixXd> J,
+                                    bool global)
+{
+    if(!distal_link.isValid() || !base_link.isValid())
+        return false;
+
+    return this->getRelativeJacobian(distal_link._index, base_link._index, J, global);
+}
+
 Eigen::VectorXd iDynUtils::getCOM(const int link_index)
 {
+    this->computePositions();
+
     return cartesian_utils::toEigen(iDyn3_model.getCOM(link_index));
 }
 
 Eigen::MatrixXd iDynUtils::getPosition(const int link_index, bool inverse)
 {
+    this->computePositions();
+
     return cartesian_utils::toEigen(iDyn3_model.getPosition(link_index, inverse));
 }
 
 Eigen::MatrixXd iDynUtils::getPosition(const int first_link, const int second_link)
 {
+    this->computePositions();
+
     return cartesian_utils::toEigen(iDyn3_model.getPosition(first_link, second_link));
 }
 
@@ -1226,6 +2363,9 @@ Eigen::VectorXd iDynUtils::getJointTorqueMax()
 
 Eigen::VectorXd iDynUtils::getTorques()
 {
+    if(_lazyUpdate)
+        this->computeDynamics();
+
     return cartesian_utils::toEigen(iDyn3_model.getTorques());
 }
 
@@ -1239,31 +2379,237 @@ Eigen::VectorXd iDynUtils::getDAng()
     return cartesian_utils::toEigen(iDyn3_model.getDAng());
 }
 
+void iDynUtils::getJointBoundMin(Eigen::Ref<Eigen::VectorXd> bound)
+{
+    if(_real_time_mode)
+        bound = _joint_bound_min;
+    else
+        bound = cartesian_utils::toEigen(iDyn3_model.getJointBoundMin());
+}
+
+void iDynUtils::getJointBoundMax(Eigen::Ref<Eigen::VectorXd> bound)
+{
+    if(_real_time_mode)
+        bound = _joint_bound_max;
+    else
+        bound = cartesian_utils::toEigen(iDyn3_model.getJointBoundMax());
+}
+
+void iDynUtils::getJointTorqueMax(Eigen::Ref<Eigen::VectorXd> tau_max)
+{
+    if(_real_time_mode)
+        tau_max = _joint_torque_max;
+    else
+        tau_max = cartesian_utils::toEigen(iDyn3_model.getJointTorqueMax());
+}
+
+void iDynUtils::getTorques(Eigen::Ref<Eigen::VectorXd> tau)
+{
+    if(_lazyUpdate)
+        this->computeDynamics();
+
+    tau = cartesian_utils::toEigen(iDyn3_model.getTorques());
+}
+
+void iDynUtils::getAng(Eigen::Ref<Eigen::VectorXd> q) const
+{
+    if(_real_time_mode)
+        q = cartesian_utils::toEigen(_q_buffer);
+    else
+        q = cartesian_utils::toEigen(iDyn3_model.getAng());
+}
+
+void iDynUtils::getDAng(Eigen::Ref<Eigen::VectorXd> dq) const
+{
+    if(_real_time_mode)
+        dq = cartesian_utils::toEigen(_dq_buffer);
+    else
+        dq = cartesian_utils::toEigen(iDyn3_model.getDAng());
+}
+
+void iDynUtils::syncJointBuffers()
+{
+    if(_real_time_mode)
+        return;
+
+    const yarp::sig::Vector q = iDyn3_model.getAng();
+    if(cartesian_utils::toEigen(q) != cartesian_utils::toEigen(_q_buffer))
+    {
+        cartesian_utils::toEigen(_q_buffer) = cartesian_utils::toEigen(q);
+        _generated_kinematics_dirty = true;
+        _anchor_candidates_dirty = true;
+    }
+    _dq_buffer = iDyn3_model.getDAng();
+}
+
 Eigen::VectorXd iDynUtils::setAng(const Eigen::VectorXd& q)
 {
-    return cartesian_utils::toEigen(iDyn3_model.setAng(
-                                        cartesian_utils::fromEigentoYarp(q)));
+    _generated_kinematics_dirty = true;
+    _anchor_candidates_dirty = true;
+    if(_lazyUpdate) {
+        _kinematics_dirty = true;
+        _dynamics_dirty = true;
+        _positions_dirty = true;
+    }
+
+    assert(q.size() == _q_buffer.size());
+    cartesian_utils::toEigen(_q_buffer) = q;
+    return cartesian_utils::toEigen(iDyn3_model.setAng(_q_buffer));
 }
 
 Eigen::VectorXd iDynUtils::getVelCOM()
 {
+    this->computeKinematics();
+    this->computePositions();
+
     return cartesian_utils::toEigen(iDyn3_model.getVelCOM());
 }
 
 bool iDynUtils::getFloatingBaseMassMatrix(Eigen::MatrixXd & fb_mass_matrix)
 {
-    yarp::sig::Matrix M(iDyn3_model.getNrOfDOFs()+6, iDyn3_model.getNrOfDOFs()+6);
-    bool a = iDyn3_model.getFloatingBaseMassMatrix(M);
+    this->computePositions();
+
+    bool a = iDyn3_model.getFloatingBaseMassMatrix(_mass_matrix_buffer);
     if(a)
-        fb_mass_matrix = cartesian_utils::toEigen(M);
+        fb_mass_matrix = cartesian_utils::toEigen(_mass_matrix_buffer);
+    return a;
+}
+
+bool iDynUtils::getFloatingBaseMassMatrix(Eigen::Ref<Eigen::MatrixXd> fb_mass_matrix)
+{
+    this->computePositions();
+
+    bool a = iDyn3_model.getFloatingBaseMassMatrix(_mass_matrix_buffer);
+    if(a) {
+        assert(fb_mass_matrix.rows() == _mass_matrix_buffer.rows() &&
+               fb_mass_matrix.cols() == _mass_matrix_buffer.cols());
+        fb_mass_matrix = cartesian_utils::toEigen(_mass_matrix_buffer);
+    }
     return a;
 }
 
 Eigen::VectorXd iDynUtils::getCentroidalMomentum()
 {
+    this->computeKinematics();
+    this->computePositions();
+
     return cartesian_utils::toEigen(iDyn3_model.getCentroidalMomentum());
 }
 
+bool iDynUtils::updateCentroidalDynamicsBase()
+{
+    if(!_centroidal_dynamics)
+        _centroidal_dynamics.reset(new idynutils::centroidal_dynamics(robot_kdl_tree, _dof_names));
+
+    if(_centroidal_floating_base != iDyn3_model.getFloatingBaseLink())
+    {
+        std::string floating_base;
+        _centroidal_floating_base = iDyn3_model.getFloatingBaseLink();
+        iDyn3_model.getLinkName(_centroidal_floating_base, floating_base);
+        _centroidal_base_segment = _centroidal_dynamics->getLinkIndex(floating_base);
+    }
+    return _centroidal_base_segment != -1;
+}
+
+bool iDynUtils::getCentroidalMomentumMatrix(Eigen::Ref<Eigen::MatrixXd> A,
+                                            Eigen::Ref<Eigen::VectorXd> dA_dq,
+                                            const KDL::Twist& base_velocity)
+{
+    this->syncJointBuffers();
+    if(!this->updateCentroidalDynamicsBase())
+        return false;
+
+    // worldT is the pose of the floating base in world frame
+    KDL::Frame world_T_base;
+    cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+
+    _centroidal_dynamics->compute(_centroidal_base_segment, world_T_base, base_velocity,
+                                  cartesian_utils::toEigen(_q_buffer),
+                                  cartesian_utils::toEigen(_dq_buffer),
+                                  A, dA_dq);
+    return true;
+}
+
+bool iDynUtils::updateForwardDynamicsBase()
+{
+    if(!_forward_dynamics)
+        _forward_dynamics.reset(new idynutils::forward_dynamics(robot_kdl_tree, _dof_names));
+
+    if(_forward_floating_base != iDyn3_model.getFloatingBaseLink())
+    {
+        std::string floating_base;
+        _forward_floating_base = iDyn3_model.getFloatingBaseLink();
+        iDyn3_model.getLinkName(_forward_floating_base, floating_base);
+        _forward_base_segment = _forward_dynamics->getLinkIndex(floating_base);
+        if(_mass_matrix_factorization && _forward_base_segment != -1)
+            _mass_matrix_factorization->setFloatingBase(floating_base);
+    }
+    return _forward_base_segment != -1;
+}
+
+bool iDynUtils::getForwardDynamics(const Eigen::Ref<const Eigen::VectorXd>& tau,
+                                   Eigen::Ref<Eigen::VectorXd> dnu,
+                                   const KDL::Twist& base_velocity)
+{
+    if(!this->updateForwardDynamicsBase())
+        return false;
+
+    this->syncJointBuffers();
+    // worldT is the pose of the floating base in world frame. Gravity is given in world frame
+    // (g is in floating base coordinates, and updated lazily)
+    KDL::Frame world_T_base;
+    cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+
+    _forward_dynamics->computeAccelerations(_forward_base_segment, world_T_base, base_velocity,
+                                            cartesian_utils::toEigen(_q_buffer),
+                                            cartesian_utils::toEigen(_dq_buffer),
+                                            tau, KDL::Vector(0.0, 0.0, -9.81), dnu);
+    return true;
+}
+
+bool iDynUtils::getMassMatrix(Eigen::Ref<Eigen::MatrixXd> M)
+{
+    if(!this->updateForwardDynamicsBase())
+        return false;
+
+    this->syncJointBuffers();
+    KDL::Frame world_T_base;
+    cartesian_utils::fromYARPMatrixtoKDLFrame(worldT, world_T_base);
+
+    _forward_dynamics->computeMassMatrix(_forward_base_segment, world_T_base,
+                                         cartesian_utils::toEigen(_q_buffer), M);
+    return true;
+}
+
+bool iDynUtils::factorizeMassMatrix()
+{
+    _mass_matrix_factorized = false;
+    if(!this->updateForwardDynamicsBase())
+        return false;
+
+    if(!_mass_matrix_factorization)
+    {
+        std::string floating_base;
+        iDyn3_model.getLinkName(_forward_floating_base, floating_base);
+        _mass_matrix_factorization.reset(new idynutils::mass_matrix_factorization(robot_kdl_tree, _dof_names));
+        _mass_matrix_factorization->setFloatingBase(floating_base);
+        _mass_matrix.resize(_mass_matrix_factorization->getSize(), _mass_matrix_factorization->getSize());
+    }
+
+    this->getMassMatrix(_mass_matrix);
+    _mass_matrix_factorized = _mass_matrix_factorization->factorize(_mass_matrix);
+    return _mass_matrix_factorized;
+}
+
+bool iDynUtils::solveMassMatrix(Eigen::Ref<Eigen::MatrixXd> X) const
+{
+    if(!_mass_matrix_factorized)
+        return false;
+
+    _mass_matrix_factorization->solve(X);
+    return true;
+}
+
 bool iDynUtils::getSensorMeasurement(const int sensor_index, Eigen::VectorXd &ftm)
 {
     yarp::sig::Vector tmp;
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/incremental_kinematics.h>
+#include <idynutils/cartesian_utils.h>
+#include <algorithm>
+#include <cassert>
+
+using namespace idynutils;
+
+incremental_kinematics::incremental_kinematics(const iDynUtils& model) :
+    _tree(model),
+    _q(Eigen::VectorXd::Zero(_tree.getNrOfDOFs())),
+    _poses(_tree.getNrOfSegments(), KDL::Frame::Identity()),
+    _changed(_tree.getNrOfSegments(), 1),
+    _dirty(true),
+    _updated_links(0)
+{
+    // iDynTree getters are not const
+    iCub::iDynTree::DynTree& idyntree = const_cast<iCub::iDynTree::DynTree&>(model.iDyn3_model);
+
+    _q = cartesian_utils::toEigen(idyntree.getAng());
+    update();
+
+    // the root of the KDL tree may not be a link of iDynTree, the world pose of the
+    // root gets computed from the first link known by both
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        int idyntree_index = idyntree.getLinkIndex(_tree.getSegmentName(i));
+        if(idyntree_index != -1) {
+            setWorldPose(idyntree.getPositionKDL(idyntree_index) * _poses[i].Inverse());
+            break;
+        }
+    }
+}
+
+void incremental_kinematics::setJointPositions(const Eigen::Ref<const Eigen::VectorXd>& q)
+{
+    assert(q.size() == _q.size());
+
+    for(int i = 0; i < _q.size(); ++i)
+    {
+        if(_q[i] != q[i]) {
+            _q[i] = q[i];
+            _changed[_tree.getDOFSegment(i)] = 1;
+            _dirty = true;
+        }
+    }
+}
+
+void incremental_kinematics::setJointPositions(const kinematic_chain& chain,
+                                               const Eigen::Ref<const Eigen::VectorXd>& q_chain)
+{
+    assert(q_chain.size() == (int)chain.joint_numbers.size());
+
+    for(unsigned int i = 0; i < chain.joint_numbers.size(); ++i)
+    {
+        const unsigned int dof = chain.joint_numbers[i];
+        if(_q[dof] != q_chain[i]) {
+            _q[dof] = q_chain[i];
+            _changed[_tree.getDOFSegment(dof)] = 1;
+            _dirty = true;
+        }
+    }
+}
+
+void incremental_kinematics::setWorldPose(const KDL::Frame& world_T_root)
+{
+    _poses[0] = world_T_root;
+    _changed[0] = 1;
+    _dirty = true;
+}
+
+int incremental_kinematics::getLinkIndex(const std::string& link) const
+{
+    return _tree.getSegmentIndex(link);
+}
+
+void incremental_kinematics::update()
+{
+    if(!_dirty)
+        return;
+
+    _updated_links = 0;
+
+    // segments are sorted depth-first: the subtree of segment i is [i, i + subtree size),
+    // so a single pass recomputes all the subtrees of the changed segments
+    unsigned int recompute_until = 0;
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        if(_changed[i]) {
+            recompute_until = std::max(recompute_until, i + _tree.getSubtreeSize(i));
+            _changed[i] = 0;
+        }
+
+        if(i < recompute_until && i > 0)
+        {
+            const int dof = _tree.getDOF(i);
+            _poses[i] = _poses[_tree.getParent(i)] * _tree.getSegment(i).pose(dof == -1 ? 0.0 : _q[dof]);
+            ++_updated_links;
+        }
+    }
+
+    _dirty = false;
+}
+
+const KDL::Frame& incremental_kinematics::getPose(const int link)
+{
+    update();
+    return _poses[link];
+}
+
+KDL::Frame incremental_kinematics::getPose(const int first_link, const int second_link)
+{
+    update();
+    return _poses[first_link].Inverse() * _poses[second_link];
+}
+
+void incremental_kinematics::getJacobian(const int link, Eigen::Ref<Eigen::MatrixXd> J)
+{
+    assert(J.rows() == 6 && J.cols() == _q.size());
+
+    update();
+
+    J.setZero();
+    const KDL::Vector& p_link = _poses[link].p;
+
+    // walking up to the root, every moving segment contributes with its joint column
+    for(int i = link; i > 0; i = _tree.getParent(i))
+    {
+        const int dof = _tree.getDOF(i);
+        if(dof == -1)
+            continue;
+
+        const KDL::Frame& w_T_parent = _poses[_tree.getParent(i)];
+        const KDL::Joint& joint = _tree.getSegment(i).getJoint();
+        KDL::Vector axis = w_T_parent.M * joint.JointAxis();
+
+        KDL::Vector linear = KDL::Vector::Zero();
+        KDL::Vector angular = KDL::Vector::Zero();
+        if(joint.getType() == KDL::Joint::TransAxis ||
+           joint.getType() == KDL::Joint::TransX ||
+           joint.getType() == KDL::Joint::TransY ||
+           joint.getType() == KDL::Joint::TransZ)
+            linear = axis;
+        else {
+            linear = axis * (p_link - w_T_parent * joint.JointOrigin());
+            angular = axis;
+        }
+
+        J(0,dof) = linear.x(); J(1,dof) = linear.y(); J(2,dof) = linear.z();
+        J(3,dof) = angular.x(); J(4,dof) = angular.y(); J(5,dof) = angular.z();
+    }
+}
+
+unsigned int incremental_kinematics::getNrOfUpdatedLinks() const
+{
+    return _updated_links;
+}
+
+const kinematic_tree& incremental_kinematics::getTree() const
+{
+    return _tree;
+}
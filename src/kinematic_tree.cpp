@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/kinematic_tree.h>
+#include <idynutils/idynutils.h>
+#include <algorithm>
+#include <cassert>
+
+using namespace idynutils;
+
+kinematic_tree::kinematic_tree(const KDL::Tree& tree, const std::vector<std::string>& joint_names)
+{
+    init(tree, joint_names);
+}
+
+kinematic_tree::kinematic_tree(const iDynUtils& model)
+{
+    init(model.getKDLTree(), model.getDOFNames());
+}
+
+void kinematic_tree::init(const KDL::Tree& tree, const std::vector<std::string>& joint_names)
+{
+    _dof_segment.assign(joint_names.size(), 0);
+    _segments.reserve(tree.getNrOfSegments()+1);
+    _parents.reserve(tree.getNrOfSegments()+1);
+    _dofs.reserve(tree.getNrOfSegments()+1);
+    _subtree_sizes.reserve(tree.getNrOfSegments()+1);
+
+    addSubtree(tree.getRootSegment(), -1, joint_names);
+
+    // segment 0 is the root, which is not moved by any DOF
+    for(unsigned int dof = 0; dof < _dof_segment.size(); ++dof)
+        assert(_dof_segment[dof] != 0 && "joint_names contains a joint which is not in the tree");
+}
+
+void kinematic_tree::addSubtree(const KDL::SegmentMap::const_iterator& element,
+                                const int parent,
+                                const std::vector<std::string>& joint_names)
+{
+    const KDL::Segment& segment = element->second.segment;
+    const int index = _segments.size();
+
+    int dof = -1;
+    if(parent != -1 && segment.getJoint().getType() != KDL::Joint::None)
+    {
+        std::vector<std::string>::const_iterator joint =
+            std::find(joint_names.begin(), joint_names.end(), segment.getJoint().getName());
+        if(joint != joint_names.end()) {
+            dof = joint - joint_names.begin();
+            _dof_segment[dof] = index;
+        }
+    }
+
+    _segments.push_back(segment);
+    _parents.push_back(parent);
+    _dofs.push_back(dof);
+    _subtree_sizes.push_back(1);
+    _segment_indices[element->first] = index;
+
+    for(unsigned int i = 0; i < element->second.children.size(); ++i)
+        addSubtree(element->second.children[i], index, joint_names);
+
+    _subtree_sizes[index] = _segments.size() - index;
+}
+
+int kinematic_tree::getSegmentIndex(const std::string& name) const
+{
+    std::map<std::string, int>::const_iterator it = _segment_indices.find(name);
+    if(it == _segment_indices.end())
+        return -1;
+    return it->second;
+}
+
+void kinematic_tree::getCarriers(const unsigned int base, std::vector<int>& carriers) const
+{
+    carriers.assign(_segments.size(), -1);
+    for(unsigned int s = 1; s < _segments.size(); ++s)
+    {
+        if(_dofs[s] == -1)
+            continue;
+
+        // the path goes up from s to the common ancestor with base, then down to base
+        int i = s;
+        if(!isAncestor(s, base))
+        {
+            for(i = _parents[s]; !isAncestor(i, base); i = _parents[i])
+                if(_dofs[i] != -1)
+                    break;
+            if(!isAncestor(i, base)) {
+                carriers[s] = i;
+                continue;
+            }
+        }
+
+        // i is the common ancestor (s itself if s is on the path to base):
+        // the last DOF met going up from base is the carrier
+        for(int j = base; j != i; j = _parents[j])
+            if(_dofs[j] != -1)
+                carriers[s] = j;
+    }
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/mass_matrix_factorization.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace idynutils;
+
+mass_matrix_factorization::mass_matrix_factorization(const KDL::Tree& tree,
+                                                     const std::vector<std::string>& joint_names) :
+    _tree(tree, joint_names),
+    _order(6 + _tree.getNrOfDOFs(), 0),
+    _parents(6 + _tree.getNrOfDOFs(), -1),
+    _H(6 + _tree.getNrOfDOFs(), 6 + _tree.getNrOfDOFs()),
+    _inverse_sqrt_D(6 + _tree.getNrOfDOFs()),
+    _x(6 + _tree.getNrOfDOFs()),
+    _factorized(false),
+    _has_floating_base(false)
+{
+
+}
+
+/**
+ * @brief depthOf the number of DOFs carrying segment, given the segment of the DOF carrying
+ * each segment (-1 if it is only carried by the floating base)
+ */
+static int depthOf(const int segment, const std::vector<int>& carriers, std::vector<int>& depths)
+{
+    if(depths[segment] == -1)
+        depths[segment] = carriers[segment] == -1 ? 0 : depthOf(carriers[segment], carriers, depths) + 1;
+    return depths[segment];
+}
+
+bool mass_matrix_factorization::setFloatingBase(const std::string& link)
+{
+    const int base = _tree.getSegmentIndex(link);
+    if(base == -1)
+        return false;
+
+    const unsigned int nSegments = _tree.getNrOfSegments();
+    std::vector<int> carriers;
+    _tree.getCarriers(base, carriers);
+    std::vector<int> segments;
+    for(unsigned int s = 1; s < nSegments; ++s)
+        if(_tree.getDOF(s) != -1)
+            segments.push_back(s);
+
+    std::vector<int> depths(nSegments, -1);
+    std::vector<std::pair<int,int> > sorted;
+    for(unsigned int k = 0; k < segments.size(); ++k)
+        sorted.push_back(std::make_pair(depthOf(segments[k], carriers, depths), segments[k]));
+    std::sort(sorted.begin(), sorted.end());
+
+    // the floating base comes first, then every DOF after its carrier
+    std::vector<int> positions(nSegments, -1);
+    for(int k = 0; k < 6; ++k) {
+        _order[k] = k;
+        _parents[k] = k - 1;
+    }
+    for(unsigned int k = 0; k < sorted.size(); ++k)
+    {
+        const int s = sorted[k].second;
+        positions[s] = 6 + k;
+        _order[6 + k] = 6 + _tree.getDOF(s);
+        _parents[6 + k] = carriers[s] == -1 ? 5 : positions[carriers[s]];
+    }
+
+    _has_floating_base = true;
+    _factorized = false;
+    return true;
+}
+
+bool mass_matrix_factorization::factorize(const Eigen::Ref<const Eigen::MatrixXd>& M)
+{
+    const int n = this->getSize();
+    assert(M.rows() == n && M.cols() == n);
+
+    _factorized = false;
+    if(!_has_floating_base)
+        return false;
+
+    for(int c = 0; c < n; ++c)
+        for(int r = c; r < n; ++r)
+            _H(r, c) = M(_order[r], _order[c]);
+
+    // LTDL: the rows are eliminated from the leaves, each one only updating its carriers
+    for(int k = n - 1; k >= 0; --k)
+    {
+        if(_H(k, k) <= 0.0)
+            return false;
+
+        for(int i = _parents[k]; i != -1; i = _parents[i])
+        {
+            const double a = _H(k, i) / _H(k, k);
+            for(int j = i; j != -1; j = _parents[j])
+                _H(i, j) -= a * _H(k, j);
+            _H(k, i) = a;
+        }
+        _inverse_sqrt_D[k] = 1.0 / std::sqrt(_H(k, k));
+    }
+
+    _factorized = true;
+    return true;
+}
+
+void mass_matrix_factorization::multiplyByInverseSqrt(Eigen::Ref<Eigen::MatrixXd> X) const
+{
+    const int n = this->getSize();
+    assert(_factorized && X.rows() == n);
+
+    for(int c = 0; c < X.cols(); ++c)
+    {
+        for(int k = 0; k < n; ++k)
+            _x[k] = X(_order[k], c);
+
+        // L^-T
+        for(int k = n - 1; k >= 0; --k)
+            for(int i = _parents[k]; i != -1; i = _parents[i])
+                _x[i] -= _H(k, i) * _x[k];
+
+        X.col(c) = _x.cwiseProduct(_inverse_sqrt_D);
+    }
+}
+
+void mass_matrix_factorization::multiplyByInverseSqrtTranspose(Eigen::Ref<Eigen::MatrixXd> X) const
+{
+    const int n = this->getSize();
+    assert(_factorized && X.rows() == n);
+
+    for(int c = 0; c < X.cols(); ++c)
+    {
+        _x = X.col(c).cwiseProduct(_inverse_sqrt_D);
+
+        // L^-1
+        for(int k = 0; k < n; ++k)
+            for(int i = _parents[k]; i != -1; i = _parents[i])
+                _x[k] -= _H(k, i) * _x[i];
+
+        for(int k = 0; k < n; ++k)
+            X(_order[k], c) = _x[k];
+    }
+}
+
+void mass_matrix_factorization::solve(Eigen::Ref<Eigen::MatrixXd> X) const
+{
+    this->multiplyByInverseSqrt(X);
+    this->multiplyByInverseSqrtTranspose(X);
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/model_cache.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace idynutils;
+
+namespace {
+
+const char MAGIC[8] = {'I','D','Y','N','C','A','C','H'};
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+bool hashFile(const std::string& path, uint64_t& hash)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if(!file.is_open())
+        return false;
+
+    char buffer[4096];
+    while(file.good())
+    {
+        file.read(buffer, sizeof(buffer));
+        for(std::streamsize i = 0; i < file.gcount(); ++i)
+        {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= FNV_PRIME;
+        }
+    }
+    return file.eof();
+}
+
+/**
+ * @brief The reader class reads the cache content from a memory-mapped buffer,
+ * checking that no read goes past the end of the buffer
+ */
+class reader
+{
+public:
+    reader(const char* data, const size_t size) :
+        _data(data), _size(size), _offset(0), _ok(true) {}
+
+    bool ok() const { return _ok; }
+
+    void read(void* out, const size_t n)
+    {
+        if(!_ok || _size - _offset < n) {
+            _ok = false;
+            return;
+        }
+        std::memcpy(out, _data + _offset, n);
+        _offset += n;
+    }
+
+    template <typename T> void read(T& value)
+    {
+        read(&value, sizeof(T));
+    }
+
+    void read(std::string& s)
+    {
+        uint32_t length = 0;
+        read(length);
+        if(!_ok || _size - _offset < length) {
+            _ok = false;
+            return;
+        }
+        s.assign(_data + _offset, length);
+        _offset += length;
+    }
+
+    template <typename T> void read(std::vector<T>& v)
+    {
+        uint32_t length = 0;
+        read(length);
+        // every element takes at least one byte
+        if(!_ok || _size - _offset < length) {
+            _ok = false;
+            return;
+        }
+        v.resize(length);
+        for(uint32_t i = 0; i < length && _ok; ++i)
+            read(v[i]);
+    }
+
+    void read(model_cache::chain& c)
+    {
+        read(c.chain_name);
+        read(c.end_effector_name);
+        read(c.joint_names);
+        read(c.fixed_joint_names);
+        read(c.joint_numbers);
+    }
+
+private:
+    const char* _data;
+    size_t _size;
+    size_t _offset;
+    bool _ok;
+};
+
+class writer
+{
+public:
+    writer(std::ostream& out) : _out(out) {}
+
+    template <typename T> void write(const T& value)
+    {
+        _out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void write(const std::string& s)
+    {
+        write(static_cast<uint32_t>(s.size()));
+        _out.write(s.data(), s.size());
+    }
+
+    template <typename T> void write(const std::vector<T>& v)
+    {
+        write(static_cast<uint32_t>(v.size()));
+        for(unsigned int i = 0; i < v.size(); ++i)
+            write(v[i]);
+    }
+
+    void write(const model_cache::chain& c)
+    {
+        write(c.chain_name);
+        write(c.end_effector_name);
+        write(c.joint_names);
+        write(c.fixed_joint_names);
+        write(c.joint_numbers);
+    }
+
+private:
+    std::ostream& _out;
+};
+
+}
+
+const uint32_t model_cache::VERSION;
+
+model_cache::model_cache() :
+    hash(0)
+{
+
+}
+
+bool model_cache::computeHash(const std::string& urdf_path,
+                              const std::string& srdf_path,
+                              uint64_t& hash)
+{
+    hash = FNV_OFFSET_BASIS;
+    if(!hashFile(urdf_path, hash))
+        return false;
+
+    // separating the two files, so that moving content from one to the other changes the hash
+    hash ^= 0xFF;
+    hash *= FNV_PRIME;
+
+    return hashFile(srdf_path, hash);
+}
+
+bool model_cache::load(const std::string& cache_path, const uint64_t expected_hash)
+{
+    int fd = open(cache_path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = file_stat.st_size;
+    void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+        return false;
+
+    reader r(static_cast<const char*>(mapped), size);
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    r.read(magic, sizeof(MAGIC));
+    r.read(version);
+    r.read(hash);
+
+    bool ok = r.ok() &&
+              std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+              version == VERSION &&
+              hash == expected_hash;
+
+    if(ok)
+    {
+        r.read(joint_names);
+        r.read(fixed_joint_names);
+        r.read(chains);
+        r.read(base_link_name);
+        r.read(ft_sensor_joint_names);
+        r.read(imu_link_idyntree);
+        r.read(ft_sensor_frames);
+        r.read(imu_sensor_frames);
+        r.read(joint_bound_min);
+        r.read(joint_bound_max);
+        r.read(joint_torque_max);
+
+        ok = r.ok() &&
+             joint_bound_min.size() == joint_names.size() &&
+             joint_bound_max.size() == joint_names.size() &&
+             joint_torque_max.size() == joint_names.size();
+    }
+
+    munmap(mapped, size);
+    return ok;
+}
+
+bool model_cache::save(const std::string& cache_path) const
+{
+    std::string tmp_path = cache_path + ".tmp";
+    {
+        std::ofstream file(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+            return false;
+
+        writer w(file);
+        file.write(MAGIC, sizeof(MAGIC));
+        w.write(VERSION);
+        w.write(hash);
+        w.write(joint_names);
+        w.write(fixed_joint_names);
+        w.write(chains);
+        w.write(base_link_name);
+        w.write(ft_sensor_joint_names);
+        w.write(imu_link_idyntree);
+        w.write(ft_sensor_frames);
+        w.write(imu_sensor_frames);
+        w.write(joint_bound_min);
+        w.write(joint_bound_max);
+        w.write(joint_torque_max);
+
+        file.flush();
+        if(!file.good()) {
+            file.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(tmp_path.c_str(), cache_path.c_str()) == 0;
+}
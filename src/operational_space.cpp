@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/operational_space.h>
+#include <cassert>
+
+using namespace idynutils;
+
+operational_space::operational_space(const iDynUtils& model) :
+    _factorization(model.getKDLTree(), model.getDOFNames()),
+    _M(_factorization.getSize(), _factorization.getSize()),
+    _floating_base(-1),
+    _factorized(false),
+    _workspaces(1)
+{
+
+}
+
+bool operational_space::update(iDynUtils& model)
+{
+    _factorized = false;
+    if(!model.getFloatingBaseMassMatrix(_M))
+        return false;
+
+    if(_floating_base != model.iDyn3_model.getFloatingBaseLink())
+    {
+        std::string floating_base;
+        _floating_base = model.iDyn3_model.getFloatingBaseLink();
+        model.iDyn3_model.getLinkName(_floating_base, floating_base);
+        if(!_factorization.setFloatingBase(floating_base)) {
+            _floating_base = -1;
+            return false;
+        }
+    }
+
+    _factorized = _factorization.factorize(_M);
+    return _factorized;
+}
+
+bool operational_space::compute(const task& t)
+{
+    return this->compute(t, _workspaces[0]);
+}
+
+bool operational_space::compute(const std::vector<task>& tasks)
+{
+    if(_workspaces.size() < tasks.size())
+        _workspaces.resize(tasks.size());
+
+    bool success = true;
+    for(unsigned int i = 0; i < tasks.size(); ++i)
+        success = this->compute(tasks[i], _workspaces[i]) && success;
+    return success;
+}
+
+bool operational_space::compute(const task& t, workspace& w)
+{
+    if(!_factorized)
+        return false;
+
+    assert(t.J && t.J->cols() == _factorization.getSize());
+    const Eigen::MatrixXd& J = *t.J;
+    const unsigned int m = J.rows();
+    const unsigned int n = J.cols();
+
+    // with M^-1 = S' S, J M^-1 J' = Z' Z and M^-1 J' = S' Z
+    w.Z = J.transpose();
+    _factorization.multiplyByInverseSqrt(w.Z);
+    w.Lambda_inverse.resize(m, m);
+    w.Lambda_inverse.noalias() = w.Z.transpose()*w.Z;
+    w.llt.compute(w.Lambda_inverse);
+    if(w.llt.info() != Eigen::Success)
+        return false;
+
+    if(t.Lambda) {
+        t.Lambda->setIdentity(m, m);
+        w.llt.solveInPlace(*t.Lambda);
+    }
+
+    if(!t.Minv_JT && !t.Jbar && !t.N)
+        return true;
+
+    w.Minv_JT = w.Z;
+    _factorization.multiplyByInverseSqrtTranspose(w.Minv_JT);
+    if(t.Minv_JT)
+        *t.Minv_JT = w.Minv_JT;
+
+    if(!t.Jbar && !t.N)
+        return true;
+
+    // Jbar' = Lambda (M^-1 J')'
+    w.JbarT = w.Minv_JT.transpose();
+    w.llt.solveInPlace(w.JbarT);
+    if(t.Jbar)
+        *t.Jbar = w.JbarT.transpose();
+
+    if(t.N) {
+        t.N->setIdentity(n, n);
+        t.N->noalias() -= w.JbarT.transpose()*J;
+    }
+
+    return true;
+}
+
+void operational_space::solve(Eigen::Ref<Eigen::MatrixXd> X) const
+{
+    assert(_factorized);
+    _factorization.solve(X);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/rt_error_ring.h>
+
+using namespace idynutils;
+
+const unsigned int rt_error_ring::CAPACITY;
+
+rt_error_ring::rt_error_ring() :
+    _head(0),
+    _tail(0),
+    _dropped(0)
+{
+
+}
+
+bool rt_error_ring::push(const char* message, const char* context)
+{
+    // _head and _tail grow forever, unsigned overflow keeps their difference right
+    const unsigned int head = _head.load(boost::memory_order_relaxed);
+    if(head - _tail.load(boost::memory_order_acquire) == CAPACITY) {
+        _dropped.fetch_add(1, boost::memory_order_relaxed);
+        return false;
+    }
+
+    error& e = _errors[head % CAPACITY];
+    e.message = message;
+    e.context = context;
+    _head.store(head + 1, boost::memory_order_release);
+    return true;
+}
+
+bool rt_error_ring::pop(error& e)
+{
+    const unsigned int tail = _tail.load(boost::memory_order_relaxed);
+    if(tail == _head.load(boost::memory_order_acquire))
+        return false;
+
+    e = _errors[tail % CAPACITY];
+    _tail.store(tail + 1, boost::memory_order_release);
+    return true;
+}
+
+unsigned int rt_error_ring::print(std::ostream& out)
+{
+    unsigned int printed = 0;
+    error e;
+    while(this->pop(e)) {
+        out << e.message;
+        if(e.context)
+            out << " (" << e.context << ")";
+        out << std::endl;
+        ++printed;
+    }
+
+    const unsigned int dropped = _dropped.exchange(0, boost::memory_order_relaxed);
+    if(dropped > 0)
+        out << dropped << " more errors dropped" << std::endl;
+
+    return printed;
+}
+
+unsigned int rt_error_ring::getNrOfDroppedErrors() const
+{
+    return _dropped.load(boost::memory_order_relaxed);
+}
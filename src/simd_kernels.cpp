@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/simd_kernels.h>
+#include <math.h>
+
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/* A packet holds one double for every lane. Data in the blocks is not guaranteed
+ * to be aligned to the vector size, so unaligned loads and stores are used. */
+#if defined(__AVX512F__)
+
+const unsigned int LANES = 8;
+typedef __m512d packet;
+inline packet pload(const double* p) { return _mm512_loadu_pd(p); }
+inline void pstore(double* p, const packet& a) { _mm512_storeu_pd(p, a); }
+inline packet pset1(const double a) { return _mm512_set1_pd(a); }
+inline packet padd(const packet& a, const packet& b) { return _mm512_add_pd(a, b); }
+inline packet psub(const packet& a, const packet& b) { return _mm512_sub_pd(a, b); }
+inline packet pmul(const packet& a, const packet& b) { return _mm512_mul_pd(a, b); }
+inline packet pmadd(const packet& a, const packet& b, const packet& c) { return _mm512_fmadd_pd(a, b, c); }
+
+#elif defined(__AVX__)
+
+const unsigned int LANES = 4;
+typedef __m256d packet;
+inline packet pload(const double* p) { return _mm256_loadu_pd(p); }
+inline void pstore(double* p, const packet& a) { _mm256_storeu_pd(p, a); }
+inline packet pset1(const double a) { return _mm256_set1_pd(a); }
+inline packet padd(const packet& a, const packet& b) { return _mm256_add_pd(a, b); }
+inline packet psub(const packet& a, const packet& b) { return _mm256_sub_pd(a, b); }
+inline packet pmul(const packet& a, const packet& b) { return _mm256_mul_pd(a, b); }
+#if defined(__FMA__)
+inline packet pmadd(const packet& a, const packet& b, const packet& c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+inline packet pmadd(const packet& a, const packet& b, const packet& c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+
+#else
+
+const unsigned int LANES = 4;
+struct packet { double v[LANES]; };
+inline packet pload(const double* p) { packet r; for(unsigned int i = 0; i < LANES; ++i) r.v[i] = p[i]; return r; }
+inline void pstore(double* p, const packet& a) { for(unsigned int i = 0; i < LANES; ++i) p[i] = a.v[i]; }
+inline packet pset1(const double a) { packet r; for(unsigned int i = 0; i < LANES; ++i) r.v[i] = a; return r; }
+inline packet padd(const packet& a, const packet& b) { packet r; for(unsigned int i = 0; i < LANES; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+inline packet psub(const packet& a, const packet& b) { packet r; for(unsigned int i = 0; i < LANES; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+inline packet pmul(const packet& a, const packet& b) { packet r; for(unsigned int i = 0; i < LANES; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+inline packet pmadd(const packet& a, const packet& b, const packet& c) { packet r; for(unsigned int i = 0; i < LANES; ++i) r.v[i] = a.v[i] * b.v[i] + c.v[i]; return r; }
+
+#endif
+
+/* a pose of the block: R is row-major */
+struct packet_frame
+{
+    packet R[9];
+    packet p[3];
+};
+
+inline void loadFrame(const double* data, packet_frame& T)
+{
+    for(unsigned int k = 0; k < 9; ++k) T.R[k] = pload(data + k*LANES);
+    for(unsigned int k = 0; k < 3; ++k) T.p[k] = pload(data + (9+k)*LANES);
+}
+
+inline void storeFrame(const packet_frame& T, double* data)
+{
+    for(unsigned int k = 0; k < 9; ++k) pstore(data + k*LANES, T.R[k]);
+    for(unsigned int k = 0; k < 3; ++k) pstore(data + (9+k)*LANES, T.p[k]);
+}
+
+/* T.p += T.R * v */
+inline void translate(packet_frame& T, const packet v[3])
+{
+    for(unsigned int r = 0; r < 3; ++r)
+        T.p[r] = pmadd(T.R[3*r+2], v[2], pmadd(T.R[3*r+1], v[1], pmadd(T.R[3*r], v[0], T.p[r])));
+}
+
+/* T.R = T.R * M */
+inline void rotate(packet_frame& T, const packet M[9])
+{
+    for(unsigned int r = 0; r < 3; ++r)
+    {
+        const packet a = T.R[3*r], b = T.R[3*r+1], c = T.R[3*r+2];
+        for(unsigned int col = 0; col < 3; ++col)
+            T.R[3*r+col] = pmadd(c, M[6+col], pmadd(b, M[3+col], pmul(a, M[col])));
+    }
+}
+
+}
+
+using namespace idynutils::simd_kernels;
+
+unsigned int idynutils::simd_kernels::getNrOfLanes()
+{
+    return LANES;
+}
+
+void idynutils::simd_kernels::computeBlock(const segment_motion* motions,
+                                           const unsigned int* segments,
+                                           const unsigned int nr_of_segments,
+                                           const double* q_block,
+                                           double* poses_block)
+{
+    double c[LANES], s[LANES];
+    packet_frame T;
+
+    for(unsigned int i = 0; i < nr_of_segments; ++i)
+    {
+        const unsigned int segment = segments[i];
+        const segment_motion& motion = motions[segment];
+
+        loadFrame(poses_block + motion.parent*12*LANES, T);
+
+        if(motion.dof != -1)
+        {
+            const double* q = q_block + motion.dof*LANES;
+            const packet origin[3] = {pset1(motion.origin[0]), pset1(motion.origin[1]), pset1(motion.origin[2])};
+            translate(T, origin);
+
+            const packet ax = pset1(motion.axis[0]), ay = pset1(motion.axis[1]), az = pset1(motion.axis[2]);
+            if(motion.revolute)
+            {
+                for(unsigned int l = 0; l < LANES; ++l) {
+                    c[l] = cos(q[l]);
+                    s[l] = sin(q[l]);
+                }
+                const packet cq = pload(c), sq = pload(s);
+                const packet t = psub(pset1(1.0), cq);
+                const packet tx = pmul(t, ax), ty = pmul(t, ay), tz = pmul(t, az);
+                const packet sx = pmul(sq, ax), sy = pmul(sq, ay), sz = pmul(sq, az);
+
+                // Rodrigues' formula, R = cos(q) I + sin(q) [axis]x + (1 - cos(q)) axis axis^T
+                packet M[9];
+                M[0] = pmadd(tx, ax, cq); M[1] = psub(pmul(tx, ay), sz); M[2] = pmadd(tx, az, sy);
+                M[3] = pmadd(tx, ay, sz); M[4] = pmadd(ty, ay, cq);      M[5] = psub(pmul(ty, az), sx);
+                M[6] = psub(pmul(tx, az), sy); M[7] = pmadd(ty, az, sx); M[8] = pmadd(tz, az, cq);
+                rotate(T, M);
+            }
+            else
+            {
+                const packet qq = pload(q);
+                const packet d[3] = {pmul(ax, qq), pmul(ay, qq), pmul(az, qq)};
+                translate(T, d);
+            }
+        }
+
+        packet B_position[3], B_rotation[9];
+        for(unsigned int k = 0; k < 3; ++k) B_position[k] = pset1(motion.B_position[k]);
+        for(unsigned int k = 0; k < 9; ++k) B_rotation[k] = pset1(motion.B_rotation[k]);
+        translate(T, B_position);
+        rotate(T, B_rotation);
+
+        storeFrame(T, poses_block + segment*12*LANES);
+    }
+}
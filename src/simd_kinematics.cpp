@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/simd_kinematics.h>
+#include <idynutils/cartesian_utils.h>
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+using namespace idynutils;
+
+simd_kinematics::simd_kinematics(const iDynUtils& model, const std::vector<std::string>& links) :
+    _tree(model),
+    _motions(_tree.getNrOfSegments()),
+    _links_valid(true),
+    _q_block(_tree.getNrOfDOFs()*simd_kernels::getNrOfLanes(), 0.0),
+    _poses_block(_tree.getNrOfSegments()*12*simd_kernels::getNrOfLanes(), 0.0)
+{
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        const KDL::Segment& segment = _tree.getSegment(i);
+        const KDL::Joint& joint = segment.getJoint();
+        simd_kernels::segment_motion& motion = _motions[i];
+
+        motion.parent = _tree.getParent(i);
+        motion.dof = _tree.getDOF(i);
+        motion.revolute = false;
+
+        KDL::Vector origin = KDL::Vector::Zero();
+        KDL::Vector axis = KDL::Vector::Zero();
+        KDL::Frame B = segment.pose(0.0);
+        if(motion.dof != -1)
+        {
+            // segment.pose(q) = joint.pose(q) * f_tip, with
+            // joint.pose(q) = Trans(origin) * Rot(axis, q) for revolute joints
+            // joint.pose(q) = Trans(origin + axis * q) for prismatic joints
+            origin = joint.JointOrigin();
+            axis = joint.JointAxis();
+            motion.revolute = !(joint.getType() == KDL::Joint::TransAxis ||
+                                joint.getType() == KDL::Joint::TransX ||
+                                joint.getType() == KDL::Joint::TransY ||
+                                joint.getType() == KDL::Joint::TransZ);
+            B = joint.pose(0.0).Inverse() * segment.pose(0.0);
+        }
+
+        for(unsigned int k = 0; k < 3; ++k) {
+            motion.origin[k] = origin[k];
+            motion.axis[k] = axis[k];
+            motion.B_position[k] = B.p[k];
+            for(unsigned int c = 0; c < 3; ++c)
+                motion.B_rotation[3*k+c] = B.M(k,c);
+        }
+    }
+
+    // only the segments from the root to the requested links are computed
+    std::vector<char> needed(_tree.getNrOfSegments(), 0);
+    for(unsigned int i = 0; i < links.size(); ++i)
+    {
+        int link = _tree.getSegmentIndex(links[i]);
+        _links.push_back(link);
+        if(link == -1) {
+            std::cerr << "simd_kinematics: link " << links[i] << " does not exist" << std::endl;
+            _links_valid = false;
+        }
+        for(; link > 0; link = _tree.getParent(link))
+            needed[link] = 1;
+    }
+    for(unsigned int i = 1; i < _tree.getNrOfSegments(); ++i)
+        if(needed[i])
+            _segments_to_compute.push_back(i);
+
+    // the root of the KDL tree may not be a link of iDynTree, the world pose of the
+    // root gets computed from the first link known by both
+    iCub::iDynTree::DynTree& idyntree = const_cast<iCub::iDynTree::DynTree&>(model.iDyn3_model);
+    const Eigen::VectorXd q = cartesian_utils::toEigen(idyntree.getAng());
+    setWorldPose(KDL::Frame::Identity());
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        int idyntree_index = idyntree.getLinkIndex(_tree.getSegmentName(i));
+        if(idyntree_index != -1) {
+            KDL::Frame root_T_link = KDL::Frame::Identity();
+            for(int link = i; link > 0; link = _tree.getParent(link)) {
+                const int dof = _tree.getDOF(link);
+                root_T_link = _tree.getSegment(link).pose(dof == -1 ? 0.0 : q[dof]) * root_T_link;
+            }
+            setWorldPose(idyntree.getPositionKDL(idyntree_index) * root_T_link.Inverse());
+            break;
+        }
+    }
+}
+
+void simd_kinematics::setWorldPose(const KDL::Frame& world_T_root)
+{
+    const unsigned int LANES = simd_kernels::getNrOfLanes();
+    double* data = &_poses_block[0];
+    for(unsigned int r = 0; r < 3; ++r) {
+        for(unsigned int c = 0; c < 3; ++c)
+            std::fill(data + (3*r+c)*LANES, data + (3*r+c+1)*LANES, world_T_root.M(r,c));
+        std::fill(data + (9+r)*LANES, data + (10+r)*LANES, world_T_root.p[r]);
+    }
+}
+
+bool simd_kinematics::evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q, double* poses)
+{
+    if(!_links_valid)
+        return false;
+
+    assert(Q.rows() == (int)_tree.getNrOfDOFs());
+
+    const unsigned int LANES = simd_kernels::getNrOfLanes();
+    const unsigned int nDOFs = _tree.getNrOfDOFs();
+    const unsigned int poses_size = getPosesSize();
+    const int N = Q.cols();
+
+    for(int first = 0; first < N; first += LANES)
+    {
+        // the last block gets padded repeating the last configuration
+        const unsigned int lanes = std::min<int>(LANES, N - first);
+        for(unsigned int l = 0; l < LANES; ++l) {
+            const int col = first + std::min(l, lanes - 1);
+            for(unsigned int d = 0; d < nDOFs; ++d)
+                _q_block[d*LANES + l] = Q(d, col);
+        }
+
+        simd_kernels::computeBlock(&_motions[0], _segments_to_compute.empty() ? NULL : &_segments_to_compute[0],
+                                   _segments_to_compute.size(), &_q_block[0], &_poses_block[0]);
+
+        for(unsigned int i = 0; i < _links.size(); ++i)
+        {
+            const double* data = &_poses_block[_links[i]*12*LANES];
+            for(unsigned int l = 0; l < lanes; ++l)
+            {
+                double* pose = poses + (first + l)*poses_size + 16*i;
+                for(unsigned int c = 0; c < 3; ++c) {
+                    for(unsigned int r = 0; r < 3; ++r)
+                        pose[4*c+r] = data[(3*r+c)*LANES + l];
+                    pose[4*c+3] = 0.0;
+                }
+                for(unsigned int r = 0; r < 3; ++r)
+                    pose[12+r] = data[(9+r)*LANES + l];
+                pose[15] = 1.0;
+            }
+        }
+    }
+
+    return true;
+}
+
+unsigned int simd_kinematics::getNrOfLanes()
+{
+    return simd_kernels::getNrOfLanes();
+}
+
+unsigned int simd_kinematics::getNumberOfDOFs() const
+{
+    return _tree.getNrOfDOFs();
+}
+
+unsigned int simd_kinematics::getPosesSize() const
+{
+    return 16*_links.size();
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/stage_profiler.h>
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <time.h>
+
+using namespace idynutils;
+
+stage_profiler::scoped_timer::scoped_timer(stage_profiler& profiler, const unsigned int stage) :
+    _profiler(profiler),
+    _stage(stage),
+    _start(stage_profiler::now())
+{
+
+}
+
+stage_profiler::scoped_timer::~scoped_timer()
+{
+    _profiler.addSample(_stage, stage_profiler::now() - _start);
+}
+
+stage_profiler::stage_profiler(const std::vector<std::string>& stage_names) :
+    _stages(stage_names.size())
+{
+    for(unsigned int i = 0; i < stage_names.size(); ++i) {
+        _stages[i].name = stage_names[i];
+        _stages[i].histogram.resize(NR_OF_BUCKETS);
+    }
+    reset();
+}
+
+uint64_t stage_profiler::now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+unsigned int stage_profiler::getBucket(const uint64_t duration)
+{
+    // durations below SUB_BUCKETS ns have a bucket each, then every power of two
+    // is split in SUB_BUCKETS linear buckets
+    if(duration < SUB_BUCKETS)
+        return duration;
+
+    unsigned int exponent = 0;
+    while((duration >> exponent) >= 2*SUB_BUCKETS)
+        ++exponent;
+
+    return SUB_BUCKETS + exponent*SUB_BUCKETS + (duration >> exponent) - SUB_BUCKETS;
+}
+
+uint64_t stage_profiler::getBucketUpperBound(const unsigned int bucket)
+{
+    if(bucket < SUB_BUCKETS)
+        return bucket;
+
+    const unsigned int exponent = (bucket - SUB_BUCKETS)/SUB_BUCKETS;
+    const uint64_t mantissa = SUB_BUCKETS + (bucket - SUB_BUCKETS)%SUB_BUCKETS;
+    return ((mantissa + 1) << exponent) - 1;
+}
+
+void stage_profiler::addSample(const unsigned int stage, const uint64_t duration)
+{
+    assert(stage < _stages.size());
+
+    struct stage& s = _stages[stage];
+    ++s.count;
+    s.sum += duration;
+    s.min = std::min(s.min, duration);
+    s.max = std::max(s.max, duration);
+    ++s.histogram[getBucket(duration)];
+}
+
+void stage_profiler::reset()
+{
+    for(unsigned int i = 0; i < _stages.size(); ++i) {
+        _stages[i].count = 0;
+        _stages[i].min = (uint64_t)-1;
+        _stages[i].max = 0;
+        _stages[i].sum = 0;
+        std::fill(_stages[i].histogram.begin(), _stages[i].histogram.end(), 0);
+    }
+}
+
+unsigned int stage_profiler::getNrOfStages() const
+{
+    return _stages.size();
+}
+
+const std::string& stage_profiler::getStageName(const unsigned int stage) const
+{
+    return _stages[stage].name;
+}
+
+stage_profiler::stage_statistics stage_profiler::getStatistics(const unsigned int stage) const
+{
+    const struct stage& s = _stages[stage];
+
+    stage_statistics statistics;
+    statistics.name = s.name;
+    statistics.count = s.count;
+    statistics.min = statistics.mean = statistics.p99 = statistics.max = 0.0;
+    if(s.count > 0) {
+        statistics.min = s.min*1e-9;
+        statistics.mean = (double)s.sum/s.count*1e-9;
+        statistics.p99 = getPercentile(stage, 99.0);
+        statistics.max = s.max*1e-9;
+    }
+    return statistics;
+}
+
+double stage_profiler::getPercentile(const unsigned int stage, const double percentile) const
+{
+    const struct stage& s = _stages[stage];
+    if(s.count == 0)
+        return 0.0;
+
+    const double rank = percentile/100.0*s.count;
+    uint64_t samples = 0;
+    for(unsigned int i = 0; i < NR_OF_BUCKETS; ++i)
+    {
+        samples += s.histogram[i];
+        if(samples >= rank && samples > 0)
+            return std::max(s.min, std::min(getBucketUpperBound(i), s.max))*1e-9;
+    }
+    return s.max*1e-9;
+}
+
+bool stage_profiler::dump(const std::string& file_path) const
+{
+    std::ofstream file(file_path.c_str());
+    if(!file.is_open())
+        return false;
+
+    file << "# stage count min[us] mean[us] p99[us] max[us]" << std::endl;
+    for(unsigned int i = 0; i < _stages.size(); ++i)
+    {
+        stage_statistics statistics = getStatistics(i);
+        file << statistics.name << " "
+             << statistics.count << " "
+             << statistics.min*1e6 << " "
+             << statistics.mean*1e6 << " "
+             << statistics.p99*1e6 << " "
+             << statistics.max*1e6 << std::endl;
+    }
+    return file.good();
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/support_polygon.h>
+#include <algorithm>
+
+using namespace idynutils;
+
+namespace {
+
+struct xy_less
+{
+    xy_less(const KDL::Vector* points) : _points(points) {}
+
+    bool operator()(const unsigned int a, const unsigned int b) const
+    {
+        return _points[a].x() < _points[b].x() ||
+               (_points[a].x() == _points[b].x() && _points[a].y() < _points[b].y());
+    }
+
+    const KDL::Vector* _points;
+};
+
+/* z component of (a - o) x (b - o), > 0 if o, a, b turn counterclockwise */
+inline double cross(const KDL::Vector& o, const KDL::Vector& a, const KDL::Vector& b)
+{
+    return (a.x() - o.x())*(b.y() - o.y()) - (a.y() - o.y())*(b.x() - o.x());
+}
+
+}
+
+const unsigned int support_polygon::MAX_POINTS;
+
+support_polygon::support_polygon() :
+    _size(0),
+    _hull_size(0)
+{
+
+}
+
+void support_polygon::clear()
+{
+    _size = 0;
+    _hull_size = 0;
+}
+
+bool support_polygon::push_back(const KDL::Vector& point)
+{
+    if(_size == MAX_POINTS)
+        return false;
+    _points[_size++] = point;
+    return true;
+}
+
+bool support_polygon::computeConvexHull()
+{
+    _hull_size = 0;
+
+    for(unsigned int i = 0; i < _size; ++i)
+        _sorted[i] = i;
+    std::sort(_sorted, _sorted + _size, xy_less(_points));
+
+    // lower hull, from left to right
+    for(unsigned int i = 0; i < _size; ++i)
+    {
+        const KDL::Vector& p = _points[_sorted[i]];
+        while(_hull_size >= 2 && cross(_hull[_hull_size-2], _hull[_hull_size-1], p) <= 0.0)
+            --_hull_size;
+        _hull[_hull_size++] = KDL::Vector(p.x(), p.y(), 0.0);
+    }
+
+    // upper hull, from right to left
+    const unsigned int lower_size = _hull_size + 1;
+    for(int i = (int)_size - 2; i >= 0; --i)
+    {
+        const KDL::Vector& p = _points[_sorted[i]];
+        while(_hull_size >= lower_size && cross(_hull[_hull_size-2], _hull[_hull_size-1], p) <= 0.0)
+            --_hull_size;
+        _hull[_hull_size++] = KDL::Vector(p.x(), p.y(), 0.0);
+    }
+
+    // the last point is the first one
+    if(_hull_size > 1)
+        --_hull_size;
+
+    return _hull_size >= 3;
+}
+
+void support_polygon::getConvexHull(std::vector<KDL::Vector>& ch) const
+{
+    ch.assign(_hull, _hull + _hull_size);
+}
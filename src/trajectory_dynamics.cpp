@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include <idynutils/trajectory_dynamics.h>
+#include <idynutils/cartesian_utils.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+using namespace idynutils;
+
+trajectory_dynamics::workspace::workspace(const unsigned int nr_of_segments) :
+    poses(nr_of_segments, KDL::Frame::Identity()),
+    motions(nr_of_segments, KDL::Twist::Zero()),
+    velocities(nr_of_segments, KDL::Twist::Zero()),
+    accelerations(nr_of_segments, KDL::Twist::Zero()),
+    wrenches(nr_of_segments, KDL::Wrench::Zero())
+{
+
+}
+
+trajectory_dynamics::trajectory_dynamics(const iDynUtils& model, const unsigned int number_of_threads) :
+    _workers(number_of_threads),
+    _tree(model),
+    _prismatic(_tree.getNrOfSegments(), 0),
+    _on_base_path(_tree.getNrOfSegments(), 0),
+    _base_link(-1),
+    _gravity(0.0, 0.0, -9.81)
+{
+    _workspaces.resize(_workers.getNumberOfThreads(), workspace(_tree.getNrOfSegments()));
+
+    for(unsigned int i = 0; i < _tree.getNrOfSegments(); ++i)
+    {
+        const KDL::Joint::JointType type = _tree.getSegment(i).getJoint().getType();
+        _prismatic[i] = type == KDL::Joint::TransAxis || type == KDL::Joint::TransX ||
+                        type == KDL::Joint::TransY || type == KDL::Joint::TransZ;
+    }
+
+    iCub::iDynTree::DynTree& idyntree = const_cast<iCub::iDynTree::DynTree&>(model.iDyn3_model);
+    std::string floating_base;
+    const int floating_base_index = idyntree.getFloatingBaseLink();
+    idyntree.getLinkName(floating_base_index, floating_base);
+    _base_link = _tree.getSegmentIndex(floating_base);
+    for(int i = _base_link; i > 0; i = _tree.getParent(i))
+        _on_base_path[i] = 1;
+
+    _world_T_base = idyntree.getPositionKDL(floating_base_index);
+    _torque_limits = cartesian_utils::toEigen(idyntree.getJointTorqueMax());
+}
+
+bool trajectory_dynamics::evaluate(const Eigen::Ref<const Eigen::MatrixXd>& Q,
+                                   const Eigen::Ref<const Eigen::MatrixXd>& dQ,
+                                   const Eigen::Ref<const Eigen::MatrixXd>& ddQ,
+                                   const outputs& out)
+{
+    assert(Q.rows() == (int)_tree.getNrOfDOFs());
+    assert(dQ.rows() == Q.rows() && dQ.cols() == Q.cols());
+    assert(ddQ.rows() == Q.rows() && ddQ.cols() == Q.cols());
+    assert(!out.torque_limits_exceeded || out.torques);
+
+    if(_base_link == -1)
+        return false;
+
+    const int samples = Q.cols();
+
+    job j;
+    j.Q = &Q;
+    j.dQ = &dQ;
+    j.ddQ = &ddQ;
+    j.out = &out;
+    j.threads = std::min<int>(_workspaces.size(), samples);
+    if(j.threads == 0)
+        return true;
+
+    _workers.run(boost::bind(&trajectory_dynamics::evaluateChunk, this, _1, &j), j.threads);
+
+    // the limits are checked on all the samples at once, so that the check gets vectorized
+    if(out.torque_limits_exceeded)
+        this->countTorqueLimitsExceeded(Eigen::Map<const Eigen::MatrixXd>(out.torques, Q.rows(), samples),
+                                        Eigen::Map<Eigen::VectorXi>(out.torque_limits_exceeded, samples));
+
+    return true;
+}
+
+unsigned int trajectory_dynamics::evaluate(sample_reader& reader,
+                                           result_writer& writer,
+                                           const bool torques,
+                                           const bool base_wrenches,
+                                           const bool com,
+                                           const bool torque_limits,
+                                           const unsigned int chunk_size)
+{
+    assert(chunk_size > 0);
+
+    if(_base_link == -1)
+        return 0;
+
+    const unsigned int nDOFs = _tree.getNrOfDOFs();
+    _Q.resize(nDOFs, chunk_size);
+    _dQ.resize(nDOFs, chunk_size);
+    _ddQ.resize(nDOFs, chunk_size);
+    _torques.resize(nDOFs, chunk_size);
+    _base_wrenches.resize(6, chunk_size);
+    _com.resize(3, chunk_size);
+    _exceeded.resize(chunk_size);
+
+    outputs out;
+    if(torques || torque_limits)
+        out.torques = _torques.data();
+    if(base_wrenches)
+        out.base_wrenches = _base_wrenches.data();
+    if(com)
+        out.com = _com.data();
+    if(torque_limits)
+        out.torque_limits_exceeded = _exceeded.data();
+
+    // the torques are computed to check the limits, but the writer gets them only if requested
+    outputs written = out;
+    if(!torques)
+        written.torques = NULL;
+
+    unsigned int processed = 0;
+    unsigned int samples = chunk_size;
+    while(samples == chunk_size)
+    {
+        samples = reader.read(_Q, _dQ, _ddQ);
+        if(samples == 0)
+            break;
+
+        this->evaluate(_Q.leftCols(samples), _dQ.leftCols(samples), _ddQ.leftCols(samples), out);
+
+        writer.write(processed, samples, written);
+        processed += samples;
+    }
+
+    return processed;
+}
+
+void trajectory_dynamics::countTorqueLimitsExceeded(const Eigen::Ref<const Eigen::MatrixXd>& torques,
+                                                    Eigen::Ref<Eigen::VectorXi> exceeded) const
+{
+    assert(torques.rows() == _torque_limits.size() && exceeded.size() == torques.cols());
+
+    exceeded = ((torques.array().abs().colwise() - _torque_limits.array()) > 0.0).cast<int>().colwise().sum().transpose();
+}
+
+void trajectory_dynamics::evaluateChunk(const unsigned int thread, const job* j)
+{
+    // static partitioning: every sample costs the same
+    const int samples = j->Q->cols();
+    const int chunk = samples / j->threads;
+    const int remainder = samples % j->threads;
+    const int begin = thread*chunk + std::min<int>(thread, remainder);
+    const int end = begin + chunk + ((int)thread < remainder ? 1 : 0);
+
+    workspace& w = _workspaces[thread];
+    const unsigned int nDOFs = _tree.getNrOfDOFs();
+
+    for(int c = begin; c < end; ++c)
+    {
+        double* torques = j->out->torques ? j->out->torques + (size_t)c*nDOFs : NULL;
+        double* base_wrench = j->out->base_wrenches ? j->out->base_wrenches + (size_t)c*6 : NULL;
+        double* com = j->out->com ? j->out->com + (size_t)c*3 : NULL;
+
+        this->rnea(w, j->Q->col(c), j->dQ->col(c), j->ddQ->col(c), torques, base_wrench, com);
+    }
+}
+
+void trajectory_dynamics::rnea(workspace& w,
+                               const Eigen::Ref<const Eigen::VectorXd>& q,
+                               const Eigen::Ref<const Eigen::VectorXd>& dq,
+                               const Eigen::Ref<const Eigen::VectorXd>& ddq,
+                               double* torques, double* base_wrench, double* com) const
+{
+    const unsigned int nSegments = _tree.getNrOfSegments();
+
+    // the root of the tree is placed so that the floating base is at _world_T_base
+    KDL::Frame root_T_base = KDL::Frame::Identity();
+    for(int i = _base_link; i > 0; i = _tree.getParent(i)) {
+        const int dof = _tree.getDOF(i);
+        root_T_base = _tree.getSegment(i).pose(dof == -1 ? 0.0 : q[dof]) * root_T_base;
+    }
+    w.poses[0] = _world_T_base * root_T_base.Inverse();
+
+    // poses and joint motion subspaces, the reference point of twists is the world origin
+    for(unsigned int i = 1; i < nSegments; ++i)
+    {
+        const KDL::Frame& world_T_parent = w.poses[_tree.getParent(i)];
+        const KDL::Segment& segment = _tree.getSegment(i);
+        const int dof = _tree.getDOF(i);
+        w.poses[i] = world_T_parent * segment.pose(dof == -1 ? 0.0 : q[dof]);
+
+        if(dof == -1)
+            continue;
+
+        const KDL::Vector axis = world_T_parent.M * segment.getJoint().JointAxis();
+        if(_prismatic[i])
+            w.motions[i] = KDL::Twist(axis, KDL::Vector::Zero());
+        else
+            w.motions[i] = KDL::Twist((world_T_parent * segment.getJoint().JointOrigin()) * axis, axis);
+    }
+
+    // velocities and accelerations: the ones of the root are such that the floating base
+    // is still, and accelerates upwards to account for gravity
+    w.velocities[0] = KDL::Twist::Zero();
+    for(int i = _base_link; i > 0; i = _tree.getParent(i))
+        if(_tree.getDOF(i) != -1)
+            w.velocities[0] -= w.motions[i] * dq[_tree.getDOF(i)];
+    for(unsigned int i = 1; i < nSegments; ++i) {
+        w.velocities[i] = w.velocities[_tree.getParent(i)];
+        if(_tree.getDOF(i) != -1)
+            w.velocities[i] += w.motions[i] * dq[_tree.getDOF(i)];
+    }
+
+    w.accelerations[0] = KDL::Twist(-_gravity, KDL::Vector::Zero());
+    for(int i = _base_link; i > 0; i = _tree.getParent(i)) {
+        const int dof = _tree.getDOF(i);
+        if(dof != -1)
+            w.accelerations[0] -= w.motions[i] * ddq[dof] +
+                                  (w.velocities[_tree.getParent(i)] * w.motions[i]) * dq[dof];
+    }
+    for(unsigned int i = 1; i < nSegments; ++i) {
+        const int dof = _tree.getDOF(i);
+        w.accelerations[i] = w.accelerations[_tree.getParent(i)];
+        if(dof != -1)
+            w.accelerations[i] += w.motions[i] * ddq[dof] +
+                                  (w.velocities[_tree.getParent(i)] * w.motions[i]) * dq[dof];
+    }
+
+    // wrenches acting on the links, accumulated on the subtrees
+    KDL::RigidBodyInertia total_inertia = KDL::RigidBodyInertia::Zero();
+    for(unsigned int i = 0; i < nSegments; ++i)
+    {
+        const KDL::RigidBodyInertia inertia = w.poses[i] * _tree.getSegment(i).getInertia();
+        w.wrenches[i] = inertia * w.accelerations[i] + w.velocities[i] * (inertia * w.velocities[i]);
+        if(com)
+            total_inertia = total_inertia + inertia;
+    }
+    for(unsigned int i = nSegments - 1; i > 0; --i)
+        w.wrenches[_tree.getParent(i)] += w.wrenches[i];
+
+    if(torques)
+    {
+        const KDL::Wrench& total_wrench = w.wrenches[0];
+        for(unsigned int i = 1; i < nSegments; ++i)
+        {
+            const int dof = _tree.getDOF(i);
+            if(dof == -1)
+                continue;
+
+            // a joint on the path to the floating base moves everything but its subtree,
+            // in the opposite direction
+            if(_on_base_path[i])
+                torques[dof] = KDL::dot(w.motions[i], w.wrenches[i] - total_wrench);
+            else
+                torques[dof] = KDL::dot(w.motions[i], w.wrenches[i]);
+        }
+    }
+
+    if(base_wrench)
+    {
+        const KDL::Wrench wrench = w.wrenches[0].RefPoint(_world_T_base.p);
+        Eigen::Map<Eigen::VectorXd>(base_wrench, 6) << wrench.force.x(), wrench.force.y(), wrench.force.z(),
+                                                      wrench.torque.x(), wrench.torque.y(), wrench.torque.z();
+    }
+
+    if(com)
+    {
+        const KDL::Vector cog = total_inertia.getCOG();
+        com[0] = cog.x(); com[1] = cog.y(); com[2] = cog.z();
+    }
+}
+
+bool trajectory_dynamics::isValid() const
+{
+    return _base_link != -1;
+}
+
+unsigned int trajectory_dynamics::getNumberOfThreads() const
+{
+    return _workspaces.size();
+}
+
+unsigned int trajectory_dynamics::getNumberOfDOFs() const
+{
+    return _tree.getNrOfDOFs();
+}
+
+trajectory_dynamics::text_sample_reader::text_sample_reader(std::istream& stream,
+                                                            const unsigned int number_of_dofs) :
+    _stream(stream),
+    _values(3*number_of_dofs, 0.0),
+    _skipped(0)
+{
+
+}
+
+unsigned int trajectory_dynamics::text_sample_reader::read(Eigen::Ref<Eigen::MatrixXd> Q,
+                                                           Eigen::Ref<Eigen::MatrixXd> dQ,
+                                                           Eigen::Ref<Eigen::MatrixXd> ddQ)
+{
+    const unsigned int nDOFs = _values.size()/3;
+    assert(Q.rows() == (int)nDOFs && dQ.rows() == (int)nDOFs && ddQ.rows() == (int)nDOFs);
+
+    int samples = 0;
+    while(samples < Q.cols() && std::getline(_stream, _line))
+    {
+        std::replace(_line.begin(), _line.end(), ',', ' ');
+        const char* begin = _line.c_str();
+        while(*begin == ' ' || *begin == '\t')
+            ++begin;
+        if(*begin == '\0' || *begin == '#' || *begin == '\r')
+            continue;
+
+        unsigned int v = 0;
+        char* end = NULL;
+        for(; v < _values.size(); ++v, begin = end) {
+            _values[v] = std::strtod(begin, &end);
+            if(end == begin)
+                break;
+        }
+        if(v < _values.size()) {
+            ++_skipped;
+            continue;
+        }
+
+        Q.col(samples) = Eigen::Map<const Eigen::VectorXd>(&_values[0], nDOFs);
+        dQ.col(samples) = Eigen::Map<const Eigen::VectorXd>(&_values[nDOFs], nDOFs);
+        ddQ.col(samples) = Eigen::Map<const Eigen::VectorXd>(&_values[2*nDOFs], nDOFs);
+        ++samples;
+    }
+
+    return samples;
+}
+
+unsigned int trajectory_dynamics::text_sample_reader::getNrOfSkippedSamples() const
+{
+    return _skipped;
+}
+
+trajectory_dynamics::text_result_writer::text_result_writer(std::ostream& stream,
+                                                            const unsigned int number_of_dofs) :
+    _stream(stream),
+    _nDOFs(number_of_dofs)
+{
+
+}
+
+void trajectory_dynamics::text_result_writer::write(const unsigned int first_sample,
+                                                    const unsigned int samples,
+                                                    const outputs& out)
+{
+    for(unsigned int c = 0; c < samples; ++c)
+    {
+        _stream << first_sample + c;
+        if(out.torques)
+            for(unsigned int i = 0; i < _nDOFs; ++i)
+                _stream << " " << out.torques[(size_t)c*_nDOFs + i];
+        if(out.base_wrenches)
+            for(unsigned int i = 0; i < 6; ++i)
+                _stream << " " << out.base_wrenches[(size_t)c*6 + i];
+        if(out.com)
+            for(unsigned int i = 0; i < 3; ++i)
+                _stream << " " << out.com[(size_t)c*3 + i];
+        if(out.torque_limits_exceeded)
+            _stream << " " << out.torque_limits_exceeded[c];
+        _stream << "\n";
+    }
+    _stream.flush();
+}
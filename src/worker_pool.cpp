@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Mirko Ferrati, Enrico Mingo, Alessio Rocchi,
+ * email:  mirko.ferrati@gmail.com, enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+
+#include <idynutils/worker_pool.h>
+#include <boost/bind.hpp>
+#include <cassert>
+
+using namespace idynutils;
+
+worker_pool::worker_pool(const unsigned int number_of_threads) :
+    _task(NULL),
+    _number_of_tasks(0),
+    _pending(0),
+    _generation(0),
+    _stop(false),
+    _number_of_threads(number_of_threads)
+{
+    if(_number_of_threads == 0)
+        _number_of_threads = boost::thread::hardware_concurrency();
+    if(_number_of_threads == 0)
+        _number_of_threads = 1;
+
+    for(unsigned int i = 1; i < _number_of_threads; ++i)
+        _workers.create_thread(boost::bind(&worker_pool::work, this, i));
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _stop = true;
+    }
+    _started.notify_all();
+    _workers.join_all();
+}
+
+void worker_pool::run(const task& t, const unsigned int number_of_tasks)
+{
+    assert(number_of_tasks <= _number_of_threads);
+    if(number_of_tasks == 0)
+        return;
+
+    if(number_of_tasks > 1)
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _task = &t;
+            _number_of_tasks = number_of_tasks;
+            _pending = number_of_tasks - 1;
+            ++_generation;
+        }
+        _started.notify_all();
+    }
+
+    t(0);
+
+    if(number_of_tasks > 1)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        while(_pending > 0)
+            _finished.wait(lock);
+        _task = NULL;
+    }
+}
+
+unsigned int worker_pool::getNumberOfThreads() const
+{
+    return _number_of_threads;
+}
+
+void worker_pool::work(const unsigned int i)
+{
+    unsigned long generation = 0;
+    while(true)
+    {
+        const task* t = NULL;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            while(!_stop && _generation == generation)
+                _started.wait(lock);
+            if(_stop)
+                return;
+
+            generation = _generation;
+            // workers beyond the number of tasks sit this generation out
+            if(i >= _number_of_tasks)
+                continue;
+            t = _task;
+        }
+
+        (*t)(i);
+
+        boost::mutex::scoped_lock lock(_mutex);
+        if(--_pending == 0)
+            _finished.notify_one();
+    }
+}
@@ -43,7 +43,8 @@ yarp_single_chain_interface::yarp_single_chain_interface(std::string kinematic_c
     encodersMotor(NULL), controlLimits(NULL), controlMode(NULL),
     interactionMode(NULL), pidControl(NULL), positionControl(NULL),
     positionDirect(NULL), impedancePositionControl(NULL), torqueControl(NULL),\
-    velocityControl(NULL)
+    velocityControl(NULL),
+    _real_time_errors(NULL)
 {
     internal_isAvailable=false;
     if (module_prefix_with_no_slash.find_first_of("/")!=std::string::npos)
@@ -82,6 +83,7 @@ yarp_single_chain_interface::yarp_single_chain_interface(std::string kinematic_c
     
     encodersMotor->getAxes(&(this->joints_number));
     q_buffer.resize(joints_number);
+    u_buffer.resize(joints_number);
     qdot_buffer.resize(joints_number);
     tau_buffer.resize(joints_number);
     q_motor_buffer.resize(joints_number);
@@ -403,27 +405,34 @@ void yarp_single_chain_interface::sense(yarp::sig::Vector& q_sensed) {
 
 void yarp_single_chain_interface::move(const yarp::sig::Vector& u_d)
 {
-    yarp::sig::Vector u_sent(u_d);
+    // the command gets converted in a preallocated buffer
+    if(u_buffer.size() != u_d.size())
+        u_buffer.resize(u_d.size());
+    std::copy(u_d.data(), u_d.data() + u_d.size(), u_buffer.data());
 
     switch (_controlType.toYarp().first)
     {
         case VOCAB_CM_POSITION_DIRECT:
         case VOCAB_CM_IMPEDANCE_POS:
-            if(_useSI) convertMotorCommandFromSI(u_sent);
-            if(!positionDirect->setPositions(u_sent.data()))
+            if(_useSI) convertMotorCommandFromSI(u_buffer);
+            if(!positionDirect->setPositions(u_buffer.data()) &&
+               !reportRealTimeError("Cannot move using Direct Position Ctrl"))
                 std::cout<<"Cannot move "<< kinematic_chain <<" using Direct Position Ctrl"<<std::endl;
             break;
         case VOCAB_CM_POSITION:
-            if(_useSI) convertMotorCommandFromSI(u_sent);
-            if(!positionControl->positionMove(u_sent.data()))
+            if(_useSI) convertMotorCommandFromSI(u_buffer);
+            if(!positionControl->positionMove(u_buffer.data()) &&
+               !reportRealTimeError("Cannot move using Position Ctrl"))
                 std::cout<<"Cannot move "<< kinematic_chain <<" using Position Ctrl"<<std::endl;
             break;
         case VOCAB_CM_TORQUE:
-            if(!torqueControl->setRefTorques(u_sent.data()))
+            if(!torqueControl->setRefTorques(u_buffer.data()) &&
+               !reportRealTimeError("Cannot move using Torque Ctrl"))
                 std::cout<<"Cannot move "<< kinematic_chain <<" using Torque Ctrl"<<std::endl;
             break;
         case VOCAB_CM_VELOCITY:
-            if(!velocityControl->velocityMove(u_sent.data()))
+            if(!velocityControl->velocityMove(u_buffer.data()) &&
+               !reportRealTimeError("Cannot move using Velocity Ctrl"))
                 std::cout<<"Cannot move "<< kinematic_chain <<" using Velocity Ctrl"<<std::endl;
             break;
         /*case VOCAB_CM_MIXED:
@@ -431,11 +440,27 @@ void yarp_single_chain_interface::move(const yarp::sig::Vector& u_d)
         */
         case VOCAB_CM_IDLE:        
         default:
+            if(!reportRealTimeError("Cannot move using Idle Ctrl"))
                 std::cout<<"Cannot move "<< kinematic_chain <<" using Idle Ctrl"<<std::endl;
             break;
     }
 }
 
+void yarp_single_chain_interface::setRealTimeErrors(idynutils::rt_error_ring* errors)
+{
+    _real_time_errors = errors;
+}
+
+bool yarp_single_chain_interface::reportRealTimeError(const char* message)
+{
+    if(!_real_time_errors)
+        return false;
+
+    // the context is valid until kinematic_chain is reassigned, see setRealTimeErrors()
+    _real_time_errors->push(message, kinematic_chain.c_str());
+    return true;
+}
+
 bool walkman::yarp_single_chain_interface::moveDone()
 {
     bool moveDone;
@@ -652,6 +677,7 @@ void walkman::yarp_single_chain_interface::operator=(const walkman::yarp_single_
     _useSI = k._useSI;
     _controlType = k._controlType;
     _robot_name = k._robot_name;
+    _real_time_errors = k._real_time_errors;
 
     internal_isAvailable=false;
     if(createPolyDriver(kinematic_chain.c_str(), _robot_name.c_str(), polyDriver))
@@ -685,6 +711,7 @@ void walkman::yarp_single_chain_interface::operator=(const walkman::yarp_single_
 
     encodersMotor->getAxes(&(this->joints_number));
     q_buffer.resize(joints_number);
+    u_buffer.resize(joints_number);
     qdot_buffer.resize(joints_number);
     tau_buffer.resize(joints_number);
     q_motor_buffer.resize(joints_number);
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2014 Walkman
+ * Author: Enrico Mingo, Alessio Rocchi,
+ * email:  enrico.mingo@iit.it, alessio.rocchi@iit.it
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _ALLOCATION_COUNTER_H_
+#define _ALLOCATION_COUNTER_H_
+
+#include <cstdlib>
+#include <new>
+
+/**
+ * Replaces the global operator new/delete of the test executable in order to
+ * count the heap allocations performed between allocation_counter::start()
+ * and allocation_counter::stop().
+ * This header must be included by exactly one translation unit per executable.
+ */
+namespace allocation_counter {
+    static bool counting = false;
+    static unsigned int allocations = 0;
+
+    inline void start()
+    {
+        allocations = 0;
+        counting = true;
+    }
+
+    /**
+     * @brief stop stops counting
+     * @return the number of allocations since the last call to start()
+     */
+    inline unsigned int stop()
+    {
+        counting = false;
+        return allocations;
+    }
+}
+
+#if __cplusplus < 201103L
+#define ALLOCATION_COUNTER_THROW throw(std::bad_alloc)
+#define ALLOCATION_COUNTER_NOTHROW throw()
+#else
+#define ALLOCATION_COUNTER_THROW
+#define ALLOCATION_COUNTER_NOTHROW noexcept
+#endif
+
+void* operator new(std::size_t size) ALLOCATION_COUNTER_THROW
+{
+    if(allocation_counter::counting)
+        ++allocation_counter::allocations;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) ALLOCATION_COUNTER_THROW
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) ALLOCATION_COUNTER_NOTHROW
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) ALLOCATION_COUNTER_NOTHROW
+{
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <idynutils/batch_evaluator.h>
+#include <idynutils/idynutils.h>
+#include <idynutils/cartesian_utils.h>
+#include <yarp/os/Time.h>
+
+namespace{
+
+class testBatchEvaluator: public ::testing::Test
+{
+protected:
+    testBatchEvaluator() :
+        coman("coman",
+              std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.urdf",
+              std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.srdf")
+    {
+        links.push_back("l_wrist");
+        links.push_back("r_wrist");
+        links.push_back("l_sole");
+    }
+
+    virtual ~testBatchEvaluator() {
+
+    }
+
+    virtual void SetUp() {
+
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    Eigen::MatrixXd randomConfigurations(const int n)
+    {
+        return Eigen::MatrixXd::Random(coman.iDyn3_model.getNrOfDOFs(), n);
+    }
+
+    iDynUtils coman;
+    std::vector<std::string> links;
+};
+
+TEST_F(testBatchEvaluator, testBatchMatchesSerialEvaluation)
+{
+    const int n = 64;
+    idynutils::batch_evaluator batch(coman, links, 4);
+    ASSERT_EQ(batch.getNumberOfThreads(), 4u);
+
+    Eigen::MatrixXd Q = randomConfigurations(n);
+    Eigen::MatrixXd dQ = randomConfigurations(n);
+    Eigen::MatrixXd ddQ = randomConfigurations(n);
+
+    Eigen::MatrixXd poses(batch.getPosesSize(), n);
+    Eigen::MatrixXd com(3, n);
+    Eigen::MatrixXd jacobians(batch.getJacobiansSize(), n);
+    Eigen::MatrixXd torques(batch.getNumberOfDOFs(), n);
+
+    idynutils::batch_evaluator::outputs out;
+    out.poses = poses.data();
+    out.com = com.data();
+    out.jacobians = jacobians.data();
+    out.torques = torques.data();
+    EXPECT_TRUE(batch.evaluate(Q, dQ, ddQ, out));
+
+    const int nJ = batch.getNumberOfDOFs();
+    Eigen::MatrixXd J(6, nJ + 6);
+    for(int c = 0; c < n; ++c)
+    {
+        coman.updateiDyn3Model(Q.col(c), dQ.col(c), ddQ.col(c));
+
+        for(unsigned int l = 0; l < links.size(); ++l)
+        {
+            Eigen::Matrix4d pose;
+            cartesian_utils::fromKDLFrameToEigenMatrix(coman.getPose(links[l]), pose);
+            EXPECT_TRUE(Eigen::Map<Eigen::Matrix4d>(poses.col(c).data() + 16*l).isApprox(pose));
+
+            ASSERT_TRUE(coman.getJacobian(coman.iDyn3_model.getLinkIndex(links[l]), J));
+            EXPECT_TRUE(Eigen::Map<Eigen::MatrixXd>(jacobians.col(c).data() + 6*(nJ+6)*l,
+                                                    6, nJ + 6).isApprox(J));
+        }
+
+        KDL::Vector CoM = coman.getCoM();
+        EXPECT_NEAR(com(0,c), CoM.x(), 1e-12);
+        EXPECT_NEAR(com(1,c), CoM.y(), 1e-12);
+        EXPECT_NEAR(com(2,c), CoM.z(), 1e-12);
+
+        EXPECT_TRUE(torques.col(c).isApprox(coman.getTorques()));
+    }
+}
+
+TEST_F(testBatchEvaluator, testSingleOutput)
+{
+    const int n = 10;
+    idynutils::batch_evaluator batch(coman, links, 3);
+
+    Eigen::MatrixXd Q = randomConfigurations(n);
+    Eigen::MatrixXd com(3, n);
+
+    idynutils::batch_evaluator::outputs out;
+    out.com = com.data();
+    EXPECT_TRUE(batch.evaluate(Q, out));
+
+    coman.updateiDyn3Model(Q.col(n-1));
+    KDL::Vector CoM = coman.getCoM();
+    EXPECT_NEAR(com(0,n-1), CoM.x(), 1e-12);
+    EXPECT_NEAR(com(1,n-1), CoM.y(), 1e-12);
+    EXPECT_NEAR(com(2,n-1), CoM.z(), 1e-12);
+
+    std::vector<std::string> wrong_links(1, "not_a_link");
+    idynutils::batch_evaluator wrong_batch(coman, wrong_links, 1);
+    EXPECT_FALSE(wrong_batch.isValid());
+    EXPECT_FALSE(wrong_batch.evaluate(Q, out));
+    EXPECT_TRUE(batch.isValid());
+}
+
+TEST_F(testBatchEvaluator, testScaling)
+{
+    const int n = 2000;
+    Eigen::MatrixXd Q = randomConfigurations(n);
+
+    idynutils::batch_evaluator serial(coman, links, 1);
+    idynutils::batch_evaluator parallel(coman, links);
+
+    Eigen::MatrixXd serial_poses(serial.getPosesSize(), n);
+    Eigen::MatrixXd parallel_poses(parallel.getPosesSize(), n);
+    Eigen::MatrixXd serial_jacobians(serial.getJacobiansSize(), n);
+    Eigen::MatrixXd parallel_jacobians(parallel.getJacobiansSize(), n);
+
+    idynutils::batch_evaluator::outputs serial_out;
+    serial_out.poses = serial_poses.data();
+    serial_out.jacobians = serial_jacobians.data();
+    idynutils::batch_evaluator::outputs parallel_out;
+    parallel_out.poses = parallel_poses.data();
+    parallel_out.jacobians = parallel_jacobians.data();
+
+    double t = yarp::os::Time::now();
+    serial.evaluate(Q, serial_out);
+    double serial_time = yarp::os::Time::now() - t;
+
+    t = yarp::os::Time::now();
+    parallel.evaluate(Q, parallel_out);
+    double parallel_time = yarp::os::Time::now() - t;
+
+    std::cout << n << " configurations, 1 thread: " << serial_time << " [s], "
+              << parallel.getNumberOfThreads() << " threads: " << parallel_time << " [s]" << std::endl;
+
+    EXPECT_TRUE(serial_poses == parallel_poses);
+    EXPECT_TRUE(serial_jacobians == parallel_jacobians);
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <idynutils/centroidal_dynamics.h>
+#include <idynutils/idynutils.h>
+#include <idynutils/cartesian_utils.h>
+#include <yarp/os/Time.h>
+
+namespace{
+
+class testCentroidalDynamics: public ::testing::Test
+{
+protected:
+    testCentroidalDynamics() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testCentroidalDynamics() {
+
+    }
+
+    virtual void SetUp() {
+        nJ = bigman.iDyn3_model.getNrOfDOFs();
+        q = Eigen::VectorXd::Random(nJ);
+        dq = Eigen::VectorXd::Random(nJ);
+        bigman.updateiDyn3Model(q, dq, true);
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    iDynUtils bigman;
+    unsigned int nJ;
+    Eigen::VectorXd q;
+    Eigen::VectorXd dq;
+};
+
+TEST_F(testCentroidalDynamics, testMomentumMatchesIDynTree)
+{
+    Eigen::MatrixXd A(6, nJ+6);
+    Eigen::VectorXd dA_dq(6);
+    ASSERT_TRUE(bigman.getCentroidalMomentumMatrix(A, dA_dq));
+
+    Eigen::VectorXd nu = Eigen::VectorXd::Zero(nJ+6);
+    nu.tail(nJ) = dq;
+    Eigen::VectorXd h = A*nu;
+    Eigen::VectorXd h_idyntree = bigman.getCentroidalMomentum();
+    EXPECT_TRUE(h.isApprox(h_idyntree, 1e-6)) << h.transpose() << std::endl
+                                             << " vs " << std::endl << h_idyntree.transpose();
+
+    // the linear momentum is the mass times the CoM velocity
+    Eigen::MatrixXd JCoM(6, nJ+6);
+    ASSERT_TRUE(bigman.getCOMJacobian(JCoM));
+    const double mass = bigman.iDyn3_model.getTotalMass();
+    EXPECT_TRUE(A.topRows(3).isApprox(mass*JCoM.topRows(3), 1e-6));
+}
+
+TEST_F(testCentroidalDynamics, testBiasMatchesFiniteDifferences)
+{
+    Eigen::MatrixXd A(6, nJ+6);
+    Eigen::VectorXd dA_dq(6);
+
+    // the floating base moves too
+    idynutils::centroidal_dynamics centroidal(bigman.getKDLTree(), bigman.getDOFNames());
+    const int base = centroidal.getLinkIndex("Waist");
+    ASSERT_NE(base, -1);
+    const KDL::Frame world_T_base(KDL::Rotation::RPY(0.1, -0.2, 0.3), KDL::Vector(0.1, 0.2, 1.0));
+    const KDL::Twist base_velocity(KDL::Vector(0.3, -0.5, 0.2), KDL::Vector(0.4, 0.1, -0.3));
+    centroidal.compute(base, world_T_base, base_velocity, q, dq, A, dA_dq);
+
+    Eigen::VectorXd nu(nJ+6);
+    nu << 0.3, -0.5, 0.2, 0.4, 0.1, -0.3, dq;
+
+    // dh/dt at constant nu is dA*nu = dA_dq
+    const double dt = 1e-6;
+    Eigen::MatrixXd A_plus(6, nJ+6), A_minus(6, nJ+6);
+    Eigen::VectorXd unused(6);
+    const KDL::Rotation dR = KDL::Rotation::Rot(base_velocity.rot, base_velocity.rot.Norm()*dt);
+    centroidal.compute(base, KDL::Frame(dR*world_T_base.M, world_T_base.p + base_velocity.vel*dt),
+                       base_velocity, q + dq*dt, dq, A_plus, unused);
+    centroidal.compute(base, KDL::Frame(dR.Inverse()*world_T_base.M, world_T_base.p - base_velocity.vel*dt),
+                       base_velocity, q - dq*dt, dq, A_minus, unused);
+
+    Eigen::VectorXd dA_dq_fd = (A_plus - A_minus)*nu/(2.0*dt);
+    EXPECT_TRUE(dA_dq.isApprox(dA_dq_fd, 1e-5)) << dA_dq.transpose() << std::endl
+                                               << " vs " << std::endl << dA_dq_fd.transpose();
+}
+
+TEST_F(testCentroidalDynamics, testCentroidalTime)
+{
+    Eigen::MatrixXd A(6, nJ+6);
+    Eigen::VectorXd dA_dq(6);
+    Eigen::MatrixXd M(nJ+6, nJ+6);
+    Eigen::MatrixXd J(6, nJ+6);
+    const unsigned int iterations = 1000;
+
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i)
+        bigman.getCentroidalMomentumMatrix(A, dA_dq);
+    double centroidal_time = yarp::os::Time::now() - t;
+
+    // the floating base part of the mass matrix and the CoM Jacobian alone, which do not
+    // give dA*dq yet
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        bigman.getFloatingBaseMassMatrix(M);
+        bigman.getCOMJacobian(J);
+    }
+    double mass_matrix_time = yarp::os::Time::now() - t;
+
+    std::cout << "A and dA*dq: " << centroidal_time/iterations << " [s], "
+              << "mass matrix and CoM Jacobian: " << mass_matrix_time/iterations << " [s]" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include <idynutils/contact_kinematics.h>
+#include <idynutils/idynutils.h>
+#include <idynutils/cartesian_utils.h>
+#include <yarp/os/Time.h>
+
+namespace{
+
+class testContactKinematics: public ::testing::Test
+{
+protected:
+    testContactKinematics() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testContactKinematics() {
+
+    }
+
+    virtual void SetUp() {
+        nJ = bigman.iDyn3_model.getNrOfDOFs();
+        q = Eigen::VectorXd::Random(nJ);
+        dq = Eigen::VectorXd::Random(nJ);
+        bigman.updateiDyn3Model(q, dq, true);
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    iDynUtils bigman;
+    unsigned int nJ;
+    Eigen::VectorXd q;
+    Eigen::VectorXd dq;
+};
+
+TEST_F(testContactKinematics, testMatchesIDynTree)
+{
+    const std::list<std::string>& links = bigman.getLinksInContact();
+    const unsigned int k = links.size();
+    ASSERT_GT(k, 0u);
+
+    Eigen::MatrixXd J(6*k, nJ+6);
+    Eigen::VectorXd dJ_nu(6*k);
+    std::vector<Eigen::Matrix4d> poses(k);
+    ASSERT_TRUE(bigman.getContactKinematics(J, dJ_nu, &poses[0]));
+
+    Eigen::MatrixXd J_link(6, nJ+6);
+    Eigen::Matrix4d pose;
+    unsigned int c = 0;
+    for(std::list<std::string>::const_iterator link = links.begin(); link != links.end(); ++link, ++c)
+    {
+        ASSERT_TRUE(bigman.getJacobian(bigman.getLinkHandle(*link), J_link));
+        EXPECT_TRUE(J.middleRows(6*c, 6).isApprox(J_link, 1e-9)) << *link << std::endl
+                                                                 << J.middleRows(6*c, 6) << std::endl
+                                                                 << " vs " << std::endl << J_link;
+
+        cartesian_utils::fromKDLFrameToEigenMatrix(bigman.getPose(*link), pose);
+        EXPECT_TRUE(poses[c].isApprox(pose, 1e-9)) << *link;
+    }
+}
+
+TEST_F(testContactKinematics, testSetLinksInContact)
+{
+    // the contacts are resolved again when the links in contact change
+    const unsigned int k = bigman.getLinksInContact().size();
+    Eigen::MatrixXd J_all(6*k, nJ+6);
+    Eigen::VectorXd dJ_nu_all(6*k);
+    ASSERT_TRUE(bigman.getContactKinematics(J_all, dJ_nu_all));
+
+    Eigen::MatrixXd J(12, nJ+6);
+    Eigen::VectorXd dJ_nu(12);
+    std::list<std::string> feet;
+    feet.push_back("r_sole");
+    feet.push_back("l_sole");
+    bigman.setLinksInContact(feet);
+    ASSERT_TRUE(bigman.getContactKinematics(J, dJ_nu));
+
+    Eigen::MatrixXd J_link(6, nJ+6);
+    ASSERT_TRUE(bigman.getJacobian(bigman.getLinkHandle("r_sole"), J_link));
+    EXPECT_TRUE(J.topRows(6).isApprox(J_link, 1e-9));
+    ASSERT_TRUE(bigman.getJacobian(bigman.getLinkHandle("l_sole"), J_link));
+    EXPECT_TRUE(J.bottomRows(6).isApprox(J_link, 1e-9));
+}
+
+TEST_F(testContactKinematics, testBiasMatchesFiniteDifferences)
+{
+    // the floating base moves too
+    idynutils::contact_kinematics contacts(bigman.getKDLTree(), bigman.getDOFNames());
+    const int base = contacts.getLinkIndex("Waist");
+    ASSERT_NE(base, -1);
+    std::vector<int> feet;
+    feet.push_back(contacts.getLinkIndex("l_sole"));
+    feet.push_back(contacts.getLinkIndex("r_sole"));
+    feet.push_back(contacts.getLinkIndex("LSoftHand"));
+    EXPECT_FALSE(contacts.setContacts(std::vector<int>(1, -1)));
+    ASSERT_TRUE(contacts.setContacts(feet));
+
+    const KDL::Frame world_T_base(KDL::Rotation::RPY(0.1, -0.2, 0.3), KDL::Vector(0.1, 0.2, 1.0));
+    const KDL::Twist base_velocity(KDL::Vector(0.3, -0.5, 0.2), KDL::Vector(0.4, 0.1, -0.3));
+    Eigen::MatrixXd J(18, nJ+6);
+    Eigen::VectorXd dJ_nu(18);
+    contacts.compute(base, world_T_base, base_velocity, q, dq, J, dJ_nu);
+
+    Eigen::VectorXd nu(nJ+6);
+    nu << 0.3, -0.5, 0.2, 0.4, 0.1, -0.3, dq;
+
+    // the acceleration at constant nu is dJ*nu
+    const double dt = 1e-6;
+    Eigen::MatrixXd J_plus(18, nJ+6), J_minus(18, nJ+6);
+    Eigen::VectorXd unused(18);
+    const KDL::Rotation dR = KDL::Rotation::Rot(base_velocity.rot, base_velocity.rot.Norm()*dt);
+    contacts.compute(base, KDL::Frame(dR*world_T_base.M, world_T_base.p + base_velocity.vel*dt),
+                     base_velocity, q + dq*dt, dq, J_plus, unused);
+    const KDL::Vector l_sole_plus = contacts.getPose(0).p;
+    contacts.compute(base, KDL::Frame(dR.Inverse()*world_T_base.M, world_T_base.p - base_velocity.vel*dt),
+                     base_velocity, q - dq*dt, dq, J_minus, unused);
+    const KDL::Vector l_sole_minus = contacts.getPose(0).p;
+
+    Eigen::VectorXd dJ_nu_fd = (J_plus - J_minus)*nu/(2.0*dt);
+    EXPECT_TRUE(dJ_nu.isApprox(dJ_nu_fd, 1e-5)) << dJ_nu.transpose() << std::endl
+                                               << " vs " << std::endl << dJ_nu_fd.transpose();
+
+    // and the velocity is J*nu
+    const KDL::Vector v = (l_sole_plus - l_sole_minus)/(2.0*dt);
+    Eigen::Vector3d v_J = J.topRows(3)*nu;
+    EXPECT_NEAR(v.x(), v_J[0], 1e-5);
+    EXPECT_NEAR(v.y(), v_J[1], 1e-5);
+    EXPECT_NEAR(v.z(), v_J[2], 1e-5);
+}
+
+TEST_F(testContactKinematics, testBiasAcceleration)
+{
+    // the floating base is kept still, so dJ*nu = dJ/dt*[0; dq]
+    Eigen::VectorXd nu(nJ+6);
+    nu << Eigen::VectorXd::Zero(6), dq;
+    const double dt = 1e-6;
+    Eigen::MatrixXd J_plus(6, nJ+6), J_minus(6, nJ+6);
+    Eigen::MatrixXd J_CoM_plus, J_CoM_minus;
+    Eigen::VectorXd dJ_nu(6), dJCoM_nu(3);
+
+    const char* links[] = {"l_sole", "RSoftHand", "Waist"};
+    for(unsigned int i = 0; i < 3; ++i)
+    {
+        const LinkHandle link = bigman.getLinkHandle(links[i]);
+        bigman.updateiDyn3Model(q + dq*dt, dq, false);
+        ASSERT_TRUE(bigman.getJacobian(link, J_plus));
+        bigman.updateiDyn3Model(q - dq*dt, dq, false);
+        ASSERT_TRUE(bigman.getJacobian(link, J_minus));
+
+        bigman.updateiDyn3Model(q, dq, false);
+        ASSERT_TRUE(bigman.getBiasAcceleration(link, dJ_nu));
+        Eigen::VectorXd dJ_nu_fd = (J_plus - J_minus)*nu/(2.0*dt);
+        EXPECT_TRUE(dJ_nu.isApprox(dJ_nu_fd, 1e-5)) << links[i] << std::endl
+                                                   << dJ_nu.transpose() << std::endl
+                                                   << " vs " << std::endl << dJ_nu_fd.transpose();
+    }
+    EXPECT_FALSE(bigman.getBiasAcceleration(LinkHandle(), dJ_nu));
+
+    bigman.updateiDyn3Model(q + dq*dt, dq, false);
+    ASSERT_TRUE(bigman.getCOMJacobian(J_CoM_plus));
+    bigman.updateiDyn3Model(q - dq*dt, dq, false);
+    ASSERT_TRUE(bigman.getCOMJacobian(J_CoM_minus));
+
+    bigman.updateiDyn3Model(q, dq, false);
+    ASSERT_TRUE(bigman.getCOMBiasAcceleration(dJCoM_nu));
+    Eigen::VectorXd dJCoM_nu_fd = (J_CoM_plus - J_CoM_minus).topRows(3)*nu/(2.0*dt);
+    EXPECT_TRUE(dJCoM_nu.isApprox(dJCoM_nu_fd, 1e-5)) << dJCoM_nu.transpose() << std::endl
+                                                     << " vs " << std::endl << dJCoM_nu_fd.transpose();
+}
+
+TEST_F(testContactKinematics, testBiasAccelerationTime)
+{
+    const LinkHandle link = bigman.getLinkHandle("LSoftHand");
+    Eigen::VectorXd nu(nJ+6);
+    nu << Eigen::VectorXd::Zero(6), dq;
+    Eigen::VectorXd dJ_nu(6), dJCoM_nu(3);
+    Eigen::MatrixXd J_plus(6, nJ+6), J_minus(6, nJ+6);
+    const double dt = 1e-6;
+    const unsigned int iterations = 1000;
+
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        bigman.getBiasAcceleration(link, dJ_nu);
+        bigman.getCOMBiasAcceleration(dJCoM_nu);
+    }
+    double analytic_time = yarp::os::Time::now() - t;
+
+    // finite differences of the Jacobian, two updates of the model
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        bigman.updateiDyn3Model(q + dq*dt, dq, false);
+        bigman.getJacobian(link, J_plus);
+        bigman.updateiDyn3Model(q - dq*dt, dq, false);
+        bigman.getJacobian(link, J_minus);
+        dJ_nu = (J_plus - J_minus)*nu/(2.0*dt);
+    }
+    double finite_differences_time = yarp::os::Time::now() - t;
+
+    std::cout << "link and CoM dJ*nu: " << analytic_time/iterations << " [s], "
+              << "link dJ*nu by finite differences: " << finite_differences_time/iterations << " [s]" << std::endl;
+}
+
+TEST_F(testContactKinematics, testContactKinematicsTime)
+{
+    const std::list<std::string>& links = bigman.getLinksInContact();
+    const unsigned int k = links.size();
+    Eigen::MatrixXd J(6*k, nJ+6);
+    Eigen::VectorXd dJ_nu(6*k);
+    std::vector<Eigen::Matrix4d> poses(k);
+    const unsigned int iterations = 1000;
+
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i)
+        bigman.getContactKinematics(J, dJ_nu, &poses[0]);
+    double contact_time = yarp::os::Time::now() - t;
+
+    // a Jacobian and a pose per link, which do not give dJ*nu yet
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        unsigned int c = 0;
+        for(std::list<std::string>::const_iterator link = links.begin(); link != links.end(); ++link, ++c) {
+            bigman.getJacobian(bigman.getLinkHandle(*link), J.middleRows(6*c, 6));
+            cartesian_utils::fromKDLFrameToEigenMatrix(bigman.getPose(*link), poses[c]);
+        }
+    }
+    double per_link_time = yarp::os::Time::now() - t;
+
+    std::cout << k << " links in contact, J, dJ*nu and poses: " << contact_time/iterations << " [s], "
+              << "J and poses link by link: " << per_link_time/iterations << " [s]" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <idynutils/forward_dynamics.h>
+#include <idynutils/idynutils.h>
+#include <yarp/os/Time.h>
+
+namespace{
+
+class testForwardDynamics: public ::testing::Test
+{
+protected:
+    testForwardDynamics() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testForwardDynamics() {
+
+    }
+
+    virtual void SetUp() {
+        nJ = bigman.iDyn3_model.getNrOfDOFs();
+        q = Eigen::VectorXd::Random(nJ);
+        dq = Eigen::VectorXd::Random(nJ);
+        tau = Eigen::VectorXd::Random(nJ)*10.0;
+        bigman.updateiDyn3Model(q, dq, true);
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    iDynUtils bigman;
+    unsigned int nJ;
+    Eigen::VectorXd q;
+    Eigen::VectorXd dq;
+    Eigen::VectorXd tau;
+};
+
+TEST_F(testForwardDynamics, testMassMatrix)
+{
+    Eigen::MatrixXd M(nJ+6, nJ+6);
+    ASSERT_TRUE(bigman.getMassMatrix(M));
+    EXPECT_TRUE(M.isApprox(M.transpose(), 1e-12));
+
+    // the joint block does not depend on how the floating base velocity is represented
+    Eigen::MatrixXd M_iDynTree(nJ+6, nJ+6);
+    ASSERT_TRUE(bigman.getFloatingBaseMassMatrix(M_iDynTree));
+    EXPECT_TRUE(M.bottomRightCorner(nJ, nJ).isApprox(M_iDynTree.bottomRightCorner(nJ, nJ), 1e-6))
+        << M.bottomRightCorner(nJ, nJ) << std::endl << " vs " << std::endl
+        << M_iDynTree.bottomRightCorner(nJ, nJ);
+
+    // translating the floating base moves the whole mass
+    Eigen::MatrixXd A(6, nJ+6);
+    Eigen::VectorXd dA_dq(6);
+    ASSERT_TRUE(bigman.getCentroidalMomentumMatrix(A, dA_dq));
+    EXPECT_NEAR(M(0,0), A(0,0), 1e-9);
+    EXPECT_NEAR(M(1,1), A(0,0), 1e-9);
+    EXPECT_NEAR(M(2,2), A(0,0), 1e-9);
+}
+
+TEST_F(testForwardDynamics, testMatchesMassMatrix)
+{
+    Eigen::VectorXd dnu(nJ+6), dnu_no_torques(nJ+6);
+    ASSERT_TRUE(bigman.getForwardDynamics(tau, dnu));
+    ASSERT_TRUE(bigman.getForwardDynamics(Eigen::VectorXd::Zero(nJ), dnu_no_torques));
+
+    // the bias forces cancel out: M (dnu - dnu_no_torques) = [0; tau]
+    Eigen::MatrixXd x(nJ+6, 1);
+    x << Eigen::VectorXd::Zero(6), tau;
+    EXPECT_FALSE(bigman.solveMassMatrix(x));
+    ASSERT_TRUE(bigman.factorizeMassMatrix());
+    ASSERT_TRUE(bigman.solveMassMatrix(x));
+    EXPECT_TRUE((dnu - dnu_no_torques).isApprox(x.col(0), 1e-9)) << (dnu - dnu_no_torques).transpose()
+                                                                  << std::endl << " vs " << std::endl
+                                                                  << x.transpose();
+
+    Eigen::MatrixXd M(nJ+6, nJ+6);
+    ASSERT_TRUE(bigman.getMassMatrix(M));
+    Eigen::MatrixXd X = Eigen::MatrixXd::Random(nJ+6, 3);
+    Eigen::MatrixXd Minv_X = X;
+    ASSERT_TRUE(bigman.solveMassMatrix(Minv_X));
+    EXPECT_TRUE(Minv_X.isApprox(M.ldlt().solve(X), 1e-9));
+}
+
+TEST_F(testForwardDynamics, testMomentum)
+{
+    // joint torques are internal forces: the momentum changes only because of gravity
+    const KDL::Twist base_velocity(KDL::Vector(0.3, -0.5, 0.2), KDL::Vector(0.4, 0.1, -0.3));
+    Eigen::VectorXd dnu(nJ+6);
+    ASSERT_TRUE(bigman.getForwardDynamics(tau, dnu, base_velocity));
+
+    Eigen::MatrixXd A(6, nJ+6);
+    Eigen::VectorXd dA_dq(6);
+    ASSERT_TRUE(bigman.getCentroidalMomentumMatrix(A, dA_dq, base_velocity));
+    const double mass = A(0,0);
+
+    Eigen::VectorXd dh = A*dnu + dA_dq;
+    EXPECT_NEAR(dh[0], 0.0, 1e-6);
+    EXPECT_NEAR(dh[1], 0.0, 1e-6);
+    EXPECT_NEAR(dh[2], -9.81*mass, 1e-6);
+    EXPECT_NEAR(dh.tail(3).norm(), 0.0, 1e-6);
+}
+
+TEST_F(testForwardDynamics, testRotatedBase)
+{
+    // at rest and without torques the CoM falls with gravity, whatever the orientation of the base
+    bigman.setAnchor_T_World(KDL::Frame(KDL::Rotation::RPY(0.4, -0.3, 0.2), KDL::Vector(0.1, 0.2, 0.3)));
+    bigman.updateiDyn3Model(q, Eigen::VectorXd::Zero(nJ), true);
+
+    Eigen::VectorXd dnu(nJ+6);
+    ASSERT_TRUE(bigman.getForwardDynamics(Eigen::VectorXd::Zero(nJ), dnu));
+
+    Eigen::MatrixXd A(6, nJ+6);
+    Eigen::VectorXd dA_dq(6);
+    ASSERT_TRUE(bigman.getCentroidalMomentumMatrix(A, dA_dq));
+    Eigen::Vector3d com_acceleration = (A.topRows(3)*dnu + dA_dq.head(3))/A(0,0);
+    EXPECT_NEAR(com_acceleration[0], 0.0, 1e-6);
+    EXPECT_NEAR(com_acceleration[1], 0.0, 1e-6);
+    EXPECT_NEAR(com_acceleration[2], -9.81, 1e-6);
+}
+
+TEST_F(testForwardDynamics, testFloatingBaseSwitch)
+{
+    ASSERT_TRUE(bigman.factorizeMassMatrix());
+
+    ASSERT_TRUE(bigman.setFloatingBaseLink("l_sole"));
+    bigman.updateiDyn3Model(q, dq, true);
+
+    Eigen::MatrixXd M(nJ+6, nJ+6);
+    ASSERT_TRUE(bigman.getMassMatrix(M));
+    ASSERT_TRUE(bigman.factorizeMassMatrix());
+    Eigen::MatrixXd X = Eigen::MatrixXd::Random(nJ+6, 2);
+    Eigen::MatrixXd Minv_X = X;
+    ASSERT_TRUE(bigman.solveMassMatrix(Minv_X));
+    EXPECT_TRUE(Minv_X.isApprox(M.ldlt().solve(X), 1e-9));
+
+    Eigen::VectorXd dnu(nJ+6), dnu_no_torques(nJ+6);
+    ASSERT_TRUE(bigman.getForwardDynamics(tau, dnu));
+    ASSERT_TRUE(bigman.getForwardDynamics(Eigen::VectorXd::Zero(nJ), dnu_no_torques));
+    Eigen::VectorXd f(nJ+6);
+    f << Eigen::VectorXd::Zero(6), tau;
+    EXPECT_TRUE((dnu - dnu_no_torques).isApprox(M.ldlt().solve(f), 1e-9));
+}
+
+TEST_F(testForwardDynamics, testForwardDynamicsTime)
+{
+    Eigen::VectorXd dnu(nJ+6);
+    Eigen::MatrixXd M(nJ+6, nJ+6);
+    Eigen::MatrixXd X = Eigen::MatrixXd::Random(nJ+6, 1);
+    const unsigned int iterations = 1000;
+
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i)
+        bigman.getForwardDynamics(tau, dnu);
+    double aba_time = yarp::os::Time::now() - t;
+
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        bigman.factorizeMassMatrix();
+        bigman.solveMassMatrix(X);
+    }
+    double sparse_time = yarp::os::Time::now() - t;
+
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        bigman.getFloatingBaseMassMatrix(M);
+        X = M.ldlt().solve(X);
+    }
+    double dense_time = yarp::os::Time::now() - t;
+
+    std::cout << "ABA: " << aba_time/iterations << " [s], "
+              << "CRBA, sparse factorization and solve: " << sparse_time/iterations << " [s], "
+              << "iDynTree mass matrix and dense solve: " << dense_time/iterations << " [s]" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
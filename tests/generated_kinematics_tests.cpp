@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <idynutils/idynutils.h>
+#include <idynutils/incremental_kinematics.h>
+#include <idynutils/cartesian_utils.h>
+#include <coman_generated_kinematics.h>
+#include <bigman_generated_kinematics.h>
+#include <yarp/os/Time.h>
+#include <sstream>
+
+namespace{
+
+class testGeneratedKinematics: public ::testing::Test
+{
+protected:
+    testGeneratedKinematics() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testGeneratedKinematics() {
+
+    }
+
+    virtual void SetUp() {
+
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    void expectSamePose(const KDL::Frame& a, const KDL::Frame& b)
+    {
+        Eigen::Matrix4d A, B;
+        cartesian_utils::fromKDLFrameToEigenMatrix(a, A);
+        cartesian_utils::fromKDLFrameToEigenMatrix(b, B);
+        EXPECT_TRUE(A.isApprox(B, 1e-9)) << A << std::endl << " vs " << std::endl << B;
+    }
+
+    Eigen::VectorXd randomConfiguration()
+    {
+        Eigen::VectorXd q_min = bigman.getJointBoundMin();
+        Eigen::VectorXd q_max = bigman.getJointBoundMax();
+        Eigen::VectorXd r = (Eigen::VectorXd::Random(q_min.size()).array() + 1.0)/2.0;
+        return q_min + (q_max - q_min).cwiseProduct(r);
+    }
+
+    iDynUtils bigman;
+};
+
+TEST_F(testGeneratedKinematics, testMatchesIDynTree)
+{
+    boost::shared_ptr<iDynUtils> generated = bigman.clone();
+    ASSERT_TRUE(generated->setGeneratedKinematics(boost::shared_ptr<idynutils::generated_kinematics>(
+                                                      new idynutils::bigman_generated_kinematics())));
+    ASSERT_TRUE(generated->isGeneratedKinematicsEnabled());
+
+    const char* links[] = {"l_wrist", "r_wrist", "l_sole", "r_sole", "Waist", "gaze"};
+    for(unsigned int k = 0; k < 5; ++k)
+    {
+        Eigen::VectorXd q = randomConfiguration();
+        bigman.updateiDyn3Model(q, true);
+        generated->updateiDyn3Model(q, true);
+
+        for(unsigned int i = 0; i < sizeof(links)/sizeof(links[0]); ++i)
+        {
+            expectSamePose(generated->getPose(links[i]), bigman.getPose(links[i]));
+            expectSamePose(generated->getPose("l_sole", links[i]), bigman.getPose("l_sole", links[i]));
+        }
+
+        KDL::Vector com = generated->getCoM();
+        KDL::Vector com_idyntree = bigman.getCoM();
+        for(unsigned int i = 0; i < 3; ++i)
+            EXPECT_NEAR(com[i], com_idyntree[i], 1e-9);
+    }
+
+    generated->setGeneratedKinematics(boost::shared_ptr<idynutils::generated_kinematics>());
+    EXPECT_FALSE(generated->isGeneratedKinematicsEnabled());
+    expectSamePose(generated->getPose("r_wrist"), bigman.getPose("r_wrist"));
+}
+
+TEST_F(testGeneratedKinematics, testJacobian)
+{
+    idynutils::bigman_generated_kinematics fk;
+    idynutils::incremental_kinematics incremental_fk(bigman);
+    incremental_fk.setWorldPose(KDL::Frame::Identity());
+
+    Eigen::VectorXd q = randomConfiguration();
+    fk.setJointPositions(q);
+    incremental_fk.setJointPositions(q);
+
+    const unsigned int nJ = fk.getNrOfDOFs();
+    Eigen::MatrixXd J(6, nJ), J_incremental(6, nJ);
+    const char* links[] = {"l_wrist", "r_wrist", "l_sole"};
+    for(unsigned int i = 0; i < sizeof(links)/sizeof(links[0]); ++i)
+    {
+        const int link = fk.getLinkIndex(links[i]);
+        ASSERT_NE(link, -1);
+        expectSamePose(fk.getPose(link), incremental_fk.getPose(incremental_fk.getLinkIndex(links[i])));
+
+        fk.getJacobian(link, J);
+        incremental_fk.getJacobian(incremental_fk.getLinkIndex(links[i]), J_incremental);
+        EXPECT_TRUE(J.isApprox(J_incremental, 1e-9)) << J << std::endl << " vs " << std::endl << J_incremental;
+    }
+}
+
+TEST_F(testGeneratedKinematics, testWrongRobot)
+{
+    boost::shared_ptr<iDynUtils> generated = bigman.clone();
+    std::stringstream printed;
+    std::streambuf* cout_buffer = std::cout.rdbuf(printed.rdbuf());
+    EXPECT_FALSE(generated->setGeneratedKinematics(boost::shared_ptr<idynutils::generated_kinematics>(
+                                                       new idynutils::coman_generated_kinematics())));
+    std::cout.rdbuf(cout_buffer);
+    EXPECT_FALSE(generated->isGeneratedKinematicsEnabled());
+    // reporting the mismatch is up to the caller
+    EXPECT_TRUE(printed.str().empty());
+}
+
+TEST_F(testGeneratedKinematics, testFKTime)
+{
+    idynutils::bigman_generated_kinematics fk;
+    idynutils::incremental_kinematics incremental_fk(bigman);
+    const unsigned int iterations = 1000;
+    Eigen::VectorXd q = randomConfiguration();
+
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        q[0] = i*1e-3;
+        bigman.iDyn3_model.setAng(cartesian_utils::fromEigentoYarp(q));
+        bigman.iDyn3_model.computePositions();
+    }
+    double idyntree_time = yarp::os::Time::now() - t;
+
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        q[0] = i*1e-3;
+        // all the joints change, so that the whole tree gets recomputed
+        incremental_fk.setJointPositions(-q);
+        incremental_fk.getPose(0);
+        incremental_fk.setJointPositions(q);
+        incremental_fk.getPose(0);
+    }
+    double kdl_time = (yarp::os::Time::now() - t)/2.0;
+
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        q[0] = i*1e-3;
+        fk.setJointPositions(q);
+    }
+    double generated_time = yarp::os::Time::now() - t;
+
+    std::cout << "bigman FK, iDynTree computePositions: " << idyntree_time/iterations << " [s], "
+              << "KDL traversal: " << kdl_time/iterations << " [s], "
+              << "generated: " << generated_time/iterations << " [s]" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -15,9 +15,13 @@
 #include <ros/time.h>
 #include <ros/master.h>
 
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <cstdlib>
 
+#include "allocation_counter.h"
+
 int _argc;
 char** _argv;
 
@@ -514,6 +518,520 @@ TEST_F(testIDynUtils, testUpdateIdyn3Model)
     }
 }
 
+TEST_F(testIDynUtils, testUpdateIdyn3ModelEigen)
+{
+    this->setGoodInitialPosition();
+    Eigen::VectorXd q = cartesian_utils::toEigen(this->q);
+    Eigen::VectorXd dq = Eigen::VectorXd::Constant(q.size(), 0.1);
+    Eigen::VectorXd ddq = Eigen::VectorXd::Constant(q.size(), 0.2);
+
+    this->updateiDyn3Model(q, dq, ddq, true);
+    yarp::sig::Matrix T_eigen = this->iDyn3_model.getPosition(this->iDyn3_model.getLinkIndex("l_wrist"));
+    yarp::sig::Vector tau_eigen = this->iDyn3_model.getTorques();
+
+    this->updateiDyn3Model(cartesian_utils::fromEigentoYarp(q),
+                           cartesian_utils::fromEigentoYarp(dq),
+                           cartesian_utils::fromEigentoYarp(ddq), true);
+    yarp::sig::Matrix T_yarp = this->iDyn3_model.getPosition(this->iDyn3_model.getLinkIndex("l_wrist"));
+    yarp::sig::Vector tau_yarp = this->iDyn3_model.getTorques();
+
+    for(unsigned int i = 0; i < 4; ++i)
+        for(unsigned int j = 0; j < 4; ++j)
+            EXPECT_DOUBLE_EQ(T_eigen(i,j), T_yarp(i,j));
+    for(unsigned int i = 0; i < tau_yarp.size(); ++i)
+        EXPECT_DOUBLE_EQ(tau_eigen[i], tau_yarp[i]);
+
+    // segments of a bigger vector can be passed without copies
+    Eigen::VectorXd state(3*q.size());
+    state << q, dq, ddq;
+    this->updateiDyn3Model(state.segment(0, q.size()),
+                           state.segment(q.size(), q.size()),
+                           state.segment(2*q.size(), q.size()), true);
+    tau_eigen = this->iDyn3_model.getTorques();
+    for(unsigned int i = 0; i < tau_yarp.size(); ++i)
+        EXPECT_DOUBLE_EQ(tau_eigen[i], tau_yarp[i]);
+}
+
+TEST_F(testIDynUtils, testUpdateIdyn3ModelEigenDoesNotAllocate)
+{
+    this->setGoodInitialPosition();
+    Eigen::VectorXd q = cartesian_utils::toEigen(this->q);
+    Eigen::VectorXd dq = Eigen::VectorXd::Constant(q.size(), 0.1);
+    Eigen::VectorXd ddq = Eigen::VectorXd::Constant(q.size(), 0.2);
+    this->updateiDyn3Model(q, dq, ddq, true);
+
+    // DynTree::setAng, setDAng and setD2Ang return the state by value, so
+    // iDynTree allocates on its own: we count the allocations of the bare
+    // iDynTree update and check iDynUtils does not add any on top of it
+    yarp::sig::Vector q_yarp = cartesian_utils::fromEigentoYarp(q);
+    yarp::sig::Vector dq_yarp = cartesian_utils::fromEigentoYarp(dq);
+    yarp::sig::Vector ddq_yarp = cartesian_utils::fromEigentoYarp(ddq);
+    yarp::sig::Vector o(3, 0.0);
+    yarp::sig::Vector g(this->g);
+
+    allocation_counter::start();
+    this->iDyn3_model.setAng(q_yarp);
+    this->iDyn3_model.setDAng(dq_yarp);
+    this->iDyn3_model.setD2Ang(ddq_yarp);
+    this->iDyn3_model.getPositionKDL(0, this->iDyn3_model.getFloatingBaseLink());
+    this->iDyn3_model.setInertialMeasure(o, o, g);
+    this->iDyn3_model.kinematicRNEA();
+    this->iDyn3_model.dynamicRNEA();
+    this->iDyn3_model.computePositions();
+    unsigned int idyntree_allocations = allocation_counter::stop();
+
+    allocation_counter::start();
+    this->updateiDyn3Model(q, dq, ddq);
+    unsigned int idynutils_allocations = allocation_counter::stop();
+
+    std::cout << "iDynTree update allocations: " << idyntree_allocations << std::endl;
+    std::cout << "iDynUtils Eigen update allocations: " << idynutils_allocations << std::endl;
+    EXPECT_LE(idynutils_allocations, idyntree_allocations);
+}
+
+TEST_F(testIDynUtils, testLazyUpdate)
+{
+    EXPECT_FALSE(this->isLazyUpdateEnabled());
+
+    this->setGoodInitialPosition();
+    Eigen::VectorXd q = cartesian_utils::toEigen(this->q);
+    Eigen::VectorXd dq = Eigen::VectorXd::Constant(q.size(), 0.1);
+    Eigen::VectorXd ddq = Eigen::VectorXd::Constant(q.size(), 0.2);
+
+    // eager update, used as reference
+    this->updateiDyn3Model(q, dq, ddq, true);
+    KDL::Frame l_wrist = this->getPose("l_wrist");
+    KDL::Frame l_wrist_l_sole = this->getPose("l_wrist", "l_sole");
+    KDL::Vector CoM = this->getCoM();
+    Eigen::VectorXd tau = this->getTorques();
+    Eigen::MatrixXd J;
+    this->getJacobian(this->iDyn3_model.getLinkIndex("l_wrist"), J);
+    Eigen::MatrixXd M;
+    this->getFloatingBaseMassMatrix(M);
+    Eigen::VectorXd h = this->getCentroidalMomentum();
+
+    // moving the robot somewhere else
+    Eigen::VectorXd q_other = q;
+    q_other[this->left_arm.joint_numbers[0]] += 0.3;
+    this->updateiDyn3Model(q_other, dq, ddq, true);
+
+    this->enableLazyUpdate();
+    EXPECT_TRUE(this->isLazyUpdateEnabled());
+    this->updateiDyn3Model(q, dq, ddq, true);
+    EXPECT_TRUE(this->_kinematics_dirty);
+    EXPECT_TRUE(this->_dynamics_dirty);
+    EXPECT_TRUE(this->_positions_dirty);
+
+    // asking for a pose only computes the positions
+    EXPECT_TRUE(this->getPose("l_wrist") == l_wrist);
+    EXPECT_TRUE(this->_kinematics_dirty);
+    EXPECT_TRUE(this->_dynamics_dirty);
+    EXPECT_FALSE(this->_positions_dirty);
+    EXPECT_TRUE(this->getPose("l_wrist", "l_sole") == l_wrist_l_sole);
+    EXPECT_TRUE(this->getCoM() == CoM);
+
+    Eigen::MatrixXd J_lazy;
+    this->getJacobian(this->iDyn3_model.getLinkIndex("l_wrist"), J_lazy);
+    EXPECT_TRUE(J_lazy.isApprox(J));
+    Eigen::MatrixXd M_lazy;
+    this->getFloatingBaseMassMatrix(M_lazy);
+    EXPECT_TRUE(M_lazy.isApprox(M));
+    EXPECT_TRUE(this->_kinematics_dirty);
+
+    // asking for torques runs both kinematic and dynamic RNEA
+    Eigen::VectorXd tau_lazy = this->getTorques();
+    EXPECT_FALSE(this->_kinematics_dirty);
+    EXPECT_FALSE(this->_dynamics_dirty);
+    for(unsigned int i = 0; i < tau.size(); ++i)
+        EXPECT_DOUBLE_EQ(tau[i], tau_lazy[i]);
+    EXPECT_TRUE(this->getCentroidalMomentum().isApprox(h));
+
+    // disabling the lazy update brings the model up to date
+    this->updateiDyn3Model(q_other, dq, ddq, true);
+    this->disableLazyUpdate();
+    EXPECT_FALSE(this->_kinematics_dirty);
+    EXPECT_FALSE(this->_dynamics_dirty);
+    EXPECT_FALSE(this->_positions_dirty);
+    EXPECT_FALSE(this->getPose("l_wrist") == l_wrist);
+}
+
+TEST_F(testIDynUtils, testLinkHandles)
+{
+    this->setGoodInitialPosition();
+
+    LinkHandle l_wrist = this->getLinkHandle("l_wrist");
+    LinkHandle l_sole = this->getLinkHandle("l_sole");
+    LinkHandle not_a_link = this->getLinkHandle("not_a_link");
+
+    ASSERT_TRUE(l_wrist.isValid());
+    ASSERT_TRUE(l_sole.isValid());
+    EXPECT_FALSE(not_a_link.isValid());
+    EXPECT_FALSE(LinkHandle().isValid());
+    EXPECT_TRUE(l_wrist == this->getLinkHandle("l_wrist"));
+    EXPECT_TRUE(l_wrist != l_sole);
+    EXPECT_EQ(l_wrist.getIndex(), this->iDyn3_model.getLinkIndex("l_wrist"));
+
+    EXPECT_TRUE(this->getPose(l_wrist) == this->getPose("l_wrist"));
+    EXPECT_TRUE(this->getPose(l_sole, l_wrist) == this->getPose("l_sole", "l_wrist"));
+    EXPECT_TRUE(this->getCoM(l_sole) == this->getCoM("l_sole"));
+
+    Eigen::MatrixXd J_handle, J_index;
+    EXPECT_TRUE(this->getJacobian(l_wrist, J_handle));
+    EXPECT_TRUE(this->getJacobian(l_wrist.getIndex(), J_index));
+    EXPECT_TRUE(J_handle == J_index);
+    EXPECT_TRUE(this->getRelativeJacobian(l_wrist, l_sole, J_handle));
+    EXPECT_TRUE(this->getRelativeJacobian(l_wrist.getIndex(), l_sole.getIndex(), J_index));
+    EXPECT_TRUE(J_handle == J_index);
+
+    // invalid handles give zero frames and failing Jacobians
+    KDL::Frame T = this->getPose(not_a_link);
+    KDL::Frame T_string = this->getPose("not_a_link");
+    for(unsigned int i = 0; i < 3; ++i) {
+        EXPECT_DOUBLE_EQ(T.p[i], 0.0);
+        EXPECT_DOUBLE_EQ(T_string.p[i], 0.0);
+        for(unsigned int j = 0; j < 3; ++j) {
+            EXPECT_DOUBLE_EQ(T.M(i,j), 0.0);
+            EXPECT_DOUBLE_EQ(T_string.M(i,j), 0.0);
+        }
+    }
+    T = this->getPose(l_wrist, not_a_link);
+    EXPECT_DOUBLE_EQ(T.M(0,0), 0.0);
+    EXPECT_TRUE(this->getCoM(not_a_link) == KDL::Vector::Zero());
+    EXPECT_FALSE(this->getJacobian(not_a_link, J_handle));
+    EXPECT_FALSE(this->getRelativeJacobian(l_wrist, not_a_link, J_handle));
+}
+
+TEST_F(testIDynUtils, testGetPoses)
+{
+    this->setGoodInitialPosition();
+
+    std::vector<LinkHandle> links;
+    links.push_back(this->getLinkHandle("l_wrist"));
+    links.push_back(this->getLinkHandle("r_wrist"));
+    links.push_back(this->getLinkHandle("l_sole"));
+    links.push_back(this->getLinkHandle("r_sole"));
+    links.push_back(this->getLinkHandle("Waist"));
+    LinkHandle l_sole = this->getLinkHandle("l_sole");
+
+    std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d> > poses(links.size());
+    EXPECT_TRUE(this->getPoses(links, &poses[0]));
+    for(unsigned int i = 0; i < links.size(); ++i)
+        EXPECT_TRUE(poses[i].isApprox(cartesian_utils::toEigen(this->getPose(links[i]))));
+
+    EXPECT_TRUE(this->getPoses(links, l_sole, &poses[0]));
+    for(unsigned int i = 0; i < links.size(); ++i)
+        EXPECT_TRUE(poses[i].isApprox(cartesian_utils::toEigen(this->getPose(l_sole, links[i])),
+                                      1e-12)) << "link " << i;
+
+    // invalid handles
+    links.push_back(this->getLinkHandle("not_a_link"));
+    poses.resize(links.size());
+    EXPECT_FALSE(this->getPoses(links, &poses[0]));
+    EXPECT_TRUE(poses.back().isZero());
+    EXPECT_TRUE(poses.front().isApprox(cartesian_utils::toEigen(this->getPose(links.front()))));
+    EXPECT_FALSE(this->getPoses(links, LinkHandle(), &poses[0]));
+    EXPECT_TRUE(poses.front().isZero());
+}
+
+TEST_F(testIDynUtils, testPreallocatedJacobians)
+{
+    this->setGoodInitialPosition();
+    const int n = this->iDyn3_model.getNrOfDOFs();
+    const int l_wrist = this->iDyn3_model.getLinkIndex("l_wrist");
+    const int l_sole = this->iDyn3_model.getLinkIndex("l_sole");
+
+    Eigen::MatrixXd J, J_rel, JCoM, M;
+    ASSERT_TRUE(this->getJacobian(l_wrist, J));
+    ASSERT_TRUE(this->getRelativeJacobian(l_wrist, l_sole, J_rel));
+    ASSERT_TRUE(this->getCOMJacobian(JCoM));
+    ASSERT_TRUE(this->getFloatingBaseMassMatrix(M));
+
+    // writing into blocks of a bigger matrix
+    Eigen::MatrixXd A(12 + JCoM.rows(), n + 6); A.setZero();
+    EXPECT_TRUE(this->getJacobian(l_wrist, A.block(0, 0, 6, n + 6)));
+    EXPECT_TRUE(this->getRelativeJacobian(l_wrist, l_sole, A.block(6, 6, 6, n)));
+    EXPECT_TRUE(this->getCOMJacobian(A.block(12, 0, JCoM.rows(), n + 6)));
+    EXPECT_TRUE(A.block(0, 0, 6, n + 6) == J);
+    EXPECT_TRUE(A.block(6, 6, 6, n) == J_rel);
+    EXPECT_TRUE(A.block(6, 0, 6, 6).isZero());
+    EXPECT_TRUE(A.block(12, 0, JCoM.rows(), n + 6) == JCoM);
+
+    Eigen::MatrixXd M_big(n + 7, n + 7); M_big.setZero();
+    EXPECT_TRUE(this->getFloatingBaseMassMatrix(M_big.block(1, 1, n + 6, n + 6)));
+    EXPECT_TRUE(M_big.block(1, 1, n + 6, n + 6) == M);
+
+    Eigen::Matrix<double, 6, Eigen::Dynamic> J_fixed(6, n + 6);
+    EXPECT_TRUE(this->getJacobian(this->getLinkHandle("l_wrist"), J_fixed));
+    EXPECT_TRUE(J_fixed == J);
+
+    // chain column subsets
+    Eigen::MatrixXd J_chain(6, this->left_arm.getNrOfDOFs());
+    EXPECT_TRUE(this->getJacobian(l_wrist, this->left_arm, J_chain));
+    Eigen::MatrixXd J_rel_chain(6, this->left_arm.getNrOfDOFs());
+    EXPECT_TRUE(this->getRelativeJacobian(l_wrist, l_sole, this->left_arm, J_rel_chain));
+    for(unsigned int i = 0; i < this->left_arm.getNrOfDOFs(); ++i) {
+        EXPECT_TRUE(J_chain.col(i) == J.col(6 + this->left_arm.joint_numbers[i]));
+        EXPECT_TRUE(J_rel_chain.col(i) == J_rel.col(this->left_arm.joint_numbers[i]));
+    }
+
+    // no allocations on top of the ones done by iDynTree
+    yarp::sig::Matrix J_yarp(6, n + 6);
+    this->iDyn3_model.getJacobian(l_wrist, J_yarp);
+    allocation_counter::start();
+    this->iDyn3_model.getJacobian(l_wrist, J_yarp);
+    unsigned int idyntree_allocations = allocation_counter::stop();
+    allocation_counter::start();
+    this->getJacobian(l_wrist, A.block(0, 0, 6, n + 6));
+    this->getJacobian(l_wrist, J);
+    unsigned int idynutils_allocations = allocation_counter::stop();
+    EXPECT_LE(idynutils_allocations, 2*idyntree_allocations);
+}
+
+TEST_F(testIDynUtils, testClone)
+{
+    this->setGoodInitialPosition();
+    this->switchAnchor("r_sole");
+
+    yarp::sig::Vector ft_measurement(6, 0.0);
+    for(int i = 0; i < this->iDyn3_model.getNrOfFTSensors(); ++i){
+        for(unsigned int j = 0; j < 6; ++j)
+            ft_measurement[j] = (i+1.0)*(j+1.0);
+        this->iDyn3_model.setSensorMeasurement(i, ft_measurement);
+    }
+
+    double begin = yarp::os::Time::now();
+    boost::shared_ptr<iDynUtils> idynutils_clone = this->clone();
+    std::cout << "Cloning took " << yarp::os::Time::now() - begin << " [s]" << std::endl;
+
+    // the immutable model is shared
+    EXPECT_TRUE(idynutils_clone->urdf_model == this->urdf_model);
+    EXPECT_TRUE(idynutils_clone->robot_srdf == this->robot_srdf);
+    EXPECT_TRUE(idynutils_clone->moveit_robot_model == this->moveit_robot_model);
+    EXPECT_FALSE(idynutils_clone->moveit_planning_scene == this->moveit_planning_scene);
+    EXPECT_FALSE(idynutils_clone->moveit_collision_robot == this->moveit_collision_robot);
+
+    // the state is copied
+    EXPECT_EQ(idynutils_clone->getJointNames(), this->getJointNames());
+    EXPECT_EQ(idynutils_clone->getAnchor(), "r_sole");
+    EXPECT_EQ(idynutils_clone->left_arm.joint_numbers, this->left_arm.joint_numbers);
+    EXPECT_EQ(idynutils_clone->left_arm.index, this->left_arm.index);
+    EXPECT_EQ(&idynutils_clone->left_arm.index, &idynutils_clone->left_arm.end_effector_index);
+    EXPECT_TRUE(idynutils_clone->getAng().isApprox(this->getAng()));
+    EXPECT_TRUE(idynutils_clone->getJointBoundMax() == this->getJointBoundMax());
+    EXPECT_TRUE(idynutils_clone->getJointBoundMin() == this->getJointBoundMin());
+    EXPECT_TRUE(idynutils_clone->getJointTorqueMax() == this->getJointTorqueMax());
+    EXPECT_TRUE(idynutils_clone->getPose("l_wrist") == this->getPose("l_wrist"));
+    EXPECT_TRUE(idynutils_clone->getTorques().isApprox(this->getTorques()));
+    EXPECT_EQ(idynutils_clone->iDyn3_model.getNrOfFTSensors(), this->iDyn3_model.getNrOfFTSensors());
+    for(int i = 0; i < this->iDyn3_model.getNrOfFTSensors(); ++i){
+        yarp::sig::Vector ft(6, 0.0), ft_clone(6, 0.0);
+        EXPECT_TRUE(this->iDyn3_model.getSensorMeasurement(i, ft));
+        EXPECT_TRUE(idynutils_clone->iDyn3_model.getSensorMeasurement(i, ft_clone));
+        for(unsigned int j = 0; j < 6; ++j){
+            EXPECT_DOUBLE_EQ(ft_clone[j], ft[j]);
+            EXPECT_DOUBLE_EQ(ft_clone[j], (i+1.0)*(j+1.0));
+        }
+    }
+
+    // updating the clone does not change the original
+    KDL::Frame l_wrist = this->getPose("l_wrist");
+    yarp::sig::Vector q_clone(this->q);
+    q_clone[this->left_arm.joint_numbers[0]] += 0.5;
+    idynutils_clone->updateiDyn3Model(q_clone, true);
+    EXPECT_FALSE(idynutils_clone->getPose("l_wrist") == l_wrist);
+    EXPECT_TRUE(this->getPose("l_wrist") == l_wrist);
+
+    this->updateiDyn3Model(q_clone, true);
+    EXPECT_TRUE(idynutils_clone->getPose("l_wrist") == this->getPose("l_wrist"));
+    EXPECT_TRUE(idynutils_clone->getPose("Waist") == this->getPose("Waist"));
+
+    // collision checking works on the clone
+    EXPECT_EQ(idynutils_clone->checkSelfCollisionAt(q_clone),
+              this->checkSelfCollisionAt(q_clone));
+}
+
+TEST_F(testIDynUtils, testJointStateMsg)
+{
+    this->setGoodInitialPosition();
+
+    // the msg lists the joints in reverse order, plus a joint which is not in the model
+    sensor_msgs::JointStatePtr msg(new sensor_msgs::JointState());
+    yarp::sig::Vector dq(this->q.size(), 0.0);
+    yarp::sig::Vector tau(this->q.size(), 0.0);
+    for(int i = this->getJointNames().size() - 1; i >= 0; --i) {
+        msg->name.push_back(this->getJointNames()[i]);
+        msg->position.push_back(this->q[i]);
+        dq[i] = 0.01*i;
+        msg->velocity.push_back(dq[i]);
+        tau[i] = 0.1*i;
+        msg->effort.push_back(tau[i]);
+    }
+    msg->name.push_back("not_a_joint");
+    msg->position.push_back(1.0);
+    msg->velocity.push_back(1.0);
+    msg->effort.push_back(1.0);
+
+    yarp::sig::Vector q_msg = this->fromJointStateMsgToiDyn(msg);
+    EXPECT_TRUE(q_msg == this->q);
+
+    Eigen::VectorXd q_eigen = Eigen::VectorXd::Zero(this->q.size());
+    Eigen::VectorXd dq_eigen = Eigen::VectorXd::Zero(this->q.size());
+    Eigen::VectorXd tau_eigen = Eigen::VectorXd::Zero(this->q.size());
+    this->fromJointStateMsgToiDyn(msg, q_eigen, dq_eigen, tau_eigen);
+    EXPECT_TRUE(q_eigen == cartesian_utils::toEigen(this->q));
+    EXPECT_TRUE(dq_eigen == cartesian_utils::toEigen(dq));
+    EXPECT_TRUE(tau_eigen == cartesian_utils::toEigen(tau));
+
+    this->updateiDyn3ModelFromJoinStateMsg(msg);
+    EXPECT_TRUE(this->iDyn3_model.getAng() == this->q);
+    EXPECT_TRUE(this->iDyn3_model.getDAng() == dq);
+
+    // with an unchanged msg layout iDynUtils does not allocate on top of iDynTree
+    yarp::sig::Vector ddq(this->q.size(), 0.0);
+    allocation_counter::start();
+    this->updateiDyn3Model(this->q, dq, ddq, true);
+    unsigned int update_allocations = allocation_counter::stop();
+
+    allocation_counter::start();
+    this->updateiDyn3ModelFromJoinStateMsg(msg);
+    unsigned int msg_allocations = allocation_counter::stop();
+    EXPECT_EQ(msg_allocations, update_allocations);
+
+    // a new layout is handled as well
+    std::swap(msg->name[0], msg->name[1]);
+    std::swap(msg->position[0], msg->position[1]);
+    this->updateiDyn3ModelFromJoinStateMsg(msg);
+    EXPECT_TRUE(this->iDyn3_model.getAng() == this->q);
+
+    // the layout is checked on the number of joints and on the first and last name
+    msg->name.pop_back();
+    msg->position.pop_back();
+    msg->velocity.pop_back();
+    msg->effort.pop_back();
+    this->updateiDyn3ModelFromJoinStateMsg(msg);
+    EXPECT_TRUE(this->iDyn3_model.getAng() == this->q);
+
+    const unsigned int last = msg->name.size() - 1;
+    std::swap(msg->name[last-1], msg->name[last]);
+    std::swap(msg->position[last-1], msg->position[last]);
+    this->updateiDyn3ModelFromJoinStateMsg(msg);
+    EXPECT_TRUE(this->iDyn3_model.getAng() == this->q);
+}
+
+TEST_F(testIDynUtils, testUpdateRobotState)
+{
+    yarp::sig::Vector q_random(this->q.size(), 0.0);
+    for(unsigned int i = 0; i < q_random.size(); ++i)
+        q_random[i] = 0.5*(drand48() - 0.5);
+
+    this->updateiDyn3Model(q_random, true);
+
+    // the MoveIt variables without an iDynTree DOF (but the root joint ones) keep their value
+    this->initPlanningScene();
+    robot_state::RobotState& current_state = this->moveit_planning_scene->getCurrentStateNonConst();
+    const std::vector<std::string>& root_variables = this->moveit_robot_model->getRootJoint()->getVariableNames();
+    std::vector<std::string> other_variables;
+    for(unsigned int i = 0; i < this->moveit_robot_model->getVariableCount(); ++i) {
+        const std::string& variable = this->moveit_robot_model->getVariableNames()[i];
+        if(this->iDyn3_model.getDOFIndex(variable) == -1 &&
+           std::find(root_variables.begin(), root_variables.end(), variable) == root_variables.end()) {
+            current_state.setVariablePosition(variable, 0.1);
+            other_variables.push_back(variable);
+        }
+    }
+
+    this->updateRobotState(q_random);
+
+    const robot_state::RobotState& state = this->moveit_planning_scene->getCurrentState();
+    for(unsigned int i = 0; i < other_variables.size(); ++i)
+        EXPECT_DOUBLE_EQ(state.getVariablePosition(other_variables[i]), 0.1) << other_variables[i];
+    for(unsigned int i = 0; i < this->getJointNames().size(); ++i)
+        EXPECT_DOUBLE_EQ(state.getVariablePosition(this->getJointNames()[i]),
+                         q_random[this->iDyn3_model.getDOFIndex(this->getJointNames()[i])])
+            << this->getJointNames()[i];
+
+    // the MoveIt state is consistent with the iDynTree model
+    Eigen::Affine3d base_T_wrist = state.getFrameTransform(this->getBaseLink()).inverse() *
+                                   state.getFrameTransform("l_wrist");
+    KDL::Frame base_T_wrist_idyntree = this->getPose(this->getBaseLink(), "l_wrist");
+    for(unsigned int i = 0; i < 3; ++i)
+        EXPECT_NEAR(base_T_wrist.translation()[i], base_T_wrist_idyntree.p[i], 1e-9);
+}
+
+TEST_F(testIDynUtils, testLazyPlanningScene)
+{
+    iDynUtils lazy_model("coman",
+                         std::string(IDYNUTILS_TESTS_ROBOTS_DIR)+"coman/coman.urdf",
+                         std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.srdf",
+                         "", true);
+    EXPECT_TRUE(this->isPlanningSceneInited());
+    EXPECT_FALSE(lazy_model.isPlanningSceneInited());
+    EXPECT_FALSE(lazy_model.moveit_planning_scene);
+    EXPECT_FALSE(lazy_model.moveit_collision_robot);
+
+    // kinematics and dynamics do not need the planning scene
+    EXPECT_EQ(lazy_model.getJointNames(), this->getJointNames());
+    yarp::sig::Vector q_random(this->q.size(), 0.0);
+    for(unsigned int i = 0; i < q_random.size(); ++i)
+        q_random[i] = 0.5*(drand48() - 0.5);
+    lazy_model.updateiDyn3Model(q_random, true);
+    this->updateiDyn3Model(q_random, true);
+    EXPECT_TRUE(KDL::Equal(lazy_model.getPose("l_wrist"), this->getPose("l_wrist")));
+
+    // copies of a lazy model are lazy as well
+    boost::shared_ptr<iDynUtils> lazy_clone = lazy_model.clone();
+    EXPECT_FALSE(lazy_clone->isPlanningSceneInited());
+    EXPECT_FALSE(lazy_model.isPlanningSceneInited());
+
+    // the first collision check builds the scene
+    EXPECT_EQ(lazy_model.checkSelfCollisionAt(q_random), this->checkSelfCollisionAt(q_random));
+    EXPECT_TRUE(lazy_model.isPlanningSceneInited());
+    EXPECT_TRUE(lazy_model.moveit_collision_robot);
+    EXPECT_FALSE(lazy_clone->isPlanningSceneInited());
+
+    const robot_state::RobotState& state = lazy_model.moveit_planning_scene->getCurrentState();
+    for(unsigned int i = 0; i < this->getJointNames().size(); ++i)
+        EXPECT_DOUBLE_EQ(state.getVariablePosition(this->getJointNames()[i]),
+                         q_random[this->iDyn3_model.getDOFIndex(this->getJointNames()[i])])
+            << this->getJointNames()[i];
+
+    lazy_clone->initPlanningScene();
+    EXPECT_TRUE(lazy_clone->isPlanningSceneInited());
+    EXPECT_FALSE(lazy_clone->moveit_planning_scene == lazy_model.moveit_planning_scene);
+}
+
+TEST_F(testIDynUtils, testDOFNames)
+{
+    ASSERT_EQ(this->getDOFNames().size(), (unsigned int)this->iDyn3_model.getNrOfDOFs());
+    for(unsigned int i = 0; i < this->getDOFNames().size(); ++i)
+        EXPECT_EQ(this->iDyn3_model.getDOFIndex(this->getDOFNames()[i]), (int)i);
+
+    // the same joints as getJointNames(), possibly in a different order
+    std::vector<std::string> joint_names = this->getJointNames();
+    std::vector<std::string> dof_names = this->getDOFNames();
+    std::sort(joint_names.begin(), joint_names.end());
+    std::sort(dof_names.begin(), dof_names.end());
+    EXPECT_TRUE(joint_names == dof_names);
+}
+
+TEST_F(testIDynUtils, testCloneWithoutPlanningScene)
+{
+    ASSERT_TRUE(this->isPlanningSceneInited());
+    boost::shared_ptr<iDynUtils> clone = this->clone(false);
+    EXPECT_FALSE(clone->isPlanningSceneInited());
+
+    yarp::sig::Vector q_random(this->q.size(), 0.0);
+    for(unsigned int i = 0; i < q_random.size(); ++i)
+        q_random[i] = 0.5*(drand48() - 0.5);
+    clone->updateiDyn3Model(q_random, true);
+    this->updateiDyn3Model(q_random, true);
+    EXPECT_TRUE(KDL::Equal(clone->getPose("l_wrist"), this->getPose("l_wrist")));
+
+    // the scene gets built when needed
+    EXPECT_EQ(clone->checkSelfCollisionAt(q_random), this->checkSelfCollisionAt(q_random));
+    EXPECT_TRUE(clone->isPlanningSceneInited());
+}
+
 TEST_F(testIDynUtils, testUpdateIdyn3ModelFT)
 {
     yarp::sig::Vector q(this->iDyn3_model.getNrOfDOFs(), 0.0);
@@ -648,6 +1166,50 @@ TEST_F(testIDynUtils, testUpdateIdyn3ModelFT)
 
 }
 
+TEST_F(testIDynUtils, testUpdateIdyn3ModelFTLazy)
+{
+    yarp::sig::Vector q(this->iDyn3_model.getNrOfDOFs(), 0.0);
+    yarp::sig::Vector dq(q);
+    yarp::sig::Vector ddq(q);
+
+    std::vector<std::string> ft_reference_frames;
+    ft_reference_frames.push_back("r_arm_ft");
+    ft_reference_frames.push_back("l_arm_ft");
+    ft_reference_frames.push_back("r_leg_ft");
+    ft_reference_frames.push_back("l_leg_ft");
+
+    std::vector<iDynUtils::ft_measure> ft_measurements;
+    for(unsigned int i = 0; i < ft_reference_frames.size(); ++i){
+        iDynUtils::ft_measure ft_measurement;
+        ft_measurement.first = ft_reference_frames[i];
+        ft_measurement.second.resize(6, 0.0);
+        for(unsigned int j = 0; j < 6; ++j)
+            ft_measurement.second[j] = (i+1.0)*(j+1.0);
+        ft_measurements.push_back(ft_measurement);
+    }
+
+    this->enableLazyUpdate();
+    this->updateiDyn3Model(q, dq, ddq, ft_measurements, true);
+
+    /// The deferred dynamicRNEA() must not overwrite the FT measurements
+    Eigen::VectorXd tau = this->getTorques();
+    EXPECT_EQ(tau.size(), (int)this->iDyn3_model.getNrOfDOFs());
+
+    for(unsigned int i = 0; i < ft_measurements.size(); ++i)
+    {
+        const moveit::core::LinkModel* ft_link = moveit_robot_model->getLinkModel(ft_reference_frames[i]);
+        int ft_index = iDyn3_model.getFTSensorIndex(ft_link->getParentJointModel()->getName());
+
+        yarp::sig::Vector ft(6, 0.0);
+        EXPECT_TRUE(this->iDyn3_model.getSensorMeasurement(ft_index, ft));
+
+        for(unsigned int j = 0; j < 6; ++j)
+            EXPECT_DOUBLE_EQ(ft_measurements[i].second[j], ft[j]);
+    }
+
+    this->disableLazyUpdate();
+}
+
 TEST_F(testIDynUtils, testCheckSelfCollision)
 {
     std::string urdf_file = std::string(IDYNUTILS_TESTS_ROBOTS_DIR)+"coman/coman.urdf";
@@ -1150,6 +1712,164 @@ TEST_F(testIDynUtils, testWhyAnchorIsCoherent)
     EXPECT_FALSE(anchor_before_update == anchor_after_update);
 }
 
+TEST_F(testIDynUtils, testJointStateSetThroughiDynTree)
+{
+    setGoodInitialPosition();
+    boost::shared_ptr<iDynUtils> reference = this->clone();
+    const unsigned int n = this->iDyn3_model.getNrOfDOFs();
+
+    // the joint state is set bypassing iDynUtils
+    yarp::sig::Vector dq(n, 0.1);
+    q[left_leg.joint_numbers[3]] += 0.2;
+    this->iDyn3_model.setAng(q);
+    this->iDyn3_model.setDAng(dq);
+    reference->updateiDyn3Model(q, dq, false);
+
+    Eigen::VectorXd q_out(n), dq_out(n);
+    this->getAng(q_out);
+    this->getDAng(dq_out);
+    EXPECT_TRUE(q_out == this->getAng());
+    EXPECT_TRUE(q_out == cartesian_utils::toEigen(q));
+    EXPECT_TRUE(dq_out == cartesian_utils::toEigen(dq));
+
+    Eigen::MatrixXd A(6, 6 + n), A_reference(6, 6 + n);
+    Eigen::VectorXd dA_dq(6), dA_dq_reference(6);
+    ASSERT_TRUE(this->getCentroidalMomentumMatrix(A, dA_dq));
+    ASSERT_TRUE(reference->getCentroidalMomentumMatrix(A_reference, dA_dq_reference));
+    EXPECT_TRUE(A.isApprox(A_reference, 1e-12));
+    EXPECT_TRUE(dA_dq.isApprox(dA_dq_reference, 1e-12));
+
+    Eigen::MatrixXd M(6 + n, 6 + n), M_reference(6 + n, 6 + n);
+    ASSERT_TRUE(this->getMassMatrix(M));
+    ASSERT_TRUE(reference->getMassMatrix(M_reference));
+    EXPECT_TRUE(M.isApprox(M_reference, 1e-12));
+}
+
+TEST_F(testIDynUtils, testAnchorCandidates)
+{
+    setGoodInitialPosition();
+    // the reference switches anchor computing the kinematics every time
+    boost::shared_ptr<iDynUtils> reference = this->clone();
+
+    std::vector<std::string> candidates;
+    candidates.push_back(left_leg.end_effector_name);
+    candidates.push_back(right_leg.end_effector_name);
+    EXPECT_FALSE(setAnchorCandidates(std::vector<std::string>(1, "not_a_link")));
+    ASSERT_TRUE(setAnchorCandidates(candidates));
+
+    // walking: the legs move, then the anchor switches to the other sole
+    for(unsigned int step = 0; step < 6; ++step)
+    {
+        q[left_leg.joint_numbers[0]] += 0.05;
+        q[right_leg.joint_numbers[3]] -= 0.05;
+        updateiDyn3Model(q, true);
+        reference->updateiDyn3Model(q, true);
+
+        const std::string& new_anchor = candidates[(step + 1) % 2];
+        if(step < 3) {
+            ASSERT_TRUE(switchAnchor(new_anchor));
+            ASSERT_TRUE(reference->switchAnchor(new_anchor));
+        } else {
+            ASSERT_TRUE(switchAnchorAndFloatingBase(new_anchor));
+            ASSERT_TRUE(reference->switchAnchorAndFloatingBase(new_anchor));
+        }
+
+        EXPECT_EQ(getAnchor(), new_anchor);
+        EXPECT_TRUE(getAnchor_T_World() == reference->getAnchor_T_World());
+        EXPECT_TRUE(iDyn3_model.getWorldBasePoseKDL() == reference->iDyn3_model.getWorldBasePoseKDL());
+        EXPECT_TRUE(iDyn3_model.getPositionKDL(left_arm.index) ==
+                    reference->iDyn3_model.getPositionKDL(left_arm.index));
+    }
+
+    // without updating the world pose the cache is out of date, and it is not used
+    q[right_leg.joint_numbers[3]] += 0.1;
+    updateiDyn3Model(q);
+    reference->updateiDyn3Model(q);
+    ASSERT_TRUE(switchAnchor(candidates[0]));
+    ASSERT_TRUE(reference->switchAnchor(candidates[0]));
+    EXPECT_TRUE(getAnchor_T_World() == reference->getAnchor_T_World());
+    EXPECT_TRUE(iDyn3_model.getWorldBasePoseKDL() == reference->iDyn3_model.getWorldBasePoseKDL());
+}
+
+TEST_F(testIDynUtils, testRealTimeMode)
+{
+    setGoodInitialPosition();
+    EXPECT_FALSE(isRealTimeModeEnabled());
+
+    const Eigen::VectorXd q_min = getJointBoundMin();
+    const Eigen::VectorXd q_max = getJointBoundMax();
+    const Eigen::VectorXd tau_max = getJointTorqueMax();
+    const unsigned int n = q.size();
+
+    warmup();
+    ASSERT_TRUE(isRealTimeModeEnabled());
+
+    // queries answered from the state of iDynUtils do not allocate
+    Eigen::VectorXd q_out(n), dq_out(n), bound_min(n), bound_max(n), tau_max_out(n);
+    allocation_counter::start();
+    getAng(q_out);
+    getDAng(dq_out);
+    getJointBoundMin(bound_min);
+    getJointBoundMax(bound_max);
+    getJointTorqueMax(tau_max_out);
+    unsigned int query_allocations = allocation_counter::stop();
+
+    EXPECT_EQ(query_allocations, 0u);
+    EXPECT_TRUE(q_out == cartesian_utils::toEigen(q));
+    EXPECT_TRUE(dq_out.isZero());
+    EXPECT_TRUE(bound_min == q_min);
+    EXPECT_TRUE(bound_max == q_max);
+    EXPECT_TRUE(tau_max_out == tau_max);
+
+    // the update does not allocate on top of iDynTree
+    Eigen::VectorXd q_eigen = cartesian_utils::toEigen(q);
+    q_eigen[left_leg.joint_numbers[3]] += 0.1;
+    Eigen::VectorXd dq = Eigen::VectorXd::Constant(n, 0.1);
+    Eigen::VectorXd ddq = Eigen::VectorXd::Constant(n, 0.2);
+    yarp::sig::Vector q_yarp = cartesian_utils::fromEigentoYarp(q_eigen);
+    yarp::sig::Vector dq_yarp = cartesian_utils::fromEigentoYarp(dq);
+    yarp::sig::Vector ddq_yarp = cartesian_utils::fromEigentoYarp(ddq);
+    yarp::sig::Vector o(3, 0.0);
+    yarp::sig::Vector g(this->g);
+
+    allocation_counter::start();
+    this->iDyn3_model.setAng(q_yarp);
+    this->iDyn3_model.setDAng(dq_yarp);
+    this->iDyn3_model.setD2Ang(ddq_yarp);
+    this->iDyn3_model.getPositionKDL(0, this->iDyn3_model.getFloatingBaseLink());
+    this->iDyn3_model.setInertialMeasure(o, o, g);
+    this->iDyn3_model.kinematicRNEA();
+    this->iDyn3_model.dynamicRNEA();
+    this->iDyn3_model.computePositions();
+    unsigned int idyntree_allocations = allocation_counter::stop();
+
+    allocation_counter::start();
+    updateiDyn3Model(q_eigen, dq, ddq);
+    getAng(q_out);
+    getDAng(dq_out);
+    unsigned int idynutils_allocations = allocation_counter::stop();
+
+    EXPECT_LE(idynutils_allocations, idyntree_allocations);
+    EXPECT_TRUE(q_out == q_eigen);
+    EXPECT_TRUE(dq_out == dq);
+
+    // errors are queued instead of being printed
+    std::stringstream printed;
+    std::streambuf* cerr_buffer = std::cerr.rdbuf(printed.rdbuf());
+    std::list<KDL::Vector> points;
+    bool found = getSupportPolygonPoints(points, "not_a_link");
+    std::cerr.rdbuf(cerr_buffer);
+
+    EXPECT_FALSE(found);
+    EXPECT_TRUE(printed.str().empty());
+    idynutils::rt_error_ring::error e;
+    EXPECT_TRUE(getRealTimeErrors().pop(e));
+    EXPECT_FALSE(getRealTimeErrors().pop(e));
+
+    disableRealTimeMode();
+    EXPECT_FALSE(isRealTimeModeEnabled());
+}
+
 TEST_P(testIDynUtilsWithAndWithoutUpdateAndDifferentSwitchTypes, testAnchorSwitchWGetPosition)
 {
     bool updateIDynAfterSwitch = GetParam().first;
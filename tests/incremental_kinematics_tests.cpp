@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <idynutils/incremental_kinematics.h>
+#include <idynutils/idynutils.h>
+#include <idynutils/cartesian_utils.h>
+#include <yarp/os/Time.h>
+
+namespace{
+
+class testIncrementalKinematics: public ::testing::Test
+{
+protected:
+    testIncrementalKinematics() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testIncrementalKinematics() {
+
+    }
+
+    virtual void SetUp() {
+
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    void expectSamePose(const KDL::Frame& a, const KDL::Frame& b)
+    {
+        Eigen::Matrix4d A, B;
+        cartesian_utils::fromKDLFrameToEigenMatrix(a, A);
+        cartesian_utils::fromKDLFrameToEigenMatrix(b, B);
+        EXPECT_TRUE(A.isApprox(B, 1e-9)) << A << std::endl << " vs " << std::endl << B;
+    }
+
+    iDynUtils bigman;
+};
+
+TEST_F(testIncrementalKinematics, testPosesMatchIDynTree)
+{
+    idynutils::incremental_kinematics fk(bigman);
+
+    const unsigned int nJ = bigman.iDyn3_model.getNrOfDOFs();
+    for(unsigned int k = 0; k < 5; ++k)
+    {
+        Eigen::VectorXd q = Eigen::VectorXd::Random(nJ);
+        bigman.updateiDyn3Model(q);
+        fk.setJointPositions(q);
+
+        const char* links[] = {"l_wrist", "r_wrist", "l_sole", "r_sole", "Waist"};
+        for(unsigned int i = 0; i < sizeof(links)/sizeof(links[0]); ++i)
+        {
+            int link = fk.getLinkIndex(links[i]);
+            ASSERT_NE(link, -1) << links[i];
+            expectSamePose(fk.getPose(link), bigman.getPose(links[i]));
+        }
+
+        expectSamePose(fk.getPose(fk.getLinkIndex("l_sole"), fk.getLinkIndex("r_wrist")),
+                       bigman.getPose("l_sole", "r_wrist"));
+    }
+}
+
+TEST_F(testIncrementalKinematics, testOnlyChangedChainIsUpdated)
+{
+    idynutils::incremental_kinematics fk(bigman);
+    const unsigned int nJ = bigman.iDyn3_model.getNrOfDOFs();
+    const int r_hand = fk.getLinkIndex(bigman.right_arm.end_effector_name);
+    const int l_hand = fk.getLinkIndex(bigman.left_arm.end_effector_name);
+
+    Eigen::VectorXd q = Eigen::VectorXd::Random(nJ);
+    fk.setJointPositions(q);
+    fk.getPose(r_hand);
+    EXPECT_GT(fk.getNrOfUpdatedLinks(), 0u);
+
+    // nothing changed, nothing gets recomputed
+    fk.setJointPositions(q);
+    KDL::Frame l_hand_pose = fk.getPose(l_hand);
+    EXPECT_EQ(fk.getNrOfUpdatedLinks(), 0u);
+
+    Eigen::VectorXd q_right_arm = Eigen::VectorXd::Random(bigman.right_arm.getNrOfDOFs());
+    fk.setJointPositions(bigman.right_arm, q_right_arm);
+    KDL::Frame r_hand_pose = fk.getPose(r_hand);
+    EXPECT_GT(fk.getNrOfUpdatedLinks(), 0u);
+    EXPECT_LT(fk.getNrOfUpdatedLinks(), fk.getTree().getNrOfSegments()/2);
+    EXPECT_TRUE(KDL::Equal(fk.getPose(l_hand), l_hand_pose));
+
+    for(unsigned int i = 0; i < bigman.right_arm.joint_numbers.size(); ++i)
+        q[bigman.right_arm.joint_numbers[i]] = q_right_arm[i];
+    bigman.updateiDyn3Model(q);
+    expectSamePose(r_hand_pose, bigman.getPose(bigman.right_arm.end_effector_name));
+    expectSamePose(l_hand_pose, bigman.getPose(bigman.left_arm.end_effector_name));
+}
+
+TEST_F(testIncrementalKinematics, testJacobian)
+{
+    idynutils::incremental_kinematics fk(bigman);
+    const unsigned int nJ = bigman.iDyn3_model.getNrOfDOFs();
+
+    Eigen::VectorXd q = Eigen::VectorXd::Random(nJ);
+    bigman.updateiDyn3Model(q);
+    fk.setJointPositions(q);
+
+    Eigen::MatrixXd J_full(6, nJ + 6);
+    Eigen::MatrixXd J(6, nJ);
+    ASSERT_TRUE(bigman.getJacobian(bigman.right_arm.end_effector_index, J_full));
+    fk.getJacobian(fk.getLinkIndex(bigman.right_arm.end_effector_name), J);
+
+    EXPECT_TRUE(J.isApprox(J_full.rightCols(nJ), 1e-9)) << J << std::endl << " vs " << std::endl << J_full;
+}
+
+TEST_F(testIncrementalKinematics, testArmIKIterationTime)
+{
+    idynutils::incremental_kinematics fk(bigman);
+    const unsigned int nJ = bigman.iDyn3_model.getNrOfDOFs();
+    const unsigned int iterations = 1000;
+    const int r_hand = fk.getLinkIndex(bigman.right_arm.end_effector_name);
+
+    Eigen::VectorXd q = Eigen::VectorXd::Zero(nJ);
+    Eigen::VectorXd q_right_arm = Eigen::VectorXd::Zero(bigman.right_arm.getNrOfDOFs());
+
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i)
+    {
+        q_right_arm.setConstant(i*1e-3);
+        for(unsigned int j = 0; j < bigman.right_arm.joint_numbers.size(); ++j)
+            q[bigman.right_arm.joint_numbers[j]] = q_right_arm[j];
+        bigman.updateiDyn3Model(q);
+        bigman.getPose(bigman.right_arm.end_effector_name);
+    }
+    double full_time = yarp::os::Time::now() - t;
+
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i)
+    {
+        q_right_arm.setConstant(i*1e-3);
+        fk.setJointPositions(bigman.right_arm, q_right_arm);
+        fk.getPose(r_hand);
+    }
+    double incremental_time = yarp::os::Time::now() - t;
+
+    std::cout << "right arm FK, full update: " << full_time/iterations << " [s], "
+              << "incremental: " << incremental_time/iterations << " [s]" << std::endl;
+
+    expectSamePose(fk.getPose(r_hand), bigman.getPose(bigman.right_arm.end_effector_name));
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include <idynutils/idynutils.h>
+#include <idynutils/model_cache.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace{
+
+class testModelCache: public ::testing::Test
+{
+protected:
+    testModelCache() :
+        urdf_file(std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.urdf"),
+        srdf_file(std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.srdf"),
+        cache_file(std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.idyncache")
+    {
+
+    }
+
+    virtual ~testModelCache() {
+
+    }
+
+    virtual void SetUp() {
+        std::remove(cache_file.c_str());
+    }
+
+    virtual void TearDown() {
+        std::remove(cache_file.c_str());
+    }
+
+    void expectSameChain(const kinematic_chain& a, const kinematic_chain& b)
+    {
+        EXPECT_EQ(a.chain_name, b.chain_name);
+        EXPECT_EQ(a.end_effector_name, b.end_effector_name);
+        EXPECT_EQ(a.end_effector_index, b.end_effector_index);
+        EXPECT_TRUE(a.joint_names == b.joint_names);
+        EXPECT_TRUE(a.fixed_joint_names == b.fixed_joint_names);
+        EXPECT_TRUE(a.joint_numbers == b.joint_numbers);
+    }
+
+    std::string urdf_file;
+    std::string srdf_file;
+    std::string cache_file;
+};
+
+TEST_F(testModelCache, testHash)
+{
+    uint64_t hash_a, hash_b;
+    EXPECT_TRUE(idynutils::model_cache::computeHash(urdf_file, srdf_file, hash_a));
+    EXPECT_TRUE(idynutils::model_cache::computeHash(urdf_file, srdf_file, hash_b));
+    EXPECT_EQ(hash_a, hash_b);
+
+    // swapping the files gives a different hash
+    EXPECT_TRUE(idynutils::model_cache::computeHash(srdf_file, urdf_file, hash_b));
+    EXPECT_NE(hash_a, hash_b);
+
+    EXPECT_FALSE(idynutils::model_cache::computeHash(urdf_file + ".missing", srdf_file, hash_b));
+}
+
+TEST_F(testModelCache, testSaveAndLoad)
+{
+    idynutils::model_cache cache;
+    cache.hash = 42;
+    cache.joint_names.push_back("a");
+    cache.joint_names.push_back("b");
+    cache.fixed_joint_names.push_back("c");
+    cache.chains.resize(1);
+    cache.chains[0].chain_name = "chain";
+    cache.chains[0].end_effector_name = "ee";
+    cache.chains[0].joint_names = cache.joint_names;
+    cache.chains[0].joint_numbers.push_back(0);
+    cache.chains[0].joint_numbers.push_back(1);
+    cache.base_link_name = "base";
+    cache.imu_link_idyntree = "imu";
+    cache.joint_bound_min.assign(2, -1.0);
+    cache.joint_bound_max.assign(2, 1.0);
+    cache.joint_torque_max.assign(2, 10.0);
+    ASSERT_TRUE(cache.save(cache_file));
+
+    idynutils::model_cache loaded;
+    ASSERT_TRUE(loaded.load(cache_file, 42));
+    EXPECT_TRUE(loaded.joint_names == cache.joint_names);
+    EXPECT_TRUE(loaded.fixed_joint_names == cache.fixed_joint_names);
+    ASSERT_EQ(loaded.chains.size(), 1u);
+    EXPECT_EQ(loaded.chains[0].chain_name, "chain");
+    EXPECT_EQ(loaded.chains[0].end_effector_name, "ee");
+    EXPECT_TRUE(loaded.chains[0].joint_numbers == cache.chains[0].joint_numbers);
+    EXPECT_EQ(loaded.base_link_name, "base");
+    EXPECT_EQ(loaded.imu_link_idyntree, "imu");
+    EXPECT_TRUE(loaded.joint_bound_min == cache.joint_bound_min);
+    EXPECT_TRUE(loaded.joint_bound_max == cache.joint_bound_max);
+    EXPECT_TRUE(loaded.joint_torque_max == cache.joint_torque_max);
+
+    // a cache built from different robot description files is rejected
+    EXPECT_FALSE(loaded.load(cache_file, 43));
+
+    // a truncated cache is rejected
+    std::ifstream in(cache_file.c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out(cache_file.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(content.data(), content.size() - 5);
+    out.close();
+    EXPECT_FALSE(loaded.load(cache_file, 42));
+}
+
+TEST_F(testModelCache, testCachedConstruction)
+{
+    // construction times are reported by idynutils_benchmarks
+    iDynUtils cold("coman", urdf_file, srdf_file);
+    EXPECT_FALSE(cold.isModelLoadedFromCache());
+
+    // the first construction with a cache path writes the cache...
+    iDynUtils writer("coman", urdf_file, srdf_file, cache_file);
+    EXPECT_FALSE(writer.isModelLoadedFromCache());
+
+    // ...which is used by the following ones
+    iDynUtils cached("coman", urdf_file, srdf_file, cache_file);
+    EXPECT_TRUE(cached.isModelLoadedFromCache());
+
+    EXPECT_TRUE(cold.getJointNames() == cached.getJointNames());
+    EXPECT_TRUE(cold.getFixedJointNames() == cached.getFixedJointNames());
+    EXPECT_TRUE(cold.getForceTorqueFrameNames() == cached.getForceTorqueFrameNames());
+    EXPECT_TRUE(cold.getIMUFrameNames() == cached.getIMUFrameNames());
+    EXPECT_EQ(cold.getBaseLink(), cached.getBaseLink());
+    EXPECT_EQ(cold.getAnchor(), cached.getAnchor());
+
+    expectSameChain(cold.left_leg, cached.left_leg);
+    expectSameChain(cold.left_arm, cached.left_arm);
+    expectSameChain(cold.right_leg, cached.right_leg);
+    expectSameChain(cold.right_arm, cached.right_arm);
+    expectSameChain(cold.torso, cached.torso);
+    expectSameChain(cold.head, cached.head);
+
+    EXPECT_TRUE(cold.iDyn3_model.getJointBoundMin() == cached.iDyn3_model.getJointBoundMin());
+    EXPECT_TRUE(cold.iDyn3_model.getJointBoundMax() == cached.iDyn3_model.getJointBoundMax());
+    EXPECT_TRUE(cold.iDyn3_model.getJointTorqueMax() == cached.iDyn3_model.getJointTorqueMax());
+
+    yarp::sig::Vector q(cold.iDyn3_model.getNrOfDOFs(), 0.1);
+    cold.updateiDyn3Model(q, true);
+    cached.updateiDyn3Model(q, true);
+    EXPECT_TRUE(KDL::Equal(cold.getPose("r_wrist"), cached.getPose("r_wrist")));
+}
+
+TEST_F(testModelCache, testCorruptedCacheIsIgnored)
+{
+    std::ofstream out(cache_file.c_str(), std::ios::binary | std::ios::trunc);
+    out << "not a model cache";
+    out.close();
+
+    iDynUtils robot("coman", urdf_file, srdf_file, cache_file);
+    EXPECT_FALSE(robot.isModelLoadedFromCache());
+    EXPECT_FALSE(robot.getJointNames().empty());
+
+    // the corrupted cache has been replaced by a valid one
+    iDynUtils cached("coman", urdf_file, srdf_file, cache_file);
+    EXPECT_TRUE(cached.isModelLoadedFromCache());
+    EXPECT_TRUE(robot.getJointNames() == cached.getJointNames());
+}
+
+TEST_F(testModelCache, testInconsistentCacheIsIgnored)
+{
+    iDynUtils cold("coman", urdf_file, srdf_file);
+    {
+        iDynUtils writer("coman", urdf_file, srdf_file, cache_file);
+    }
+
+    // a cache with the right hash, but whose content does not match the model
+    uint64_t hash;
+    ASSERT_TRUE(idynutils::model_cache::computeHash(urdf_file, srdf_file, hash));
+    idynutils::model_cache cache;
+    ASSERT_TRUE(cache.load(cache_file, hash));
+    std::reverse(cache.joint_names.begin(), cache.joint_names.end());
+    cache.base_link_name = cold.left_leg.end_effector_name;
+    cache.ft_sensor_joint_names.clear();
+    cache.imu_link_idyntree = cold.left_leg.end_effector_name;
+    ASSERT_TRUE(cache.save(cache_file));
+
+    // names resolved from the srdf do not come from the rejected cache
+    iDynUtils robot("coman", urdf_file, srdf_file, cache_file);
+    EXPECT_FALSE(robot.isModelLoadedFromCache());
+    EXPECT_EQ(cold.getBaseLink(), robot.getBaseLink());
+    EXPECT_TRUE(cold.getJointNames() == robot.getJointNames());
+    EXPECT_TRUE(cold.getForceTorqueFrameNames() == robot.getForceTorqueFrameNames());
+    EXPECT_TRUE(cold.getIMUFrameNames() == robot.getIMUFrameNames());
+    EXPECT_EQ(cold.iDyn3_model.getNrOfFTSensors(), robot.iDyn3_model.getNrOfFTSensors());
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <idynutils/operational_space.h>
+#include <idynutils/idynutils.h>
+#include <yarp/os/Time.h>
+
+namespace{
+
+class testOperationalSpace: public ::testing::Test
+{
+protected:
+    testOperationalSpace() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testOperationalSpace() {
+
+    }
+
+    virtual void SetUp() {
+        nJ = bigman.iDyn3_model.getNrOfDOFs();
+        q = Eigen::VectorXd::Random(nJ);
+        bigman.updateiDyn3Model(q, true);
+        M.resize(nJ+6, nJ+6);
+        ASSERT_TRUE(bigman.getFloatingBaseMassMatrix(M));
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    Eigen::MatrixXd getJacobian(const std::string& link) {
+        Eigen::MatrixXd J(6, nJ+6);
+        bigman.getJacobian(bigman.getLinkHandle(link), J);
+        return J;
+    }
+
+    iDynUtils bigman;
+    unsigned int nJ;
+    Eigen::VectorXd q;
+    Eigen::MatrixXd M;
+};
+
+TEST_F(testOperationalSpace, testSolve)
+{
+    idynutils::operational_space os(bigman);
+    ASSERT_TRUE(os.update(bigman));
+
+    Eigen::MatrixXd X = Eigen::MatrixXd::Random(nJ+6, 4);
+    Eigen::MatrixXd Minv_X = X;
+    os.solve(Minv_X);
+    EXPECT_TRUE(Minv_X.isApprox(M.ldlt().solve(X), 1e-9));
+
+    // S' S = M^-1
+    Eigen::MatrixXd S_X = X;
+    os.getFactorization().multiplyByInverseSqrt(S_X);
+    EXPECT_TRUE((S_X.transpose()*S_X).isApprox(X.transpose()*Minv_X, 1e-9));
+}
+
+TEST_F(testOperationalSpace, testTask)
+{
+    idynutils::operational_space os(bigman);
+    ASSERT_TRUE(os.update(bigman));
+
+    Eigen::MatrixXd J = getJacobian("l_sole");
+    Eigen::MatrixXd Lambda, Minv_JT, Jbar, N;
+    idynutils::operational_space::task t;
+    t.J = &J;
+    t.Lambda = &Lambda;
+    t.Minv_JT = &Minv_JT;
+    t.Jbar = &Jbar;
+    t.N = &N;
+    ASSERT_TRUE(os.compute(t));
+
+    Eigen::MatrixXd M_inverse = M.inverse();
+    Eigen::MatrixXd Lambda_dense = (J*M_inverse*J.transpose()).inverse();
+    EXPECT_TRUE(Lambda.isApprox(Lambda_dense, 1e-6));
+    EXPECT_TRUE(Minv_JT.isApprox(M_inverse*J.transpose(), 1e-6));
+    EXPECT_TRUE(Jbar.isApprox(M_inverse*J.transpose()*Lambda_dense, 1e-6));
+
+    // N projects away the task, and is dynamically consistent
+    EXPECT_NEAR((J*N).norm(), 0.0, 1e-6);
+    EXPECT_NEAR((N*Minv_JT).norm(), 0.0, 1e-6);
+    EXPECT_TRUE((N*N).isApprox(N, 1e-6));
+
+    // a task without full row rank
+    Eigen::MatrixXd J_singular(2, nJ+6);
+    J_singular << J.row(0), J.row(0);
+    t.J = &J_singular;
+    EXPECT_FALSE(os.compute(t));
+}
+
+TEST_F(testOperationalSpace, testBatch)
+{
+    idynutils::operational_space os(bigman);
+    ASSERT_TRUE(os.update(bigman));
+
+    Eigen::MatrixXd J_feet(12, nJ+6);
+    J_feet << getJacobian("l_sole"), getJacobian("r_sole");
+    Eigen::MatrixXd J_hand = getJacobian("LSoftHand").topRows(3);
+    Eigen::MatrixXd Lambda_feet, N_feet, Lambda_hand, Jbar_hand;
+
+    std::vector<idynutils::operational_space::task> tasks(2);
+    tasks[0].J = &J_feet;
+    tasks[0].Lambda = &Lambda_feet;
+    tasks[0].N = &N_feet;
+    tasks[1].J = &J_hand;
+    tasks[1].Lambda = &Lambda_hand;
+    tasks[1].Jbar = &Jbar_hand;
+    ASSERT_TRUE(os.compute(tasks));
+
+    Eigen::MatrixXd Lambda, N, Jbar;
+    idynutils::operational_space::task t;
+    t.J = &J_feet;
+    t.Lambda = &Lambda;
+    t.N = &N;
+    ASSERT_TRUE(os.compute(t));
+    EXPECT_TRUE(Lambda_feet.isApprox(Lambda, 1e-12));
+    EXPECT_TRUE(N_feet.isApprox(N, 1e-12));
+
+    t = idynutils::operational_space::task();
+    t.J = &J_hand;
+    t.Lambda = &Lambda;
+    t.Jbar = &Jbar;
+    ASSERT_TRUE(os.compute(t));
+    EXPECT_TRUE(Lambda_hand.isApprox(Lambda, 1e-12));
+    EXPECT_TRUE(Jbar_hand.isApprox(Jbar, 1e-12));
+}
+
+TEST_F(testOperationalSpace, testFloatingBaseSwitch)
+{
+    idynutils::operational_space os(bigman);
+    ASSERT_TRUE(os.update(bigman));
+
+    ASSERT_TRUE(bigman.setFloatingBaseLink("l_sole"));
+    bigman.updateiDyn3Model(q, true);
+    ASSERT_TRUE(bigman.getFloatingBaseMassMatrix(M));
+    ASSERT_TRUE(os.update(bigman));
+
+    Eigen::MatrixXd X = Eigen::MatrixXd::Random(nJ+6, 2);
+    Eigen::MatrixXd Minv_X = X;
+    os.solve(Minv_X);
+    EXPECT_TRUE(Minv_X.isApprox(M.ldlt().solve(X), 1e-9));
+}
+
+TEST_F(testOperationalSpace, testOperationalSpaceTime)
+{
+    idynutils::operational_space os(bigman);
+    std::vector<Eigen::MatrixXd> J(4), Lambda(4), N(4);
+    J[0] = getJacobian("l_sole");
+    J[1] = getJacobian("r_sole");
+    J[2] = getJacobian("LSoftHand");
+    J[3] = getJacobian("RSoftHand");
+    std::vector<idynutils::operational_space::task> tasks(4);
+    for(unsigned int i = 0; i < tasks.size(); ++i) {
+        tasks[i].J = &J[i];
+        tasks[i].Lambda = &Lambda[i];
+        tasks[i].N = &N[i];
+    }
+    const unsigned int iterations = 100;
+
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        os.update(bigman);
+        os.compute(tasks);
+    }
+    double factorized_time = yarp::os::Time::now() - t;
+
+    // dense inverses, as in the controllers
+    Eigen::MatrixXd I = Eigen::MatrixXd::Identity(nJ+6, nJ+6);
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        bigman.getFloatingBaseMassMatrix(M);
+        Eigen::MatrixXd M_inverse = M.inverse();
+        for(unsigned int j = 0; j < tasks.size(); ++j) {
+            Lambda[j] = (J[j]*M_inverse*J[j].transpose()).inverse();
+            N[j] = I - M_inverse*J[j].transpose()*Lambda[j]*J[j];
+        }
+    }
+    double dense_time = yarp::os::Time::now() - t;
+
+    std::cout << tasks.size() << " tasks, Lambda and N from the factorization: " << factorized_time/iterations
+              << " [s], from dense inverses: " << dense_time/iterations << " [s]" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <idynutils/rt_error_ring.h>
+#include <boost/thread.hpp>
+#include <sstream>
+
+#include "allocation_counter.h"
+
+namespace{
+
+class testRtErrorRing: public ::testing::Test
+{
+protected:
+    testRtErrorRing()
+    {
+
+    }
+
+    virtual ~testRtErrorRing() {
+
+    }
+
+    virtual void SetUp() {
+
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    idynutils::rt_error_ring errors;
+};
+
+TEST_F(testRtErrorRing, testPushPop)
+{
+    idynutils::rt_error_ring::error e;
+    EXPECT_FALSE(errors.pop(e));
+
+    EXPECT_TRUE(errors.push("first error", "left_arm"));
+    EXPECT_TRUE(errors.push("second error"));
+
+    ASSERT_TRUE(errors.pop(e));
+    EXPECT_STREQ(e.message, "first error");
+    EXPECT_STREQ(e.context, "left_arm");
+    ASSERT_TRUE(errors.pop(e));
+    EXPECT_STREQ(e.message, "second error");
+    EXPECT_TRUE(e.context == NULL);
+    EXPECT_FALSE(errors.pop(e));
+}
+
+TEST_F(testRtErrorRing, testOverflow)
+{
+    for(unsigned int i = 0; i < idynutils::rt_error_ring::CAPACITY; ++i)
+        EXPECT_TRUE(errors.push("error"));
+    EXPECT_FALSE(errors.push("dropped"));
+    EXPECT_FALSE(errors.push("dropped"));
+    EXPECT_EQ(errors.getNrOfDroppedErrors(), 2u);
+
+    std::stringstream out;
+    EXPECT_EQ(errors.print(out), idynutils::rt_error_ring::CAPACITY);
+    EXPECT_NE(out.str().find("2 more errors dropped"), std::string::npos);
+    EXPECT_EQ(errors.getNrOfDroppedErrors(), 0u);
+
+    // the indices wrap around the ring
+    EXPECT_TRUE(errors.push("after overflow", "torso"));
+    out.str("");
+    EXPECT_EQ(errors.print(out), 1u);
+    EXPECT_EQ(out.str(), "after overflow (torso)\n");
+}
+
+TEST_F(testRtErrorRing, testPushDoesNotAllocate)
+{
+    idynutils::rt_error_ring::error e;
+
+    allocation_counter::start();
+    for(unsigned int i = 0; i < 2*idynutils::rt_error_ring::CAPACITY; ++i)
+        errors.push("error", "right_leg");
+    while(errors.pop(e));
+    unsigned int allocations = allocation_counter::stop();
+
+    EXPECT_EQ(allocations, 0u);
+}
+
+void produce(idynutils::rt_error_ring* errors, const char* message, unsigned int n)
+{
+    for(unsigned int i = 0; i < n; ++i)
+        while(!errors->push(message))
+            boost::this_thread::yield();
+}
+
+TEST_F(testRtErrorRing, testProducerConsumer)
+{
+    const unsigned int n = 100000;
+    boost::thread producer(produce, &errors, "error", n);
+
+    unsigned int popped = 0;
+    idynutils::rt_error_ring::error e;
+    while(popped < n)
+    {
+        if(errors.pop(e)) {
+            ASSERT_STREQ(e.message, "error");
+            ++popped;
+        }
+    }
+    producer.join();
+
+    EXPECT_FALSE(errors.pop(e));
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <idynutils/simd_kinematics.h>
+#include <idynutils/idynutils.h>
+#include <idynutils/cartesian_utils.h>
+#include <yarp/os/Time.h>
+
+namespace{
+
+class testSIMDKinematics: public ::testing::Test
+{
+protected:
+    testSIMDKinematics() :
+        coman("coman",
+              std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.urdf",
+              std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.srdf"),
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testSIMDKinematics() {
+
+    }
+
+    virtual void SetUp() {
+
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    void checkPoses(iDynUtils& model, const std::vector<std::string>& links)
+    {
+        idynutils::simd_kinematics fk(model, links);
+
+        const unsigned int nJ = model.iDyn3_model.getNrOfDOFs();
+        ASSERT_EQ(fk.getNumberOfDOFs(), nJ);
+        ASSERT_EQ(fk.getPosesSize(), 16*links.size());
+
+        // not a multiple of the number of lanes, the last block is partial
+        const unsigned int N = 5*idynutils::simd_kinematics::getNrOfLanes() + 3;
+        Eigen::MatrixXd Q = Eigen::MatrixXd::Random(nJ, N);
+        Eigen::MatrixXd poses(fk.getPosesSize(), N);
+        ASSERT_TRUE(fk.evaluate(Q, poses.data()));
+
+        for(unsigned int k = 0; k < N; ++k)
+        {
+            model.updateiDyn3Model(Q.col(k));
+            for(unsigned int i = 0; i < links.size(); ++i)
+            {
+                Eigen::Matrix4d pose;
+                cartesian_utils::fromKDLFrameToEigenMatrix(model.getPose(links[i]), pose);
+                Eigen::Map<const Eigen::Matrix4d> simd_pose(poses.col(k).data() + 16*i);
+                EXPECT_TRUE(simd_pose.isApprox(pose, 1e-9)) << links[i] << std::endl
+                                                            << simd_pose << std::endl << " vs " << std::endl << pose;
+            }
+        }
+    }
+
+    iDynUtils coman;
+    iDynUtils bigman;
+};
+
+TEST_F(testSIMDKinematics, testPosesMatchIDynTree)
+{
+    std::vector<std::string> links;
+    links.push_back("l_wrist");
+    links.push_back("r_wrist");
+    links.push_back("l_sole");
+    links.push_back("r_sole");
+    links.push_back("Waist");
+
+    checkPoses(coman, links);
+    checkPoses(bigman, links);
+}
+
+TEST_F(testSIMDKinematics, testWrongLink)
+{
+    std::vector<std::string> links;
+    links.push_back("l_wrist");
+    links.push_back("not_a_link");
+    idynutils::simd_kinematics fk(bigman, links);
+
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Zero(bigman.iDyn3_model.getNrOfDOFs(), 2);
+    Eigen::MatrixXd poses(fk.getPosesSize(), 2);
+    EXPECT_FALSE(fk.evaluate(Q, poses.data()));
+}
+
+TEST_F(testSIMDKinematics, testFKTime)
+{
+    std::vector<std::string> links;
+    links.push_back("l_wrist");
+    links.push_back("r_wrist");
+    links.push_back("l_sole");
+    links.push_back("r_sole");
+    idynutils::simd_kinematics fk(bigman, links);
+
+    const unsigned int nJ = bigman.iDyn3_model.getNrOfDOFs();
+    const unsigned int N = 4096;
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Random(nJ, N);
+    Eigen::MatrixXd poses(fk.getPosesSize(), N);
+
+    double t = yarp::os::Time::now();
+    for(unsigned int k = 0; k < N; ++k) {
+        bigman.iDyn3_model.setAng(cartesian_utils::fromEigentoYarp(Eigen::VectorXd(Q.col(k))));
+        bigman.iDyn3_model.computePositions();
+    }
+    double idyntree_time = yarp::os::Time::now() - t;
+
+    t = yarp::os::Time::now();
+    fk.evaluate(Q, poses.data());
+    double simd_time = yarp::os::Time::now() - t;
+
+    std::cout << "bigman FK of " << N << " configurations, iDynTree: " << idyntree_time << " [s], "
+              << "SIMD (" << idynutils::simd_kinematics::getNrOfLanes() << " lanes): "
+              << simd_time << " [s]" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <idynutils/stage_profiler.h>
+#include <idynutils/idynutils.h>
+#include <cstdio>
+#include <fstream>
+
+namespace{
+
+class testStageProfiler: public ::testing::Test
+{
+protected:
+    testStageProfiler() :
+        profiler(std::vector<std::string>(2, "")),
+        dump_file(std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "stage_profiler_dump.txt")
+    {
+
+    }
+
+    virtual ~testStageProfiler() {
+
+    }
+
+    virtual void SetUp() {
+        std::remove(dump_file.c_str());
+    }
+
+    virtual void TearDown() {
+        std::remove(dump_file.c_str());
+    }
+
+    idynutils::stage_profiler profiler;
+    std::string dump_file;
+};
+
+TEST_F(testStageProfiler, testStatistics)
+{
+    idynutils::stage_profiler::stage_statistics statistics = profiler.getStatistics(0);
+    EXPECT_EQ(statistics.count, 0u);
+    EXPECT_EQ(statistics.max, 0.0);
+    EXPECT_EQ(profiler.getPercentile(0, 99.0), 0.0);
+
+    // 1us ... 100us
+    for(unsigned int i = 1; i <= 100; ++i)
+        profiler.addSample(0, i*1000);
+
+    statistics = profiler.getStatistics(0);
+    EXPECT_EQ(statistics.count, 100u);
+    EXPECT_DOUBLE_EQ(statistics.min, 1e-6);
+    EXPECT_DOUBLE_EQ(statistics.max, 100e-6);
+    EXPECT_NEAR(statistics.mean, 50.5e-6, 1e-12);
+    EXPECT_NEAR(statistics.p99, 99e-6, 0.125*99e-6);
+    EXPECT_NEAR(profiler.getPercentile(0, 50.0), 50e-6, 0.125*50e-6);
+    EXPECT_DOUBLE_EQ(profiler.getPercentile(0, 100.0), 100e-6);
+    EXPECT_NEAR(profiler.getPercentile(0, 0.0), 1e-6, 0.125*1e-6);
+
+    // stages are independent
+    EXPECT_EQ(profiler.getStatistics(1).count, 0u);
+
+    profiler.reset();
+    EXPECT_EQ(profiler.getStatistics(0).count, 0u);
+    EXPECT_EQ(profiler.getStatistics(0).min, 0.0);
+}
+
+TEST_F(testStageProfiler, testPercentileRelativeError)
+{
+    const uint64_t durations[] = {0, 7, 8, 15, 16, 1000, 123456, 987654321, 1ULL << 40};
+    for(unsigned int i = 0; i < sizeof(durations)/sizeof(durations[0]); ++i)
+    {
+        profiler.reset();
+        profiler.addSample(0, durations[i]);
+        profiler.addSample(1, durations[i]);
+        profiler.addSample(1, durations[i] + durations[i]/16);
+        EXPECT_DOUBLE_EQ(profiler.getPercentile(0, 50.0), durations[i]*1e-9);
+        EXPECT_GE(profiler.getPercentile(1, 50.0), durations[i]*1e-9);
+        EXPECT_LE(profiler.getPercentile(1, 50.0), 1.125*durations[i]*1e-9);
+    }
+}
+
+TEST_F(testStageProfiler, testScopedTimer)
+{
+    {
+        idynutils::stage_profiler::scoped_timer timer(profiler, 1);
+        uint64_t start = idynutils::stage_profiler::now();
+        while(idynutils::stage_profiler::now() - start < 100000);
+    }
+    EXPECT_EQ(profiler.getStatistics(0).count, 0u);
+    EXPECT_EQ(profiler.getStatistics(1).count, 1u);
+    EXPECT_GE(profiler.getStatistics(1).min, 100e-6);
+}
+
+TEST_F(testStageProfiler, testDump)
+{
+    iDynUtils coman("coman",
+                    std::string(IDYNUTILS_TESTS_ROBOTS_DIR)+"coman/coman.urdf",
+                    std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "coman/coman.srdf");
+
+    yarp::sig::Vector q(coman.iDyn3_model.getNrOfDOFs(), 0.0);
+    for(unsigned int i = 0; i < 10; ++i)
+        coman.updateiDyn3Model(q, true);
+    coman.checkSelfCollision();
+
+    const idynutils::stage_profiler& coman_profiler = coman.getProfiler();
+    ASSERT_EQ(coman_profiler.getNrOfStages(), (unsigned int)iDynUtils::PROFILE_WORLD_COLLISION + 1);
+    EXPECT_EQ(coman_profiler.getStageName(iDynUtils::PROFILE_KINEMATIC_RNEA), "kinematicRNEA");
+    // statistics are there only when idynutils is built with IDYNUTILS_ENABLE_PROFILING
+    uint64_t n_updates = coman_profiler.getStatistics(iDynUtils::PROFILE_UPDATE_MODEL).count;
+    EXPECT_TRUE(n_updates == 0 || n_updates == 10);
+    if(n_updates > 0) {
+        EXPECT_EQ(coman_profiler.getStatistics(iDynUtils::PROFILE_SELF_COLLISION).count, 1u);
+    }
+
+    ASSERT_TRUE(coman_profiler.dump(dump_file));
+    std::ifstream file(dump_file.c_str());
+    std::string line;
+    unsigned int lines = 0;
+    while(std::getline(file, line))
+        ++lines;
+    EXPECT_EQ(lines, coman_profiler.getNrOfStages() + 1);
+
+    EXPECT_FALSE(coman_profiler.dump("/this/path/does/not/exist/dump.txt"));
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
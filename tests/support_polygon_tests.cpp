@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include <idynutils/support_polygon.h>
+#include <idynutils/convex_hull.h>
+#include <idynutils/idynutils.h>
+#include <yarp/os/Time.h>
+
+#include "allocation_counter.h"
+
+namespace{
+
+class testSupportPolygon: public ::testing::Test
+{
+protected:
+    testSupportPolygon() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testSupportPolygon() {
+
+    }
+
+    virtual void SetUp() {
+
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    iDynUtils bigman;
+};
+
+TEST_F(testSupportPolygon, testSquare)
+{
+    idynutils::support_polygon polygon;
+    polygon.push_back(KDL::Vector(1.0, 1.0, 0.1));
+    polygon.push_back(KDL::Vector(0.5, 0.5, 0.2));   // inside
+    polygon.push_back(KDL::Vector(0.0, 1.0, 0.3));
+    polygon.push_back(KDL::Vector(0.0, 0.0, 0.4));
+    polygon.push_back(KDL::Vector(0.5, 0.0, 0.5));   // collinear
+    polygon.push_back(KDL::Vector(1.0, 0.0, 0.6));
+    polygon.push_back(KDL::Vector(1.0, 1.0, 0.7));   // duplicated on the plane
+    ASSERT_EQ(polygon.size(), 7u);
+
+    ASSERT_TRUE(polygon.computeConvexHull());
+    ASSERT_EQ(polygon.getNrOfHullVertices(), 4u);
+
+    // counterclockwise, starting from the lowest x
+    const double expected[4][2] = {{0.0, 0.0}, {1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0}};
+    for(unsigned int i = 0; i < 4; ++i) {
+        EXPECT_DOUBLE_EQ(polygon.getHullVertex(i).x(), expected[i][0]);
+        EXPECT_DOUBLE_EQ(polygon.getHullVertex(i).y(), expected[i][1]);
+        EXPECT_DOUBLE_EQ(polygon.getHullVertex(i).z(), 0.0);
+    }
+
+    std::vector<KDL::Vector> ch;
+    polygon.getConvexHull(ch);
+    EXPECT_EQ(ch.size(), 4u);
+}
+
+TEST_F(testSupportPolygon, testDegenerate)
+{
+    idynutils::support_polygon polygon;
+    EXPECT_FALSE(polygon.computeConvexHull());
+    EXPECT_EQ(polygon.getNrOfHullVertices(), 0u);
+
+    polygon.push_back(KDL::Vector(0.0, 0.0, 0.0));
+    polygon.push_back(KDL::Vector(1.0, 1.0, 0.0));
+    polygon.push_back(KDL::Vector(2.0, 2.0, 0.0));
+    EXPECT_FALSE(polygon.computeConvexHull());
+
+    polygon.clear();
+    for(unsigned int i = 0; i < idynutils::support_polygon::MAX_POINTS; ++i)
+        EXPECT_TRUE(polygon.push_back(KDL::Vector(i, i*i, 0.0)));
+    EXPECT_FALSE(polygon.push_back(KDL::Vector(0.0, 0.0, 0.0)));
+    EXPECT_EQ(polygon.size(), idynutils::support_polygon::MAX_POINTS);
+    EXPECT_TRUE(polygon.computeConvexHull());
+    EXPECT_EQ(polygon.getNrOfHullVertices(), idynutils::support_polygon::MAX_POINTS);
+}
+
+TEST_F(testSupportPolygon, testSameAsConvexHull)
+{
+    const char* frames[] = {"COM", "world", "l_sole"};
+    for(unsigned int f = 0; f < sizeof(frames)/sizeof(frames[0]); ++f)
+    {
+        std::list<KDL::Vector> points;
+        ASSERT_TRUE(bigman.getSupportPolygonPoints(points, frames[f]));
+
+        idynutils::support_polygon polygon;
+        ASSERT_TRUE(bigman.getSupportPolygonPoints(polygon, frames[f]));
+        ASSERT_EQ(polygon.size(), points.size());
+
+        unsigned int i = 0;
+        for(std::list<KDL::Vector>::iterator it = points.begin(); it != points.end(); ++it, ++i)
+            for(unsigned int k = 0; k < 3; ++k)
+                EXPECT_NEAR(polygon[i][k], (*it)[k], 1e-12);
+
+        std::vector<KDL::Vector> ch;
+        idynutils::convex_hull huller;
+        huller.getConvexHull(points, ch);
+
+        ASSERT_TRUE(polygon.computeConvexHull());
+        ASSERT_EQ(polygon.getNrOfHullVertices(), ch.size());
+        for(unsigned int j = 0; j < ch.size(); ++j)
+        {
+            bool found = false;
+            for(unsigned int v = 0; v < polygon.getNrOfHullVertices(); ++v)
+                if((polygon.getHullVertex(v) - ch[j]).Norm() < 1e-6)
+                    found = true;
+            EXPECT_TRUE(found) << ch[j].x() << " " << ch[j].y() << " " << ch[j].z();
+        }
+    }
+
+    idynutils::support_polygon polygon;
+    EXPECT_FALSE(bigman.getSupportPolygonPoints(polygon, "not_a_link"));
+
+    // more links in contact than the capacity of the polygon
+    std::list<std::string> links;
+    const KDL::SegmentMap& segments = bigman.getKDLTree().getSegments();
+    for(KDL::SegmentMap::const_iterator it = segments.begin(); it != segments.end(); ++it)
+        links.push_back(it->first);
+    bigman.setLinksInContact(links);
+    ASSERT_GT(bigman.getLinksInContact().size(), idynutils::support_polygon::MAX_POINTS);
+    EXPECT_FALSE(bigman.getSupportPolygonPoints(polygon, "world"));
+}
+
+TEST_F(testSupportPolygon, testNoAllocations)
+{
+    // outside the real-time mode the joint state is read back from iDynTree, which allocates
+    bigman.warmup();
+
+    const std::string reference_frame("COM");
+    idynutils::support_polygon polygon;
+    bigman.getSupportPolygonPoints(polygon, reference_frame);
+
+    std::list<KDL::Vector> points;
+    std::vector<KDL::Vector> ch;
+    idynutils::convex_hull huller;
+    allocation_counter::start();
+    bigman.getSupportPolygonPoints(points, reference_frame);
+    huller.getConvexHull(points, ch);
+    unsigned int list_allocations = allocation_counter::stop();
+
+    allocation_counter::start();
+    bigman.getSupportPolygonPoints(polygon, reference_frame);
+    unsigned int polygon_allocations = allocation_counter::stop();
+
+    allocation_counter::start();
+    polygon.computeConvexHull();
+    EXPECT_EQ(allocation_counter::stop(), 0u);
+
+    std::cout << "support polygon allocations, list and PCL: " << list_allocations
+              << ", support_polygon: " << polygon_allocations << std::endl;
+    EXPECT_EQ(polygon_allocations, 0u);
+
+    // the reference link is looked up only when it changes
+    const std::string reference_link("l_sole");
+    bigman.getSupportPolygonPoints(polygon, reference_link);
+    allocation_counter::start();
+    bigman.getSupportPolygonPoints(polygon, reference_link);
+    EXPECT_EQ(allocation_counter::stop(), 0u);
+
+    const unsigned int iterations = 1000;
+    double t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        points.clear();
+        ch.clear();
+        bigman.getSupportPolygonPoints(points, reference_frame);
+        huller.getConvexHull(points, ch);
+    }
+    double list_time = yarp::os::Time::now() - t;
+
+    t = yarp::os::Time::now();
+    for(unsigned int i = 0; i < iterations; ++i) {
+        bigman.getSupportPolygonPoints(polygon, reference_frame);
+        polygon.computeConvexHull();
+    }
+    double polygon_time = yarp::os::Time::now() - t;
+
+    std::cout << "support polygon, list and PCL: " << list_time/iterations << " [s], "
+              << "support_polygon: " << polygon_time/iterations << " [s]" << std::endl;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
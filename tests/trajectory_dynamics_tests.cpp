@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <idynutils/trajectory_dynamics.h>
+#include <idynutils/batch_evaluator.h>
+#include <idynutils/idynutils.h>
+#include <yarp/os/Time.h>
+#include <sstream>
+
+namespace{
+
+class testTrajectoryDynamics: public ::testing::Test
+{
+protected:
+    testTrajectoryDynamics() :
+        bigman("bigman",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.urdf",
+               std::string(IDYNUTILS_TESTS_ROBOTS_DIR) + "bigman/bigman.srdf")
+    {
+
+    }
+
+    virtual ~testTrajectoryDynamics() {
+
+    }
+
+    virtual void SetUp() {
+        nJ = bigman.iDyn3_model.getNrOfDOFs();
+        Q = Eigen::MatrixXd::Random(nJ, 50);
+        dQ = Eigen::MatrixXd::Random(nJ, 50);
+        ddQ = Eigen::MatrixXd::Random(nJ, 50);
+    }
+
+    virtual void TearDown() {
+
+    }
+
+    iDynUtils bigman;
+    unsigned int nJ;
+    Eigen::MatrixXd Q;
+    Eigen::MatrixXd dQ;
+    Eigen::MatrixXd ddQ;
+};
+
+TEST_F(testTrajectoryDynamics, testTorquesMatchIDynTree)
+{
+    idynutils::trajectory_dynamics trajectory(bigman, 4);
+    ASSERT_TRUE(trajectory.isValid());
+    ASSERT_EQ(trajectory.getNumberOfThreads(), 4u);
+    ASSERT_EQ(trajectory.getNumberOfDOFs(), nJ);
+
+    const int n = Q.cols();
+    Eigen::MatrixXd torques(nJ, n);
+    Eigen::MatrixXd base_wrenches(6, n);
+    Eigen::MatrixXd com(3, n);
+    Eigen::VectorXi exceeded(n);
+
+    idynutils::trajectory_dynamics::outputs out;
+    out.torques = torques.data();
+    out.base_wrenches = base_wrenches.data();
+    out.com = com.data();
+    out.torque_limits_exceeded = exceeded.data();
+    ASSERT_TRUE(trajectory.evaluate(Q, dQ, ddQ, out));
+
+    const Eigen::VectorXd tau_max = bigman.getJointTorqueMax();
+    for(int c = 0; c < n; ++c)
+    {
+        bigman.updateiDyn3Model(Q.col(c), dQ.col(c), ddQ.col(c));
+
+        Eigen::VectorXd tau = bigman.getTorques();
+        EXPECT_TRUE(torques.col(c).isApprox(tau, 1e-6)) << torques.col(c).transpose() << std::endl
+                                                       << " vs " << std::endl << tau.transpose();
+
+        int count = 0;
+        for(unsigned int i = 0; i < nJ; ++i)
+            if(std::fabs(tau[i]) > tau_max[i])
+                ++count;
+        EXPECT_EQ(exceeded[c], count);
+
+        KDL::Vector CoM = bigman.getCoM();
+        EXPECT_NEAR(com(0, c), CoM.x(), 1e-9);
+        EXPECT_NEAR(com(1, c), CoM.y(), 1e-9);
+        EXPECT_NEAR(com(2, c), CoM.z(), 1e-9);
+    }
+}
+
+TEST_F(testTrajectoryDynamics, testStaticBaseWrench)
+{
+    idynutils::trajectory_dynamics trajectory(bigman, 1);
+
+    Eigen::MatrixXd base_wrench(6, 1);
+    Eigen::MatrixXd com(3, 1);
+    idynutils::trajectory_dynamics::outputs out;
+    out.base_wrenches = base_wrench.data();
+    out.com = com.data();
+    const Eigen::MatrixXd zero = Eigen::MatrixXd::Zero(nJ, 1);
+    ASSERT_TRUE(trajectory.evaluate(Q.leftCols(1), zero, zero, out));
+
+    // standing still, the floating base holds the weight of the robot
+    const double mass = bigman.iDyn3_model.getTotalMass();
+    const KDL::Vector base = bigman.iDyn3_model.getPositionKDL(bigman.iDyn3_model.getFloatingBaseLink()).p;
+    const KDL::Vector weight(0.0, 0.0, mass*9.81);
+    const KDL::Vector torque = (KDL::Vector(com(0), com(1), com(2)) - base) * weight;
+
+    EXPECT_NEAR(base_wrench(0), 0.0, 1e-6);
+    EXPECT_NEAR(base_wrench(1), 0.0, 1e-6);
+    EXPECT_NEAR(base_wrench(2), weight.z(), 1e-6);
+    EXPECT_NEAR(base_wrench(3), torque.x(), 1e-6);
+    EXPECT_NEAR(base_wrench(4), torque.y(), 1e-6);
+    EXPECT_NEAR(base_wrench(5), torque.z(), 1e-6);
+}
+
+TEST_F(testTrajectoryDynamics, testThreadsGiveSameResults)
+{
+    idynutils::trajectory_dynamics serial(bigman, 1);
+    idynutils::trajectory_dynamics parallel(bigman, 3);
+
+    Eigen::MatrixXd serial_torques(nJ, Q.cols());
+    Eigen::MatrixXd parallel_torques(nJ, Q.cols());
+    idynutils::trajectory_dynamics::outputs out;
+
+    out.torques = serial_torques.data();
+    ASSERT_TRUE(serial.evaluate(Q, dQ, ddQ, out));
+    out.torques = parallel_torques.data();
+    ASSERT_TRUE(parallel.evaluate(Q, dQ, ddQ, out));
+
+    EXPECT_TRUE(serial_torques == parallel_torques);
+}
+
+TEST_F(testTrajectoryDynamics, testStreaming)
+{
+    idynutils::trajectory_dynamics trajectory(bigman, 2);
+
+    Eigen::MatrixXd torques(nJ, Q.cols());
+    Eigen::VectorXi exceeded(Q.cols());
+    idynutils::trajectory_dynamics::outputs out;
+    out.torques = torques.data();
+    out.torque_limits_exceeded = exceeded.data();
+    ASSERT_TRUE(trajectory.evaluate(Q, dQ, ddQ, out));
+
+    std::stringstream samples;
+    samples.precision(17);
+    samples << "# q dq ddq" << std::endl;
+    for(int c = 0; c < Q.cols(); ++c)
+    {
+        for(unsigned int i = 0; i < nJ; ++i)
+            samples << Q(i, c) << ", ";
+        for(unsigned int i = 0; i < nJ; ++i)
+            samples << dQ(i, c) << ", ";
+        for(unsigned int i = 0; i < nJ; ++i)
+            samples << ddQ(i, c) << (i + 1 < nJ ? ", " : "");
+        samples << std::endl << std::endl;
+        // a truncated sample
+        if(c == 10)
+            samples << Q(0, c) << ", " << Q(1, c) << std::endl;
+    }
+
+    std::stringstream results;
+    results.precision(17);
+    idynutils::trajectory_dynamics::text_sample_reader reader(samples, nJ);
+    idynutils::trajectory_dynamics::text_result_writer writer(results, nJ);
+    // the chunk size does not divide the number of samples
+    EXPECT_EQ(trajectory.evaluate(reader, writer, true, false, false, true, 16), (unsigned int)Q.cols());
+    EXPECT_EQ(reader.getNrOfSkippedSamples(), 1u);
+
+    for(int c = 0; c < Q.cols(); ++c)
+    {
+        unsigned int index;
+        ASSERT_TRUE(results >> index);
+        EXPECT_EQ(index, (unsigned int)c);
+
+        for(unsigned int i = 0; i < nJ; ++i) {
+            double tau;
+            ASSERT_TRUE(results >> tau);
+            EXPECT_NEAR(tau, torques(i, c), 1e-9);
+        }
+
+        int count;
+        ASSERT_TRUE(results >> count);
+        EXPECT_EQ(count, exceeded[c]);
+    }
+}
+
+TEST_F(testTrajectoryDynamics, testTrajectoryTime)
+{
+    const int n = 1000;
+    Eigen::MatrixXd Q_long = Eigen::MatrixXd::Random(nJ, n);
+    Eigen::MatrixXd dQ_long = Eigen::MatrixXd::Random(nJ, n);
+    Eigen::MatrixXd ddQ_long = Eigen::MatrixXd::Random(nJ, n);
+    Eigen::MatrixXd torques(nJ, n);
+    Eigen::MatrixXd batch_torques(nJ, n);
+
+    idynutils::trajectory_dynamics trajectory(bigman);
+    idynutils::trajectory_dynamics::outputs out;
+    out.torques = torques.data();
+
+    double t = yarp::os::Time::now();
+    trajectory.evaluate(Q_long, dQ_long, ddQ_long, out);
+    double trajectory_time = yarp::os::Time::now() - t;
+
+    idynutils::batch_evaluator batch(bigman, std::vector<std::string>());
+    idynutils::batch_evaluator::outputs batch_out;
+    batch_out.torques = batch_torques.data();
+
+    t = yarp::os::Time::now();
+    batch.evaluate(Q_long, dQ_long, ddQ_long, batch_out);
+    double batch_time = yarp::os::Time::now() - t;
+
+    std::cout << n << " samples on " << trajectory.getNumberOfThreads() << " threads, "
+              << "trajectory_dynamics: " << trajectory_time << " [s], "
+              << "batch_evaluator: " << batch_time << " [s]" << std::endl;
+
+    // the batch evaluator runs the RNEA of iDynUtils
+    for(int c = 0; c < n; ++c)
+        EXPECT_TRUE(torques.col(c).isApprox(batch_torques.col(c), 1e-6)) << "sample " << c;
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <idynutils/worker_pool.h>
+#include <boost/bind.hpp>
+#include <vector>
+
+namespace{
+
+class testWorkerPool: public ::testing::Test
+{
+protected:
+    testWorkerPool() :
+        pool(4),
+        calls(4, 0),
+        threads(4)
+    {
+
+    }
+
+    virtual ~testWorkerPool() {
+
+    }
+
+    virtual void SetUp() {
+
+    }
+
+    virtual void TearDown() {
+
+    }
+
+public:
+    void task(const unsigned int i)
+    {
+        ++calls[i];
+        threads[i] = boost::this_thread::get_id();
+    }
+
+protected:
+    idynutils::worker_pool pool;
+    std::vector<int> calls;
+    std::vector<boost::thread::id> threads;
+};
+
+TEST_F(testWorkerPool, testRun)
+{
+    EXPECT_EQ(pool.getNumberOfThreads(), 4u);
+
+    const unsigned int rounds = 1000;
+    for(unsigned int r = 0; r < rounds; ++r)
+        pool.run(boost::bind(&testWorkerPool::task, this, _1), 4);
+
+    for(unsigned int i = 0; i < 4; ++i)
+        EXPECT_EQ(calls[i], (int)rounds);
+
+    // the calling thread runs task 0, every worker its own task
+    EXPECT_EQ(threads[0], boost::this_thread::get_id());
+    for(unsigned int i = 1; i < 4; ++i)
+        for(unsigned int j = 0; j < i; ++j)
+            EXPECT_NE(threads[i], threads[j]);
+}
+
+TEST_F(testWorkerPool, testFewerTasks)
+{
+    pool.run(boost::bind(&testWorkerPool::task, this, _1), 2);
+    pool.run(boost::bind(&testWorkerPool::task, this, _1), 0);
+    pool.run(boost::bind(&testWorkerPool::task, this, _1), 1);
+    pool.run(boost::bind(&testWorkerPool::task, this, _1), 3);
+
+    EXPECT_EQ(calls[0], 3);
+    EXPECT_EQ(calls[1], 2);
+    EXPECT_EQ(calls[2], 1);
+    EXPECT_EQ(calls[3], 0);
+}
+
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}